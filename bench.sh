@@ -0,0 +1,299 @@
+#! /bin/bash
+# source: bench.sh
+# Copyright Gerhard Rieger
+# Published under the GNU General Public License V.2, see file COPYING
+
+# simple benchmarks of socat internals; not part of the test suite.
+# usage: ./bench.sh [-b <blocksize>] [-n <blocks>] [-c <socat>] [<benchmark> ...]
+# benchmarks:
+#   poll	event method of the transfer loop (option -P): transfers data
+#		from a pipe to a TCP socket and counts the system calls per
+#		transferred block and per MB, using socat's own system call
+#		trace; with io_uring, reads and writes are done by the kernel
+#		and only io_uring_enter() calls remain
+#   newline	line termination conversion (options cr, crnl): converts a
+#		text file with lines of 40 bytes and reports the throughput;
+#		with -c, the same is measured with another socat binary, e.g.
+#		a build of an older version
+#   escape	option escape: transfers the text file, which does not contain
+#		the escape character, and reports the throughput; -c as above
+#   dump	options -v, -x: transfers the text file with the data dump to
+#		/dev/null and reports the throughput; -c as above
+#   capture	option -cf: transfers the text file without capture, with
+#		pcapng capture to a file in $CAPDIR (default /tmp), and with
+#		-x, and reports the throughput
+#   accept	connect storm: parallel clients open and close -n TCP
+#		connections to a listener with option fork (and with option
+#		multi when available, and both with option shards=<CPUs>)
+#		and the accepts per second are reported;
+#		each client waits until the server closed the connection, so
+#		every connection has been accepted; -c as above
+#   udp		datagram relay (option -B): 4 senders send packets of
+#		$UDPSIZE bytes (default 64) from /dev/zero for $UDPTIME seconds
+#		(default 3) to a UDP4-RECV to UDP4-SENDTO relay without and with
+#		batches of 8 and 64 packets; the relay forwards to a port without
+#		receiver, so the kernel counts its packets (NoPorts in
+#		/proc/net/snmp, Linux), and the packets per second are reported
+
+SOCAT=${SOCAT:-./socat}
+SOCAT_CMP=
+BLOCKSIZE=8192
+BLOCKS=20000
+PORT=$((48000+$$%1000))
+LOCALHOST=127.0.0.1
+
+while [ "$1" ]; do
+    case "X$1" in
+	X-b) shift; BLOCKSIZE="$1" ;;
+	X-n) shift; BLOCKS="$1" ;;
+	X-c) shift; SOCAT_CMP="$1" ;;
+	X-*) echo "$0: unknown option \"$1\"" >&2; exit 1 ;;
+	*) break ;;
+    esac
+    shift
+done
+BENCHES="$*"
+[ -z "$BENCHES" ] && BENCHES="poll"
+
+TIMEFORMAT="%R"
+
+# transfers the data through socat with the given options and writes its
+# stderr to the trace file; a 4th -d enables the system call trace
+# usage: bench_transfer "<socat options>" <tracefile>
+bench_transfer () {
+    local opts="$1" trace="$2"
+    $SOCAT -u TCP4-LISTEN:$PORT,reuseaddr OPEN:/dev/null &
+    local pid=$!
+    sleep 0.2
+    dd if=/dev/zero bs=$BLOCKSIZE count=$BLOCKS 2>/dev/null |
+	$SOCAT $opts -b $BLOCKSIZE -u - TCP4:$LOCALHOST:$PORT >/dev/null 2>"$trace"
+    wait $pid
+}
+
+# counts the calls of a system call in a socat trace
+calls () {
+    grep " D $1(" "$2" |grep -vc " -> "
+}
+
+bench_poll () {
+    local trace="/tmp/bench$$.trace"
+    local methods="select"
+    local m s p ew ec ue rw t
+    $SOCAT -V |grep -q "#define WITH_EPOLL" && methods="$methods epoll"
+    $SOCAT -V |grep -q "#define WITH_IO_URING" && methods="$methods io_uring"
+    echo "poll: $BLOCKS blocks of $BLOCKSIZE bytes, pipe to TCP"
+    printf "%-8s %10s %10s %10s %12s %10s %8s\n" method "wait/blk" "ctl/blk" "sys/blk" "rd+wr/blk" "total/MB" "time[s]"
+    for m in $methods; do
+	bench_transfer "-d -d -d -d -P $m" "$trace"
+	s=$(calls select "$trace"); p=$(calls poll "$trace")
+	ew=$(calls epoll_wait "$trace"); ec=$(calls epoll_ctl "$trace")
+	ue=$(calls io_uring_enter "$trace")
+	rw=$(( $(calls read "$trace") + $(calls write "$trace") + $(calls splice "$trace") ))
+	t=$( { time bench_transfer "-P $m" /dev/null; } 2>&1 )
+	awk "BEGIN { printf \"%-8s %10.3f %10.3f %10.3f %12.3f %10.1f %8s\\n\", \"$m\",
+		($s+$p+$ew+$ue)/$BLOCKS, $ec/$BLOCKS, ($s+$p+$ew+$ue+$ec)/$BLOCKS,
+		$rw/$BLOCKS,
+		($s+$p+$ew+$ue+$ec+$rw)*1048576/($BLOCKS*$BLOCKSIZE), \"$t\" }"
+    done
+    rm -f "$trace"
+}
+
+# transfers file with the given socat binary and options and prints the
+# elapsed time; socat's own stderr is discarded
+# usage: file_time <socat> <file> "<input options>" "<output options>" ["<socat options>"]
+file_time () {
+    { time $1 $5 -u -b $BLOCKSIZE OPEN:$2$3 OPEN:/dev/null$4 2>/dev/null; } 2>&1
+}
+
+# creates a file of about BLOCKS*BLOCKSIZE bytes of 40 byte lines with CR LF
+# line ends
+# usage: text_file <file>
+text_file () {
+    awk 'BEGIN { for (i = 0; i < 16384; ++i)
+		    printf "%038d\r\n", i }' >"$1.1"
+    : >"$1"
+    while [ $(wc -c <"$1") -lt $((BLOCKS*BLOCKSIZE)) ]; do
+	cat "$1.1" >>"$1"
+    done
+    rm -f "$1.1"
+}
+
+bench_newline () {
+    local file="/tmp/bench$$.txt"
+    local conv in out t tc mb
+    text_file "$file"
+    mb=$(( $(wc -c <"$file") / 1048576 ))
+    echo "newline: $mb MB in blocks of $BLOCKSIZE bytes, file to /dev/null"
+    printf "%-12s %8s %10s" conversion "time[s]" "MB/s"
+    [ "$SOCAT_CMP" ] && printf " %12s %10s" "cmp time[s]" "cmp MB/s"
+    echo
+    for conv in none raw-cr raw-crnl crnl-raw crnl-cr; do
+	case $conv in
+	    none)     in=;      out= ;;
+	    raw-cr)   in=;      out=,cr ;;
+	    raw-crnl) in=;      out=,crnl ;;
+	    crnl-raw) in=,crnl; out= ;;
+	    crnl-cr)  in=,crnl; out=,cr ;;
+	esac
+	t=$(file_time "$SOCAT" "$file" "$in" "$out")
+	awk "BEGIN { printf \"%-12s %8s %10.1f\", \"$conv\", \"$t\", $mb/$t }"
+	if [ "$SOCAT_CMP" ]; then
+	    tc=$(file_time "$SOCAT_CMP" "$file" "$in" "$out")
+	    awk "BEGIN { printf \" %12s %10.1f\", \"$tc\", $mb/$tc }"
+	fi
+	echo
+    done
+    rm -f "$file"
+}
+
+bench_escape () {
+    local file="/tmp/bench$$.txt"
+    local t tc mb
+    text_file "$file"
+    mb=$(( $(wc -c <"$file") / 1048576 ))
+    echo "escape: $mb MB in blocks of $BLOCKSIZE bytes, file to /dev/null"
+    printf "%-12s %8s %10s" option "time[s]" "MB/s"
+    [ "$SOCAT_CMP" ] && printf " %12s %10s" "cmp time[s]" "cmp MB/s"
+    echo
+    t=$(file_time "$SOCAT" "$file" ",escape=0x1d" "")
+    awk "BEGIN { printf \"%-12s %8s %10.1f\", \"escape=0x1d\", \"$t\", $mb/$t }"
+    if [ "$SOCAT_CMP" ]; then
+	tc=$(file_time "$SOCAT_CMP" "$file" ",escape=0x1d" "")
+	awk "BEGIN { printf \" %12s %10.1f\", \"$tc\", $mb/$tc }"
+    fi
+    echo
+    rm -f "$file"
+}
+
+bench_dump () {
+    local file="/tmp/bench$$.txt"
+    local opts t tc mb
+    text_file "$file"
+    mb=$(( $(wc -c <"$file") / 1048576 ))
+    echo "dump: $mb MB in blocks of $BLOCKSIZE bytes, file to /dev/null, dump to /dev/null"
+    printf "%-12s %8s %10s" option "time[s]" "MB/s"
+    [ "$SOCAT_CMP" ] && printf " %12s %10s" "cmp time[s]" "cmp MB/s"
+    echo
+    for opts in "-v" "-x" "-v -x"; do
+	t=$(file_time "$SOCAT" "$file" "" "" "$opts")
+	awk "BEGIN { printf \"%-12s %8s %10.1f\", \"$opts\", \"$t\", $mb/$t }"
+	if [ "$SOCAT_CMP" ]; then
+	    tc=$(file_time "$SOCAT_CMP" "$file" "" "" "$opts")
+	    awk "BEGIN { printf \" %12s %10.1f\", \"$tc\", $mb/$tc }"
+	fi
+	echo
+    done
+    rm -f "$file"
+}
+
+bench_capture () {
+    local file="/tmp/bench$$.txt" cap="${CAPDIR:-/tmp}/bench$$.pcapng"
+    local opts t mb
+    text_file "$file"
+    mb=$(( $(wc -c <"$file") / 1048576 ))
+    echo "capture: $mb MB in blocks of $BLOCKSIZE bytes, file to /dev/null"
+    printf "%-12s %8s %10s\n" option "time[s]" "MB/s"
+    for opts in "-g" "-cf $cap" "-x"; do
+	rm -f "$cap"
+	t=$(file_time "$SOCAT" "$file" "" "" "$opts")
+	awk "BEGIN { printf \"%-12s %8s %10.1f\n\", \"${opts%% *}\", \"$t\", $mb/$t }"
+    done
+    rm -f "$file" "$cap"
+}
+
+# runs the connect storm against socat with the given listen options and
+# prints the elapsed time; 8 clients make BLOCKS connections together with
+# bash's /dev/tcp
+# usage: storm_time <socat> "<listen options>"
+storm_time () {
+    local socat="$1" opts="$2" pid i n=$((BLOCKS/8))
+    $socat TCP4-LISTEN:$PORT,reuseaddr,backlog=1024$opts OPEN:/dev/null 2>/dev/null &
+    pid=$!
+    sleep 0.2
+    { time {
+	for i in 1 2 3 4 5 6 7 8; do
+	    ( k=0
+	      while [ $k -lt $n ]; do
+		  exec 3<>/dev/tcp/$LOCALHOST/$PORT && read -u 3 && exec 3<&-
+		  k=$((k+1))
+	      done ) &
+	done
+	wait $(jobs -p |grep -vx $pid)
+    } } 2>&1
+    kill $pid 2>/dev/null; wait $pid 2>/dev/null
+}
+
+bench_accept () {
+    local opts="fork" o t tc s
+    $SOCAT -V |grep -q "#define WITH_EPOLL" && opts="$opts multi"
+    if $SOCAT -hh |grep -q "[[:space:]]shards[[:space:]]"; then
+	s=$(getconf _NPROCESSORS_ONLN); [ "$s" -lt 2 ] && s=2
+	for o in $opts; do opts="$opts $o,shards=$s"; done
+    fi
+    echo "accept: $BLOCKS TCP connections of 8 parallel clients"
+    printf "%-16s %8s %10s" option "time[s]" "accepts/s"
+    [ "$SOCAT_CMP" ] && printf " %12s %10s" "cmp time[s]" "cmp acc/s"
+    echo
+    for o in $opts; do
+	t=$(storm_time "$SOCAT" ",$o")
+	awk "BEGIN { printf \"%-16s %8s %10.0f\", \"$o\", \"$t\", $BLOCKS/$t }"
+	if [ "$SOCAT_CMP" ]; then
+	    tc=$(storm_time "$SOCAT_CMP" ",$o")
+	    awk "BEGIN { printf \" %12s %10.0f\", \"$tc\", $BLOCKS/$tc }"
+	fi
+	echo
+    done
+}
+
+# reads the UDP NoPorts counter of the kernel
+noports () {
+    awk '/^Udp:/ { if (v++) print $3 }' /proc/net/snmp
+}
+
+# runs the UDP senders against a relay with the given socat options for
+# UDPTIME seconds and prints the packets per second the relay forwarded
+# usage: udp_rate "<socat options>"
+udp_rate () {
+    local opts="$1" pid pids= i n0 n1
+    $SOCAT $opts -u UDP4-RECV:$PORT,reuseaddr UDP4-SENDTO:$LOCALHOST:$((PORT+1)) 2>/dev/null &
+    pid=$!
+    sleep 0.2
+    for i in 1 2 3 4; do
+	$SOCAT -u -b $UDPSIZE OPEN:/dev/zero UDP4-SENDTO:$LOCALHOST:$PORT 2>/dev/null &
+	pids="$pids $!"
+    done
+    sleep 0.5
+    n0=$(noports)
+    sleep $UDPTIME
+    n1=$(noports)
+    kill $pids $pid 2>/dev/null; wait $pids $pid 2>/dev/null
+    echo $(( (n1-n0)/UDPTIME ))
+}
+
+bench_udp () {
+    local o
+    UDPSIZE=${UDPSIZE:-64}
+    UDPTIME=${UDPTIME:-3}
+    if [ ! -r /proc/net/snmp ]; then
+	echo "udp: /proc/net/snmp not available" >&2
+	return
+    fi
+    echo "udp: packets of $UDPSIZE bytes for $UDPTIME seconds, UDP4-RECV to UDP4-SENDTO relay"
+    printf "%-12s %10s\n" option "packets/s"
+    for o in "-B 1" "-B 8" "-B 64"; do
+	printf "%-12s %10s\n" "$o" "$(udp_rate "$o")"
+    done
+}
+
+for b in $BENCHES; do
+    case "$b" in
+	poll) bench_poll ;;
+	newline) bench_newline ;;
+	escape) bench_escape ;;
+	dump) bench_dump ;;
+	capture) bench_capture ;;
+	accept) bench_accept ;;
+	udp) bench_udp ;;
+	*) echo "$0: unknown benchmark \"$b\"" >&2; exit 1 ;;
+    esac
+done
@@ -21,11 +21,15 @@
 #include "xio.h"
 #include "xioopts.h"
 #include "xiolockfile.h"
+#include "xiopcapng.h"
+#include "xio-socket.h"
 
 
 /* command line options */
 struct {
-   size_t bufsiz;
+   size_t bufsiz;	/* with bufauto the largest read size */
+   bool bufauto;	/* -b auto: adapt read size per direction */
+   size_t bufmin;	/* with bufauto the smallest read size */
    bool verbose;
    bool verbhex;
    struct timeval pollintv;	/* with ignoreeof, reread after seconds */
@@ -37,8 +41,14 @@ struct {
    bool lefttoright;	/* first addr ro, second addr wo */
    bool righttoleft;	/* first addr wo, second addr ro */
    xiolock_t lock;	/* a lock file */
+   int pollmethod;	/* XIOPOLL_SELECT, XIOPOLL_EPOLL, XIOPOLL_IO_URING */
+   const char *capfile;	/* -cf: pcapng capture of the transferred data */
+   size_t caprotate;	/* -cs: rotate capture file at this size; 0: never */
+   unsigned int batch;	/* -B: datagrams per recvmmsg()/sendmmsg() */
 } socat_opts = {
    8192,	/* bufsiz */
+   false,	/* bufauto */
+   0,		/* bufmin */
    false,	/* verbose */
    false,	/* verbhex */
    {1,0},	/* pollintv */
@@ -50,13 +60,36 @@ struct {
    false,	/* lefttoright */
    false,	/* righttoleft */
    { NULL, 0 },	/* lock */
+   XIOPOLL_SELECT,	/* pollmethod */
+   NULL,	/* capfile */
+   0,		/* caprotate */
+   1,		/* batch */
 };
 
+/* -b auto: the default bounds of the read size, and how many consecutive
+   full or small reads make socat_bufadapt() double or halve it */
+#define SOCAT_BUFAUTO_MIN	1024
+#define SOCAT_BUFAUTO_MAX	131072
+#define SOCAT_BUFGROW	2
+#define SOCAT_BUFSHRINK	8
+
+/* -B: the largest batch, the iovec limit of the kernel */
+#define SOCAT_BATCHMAX	1024
+
+/* with option threads, each transfer thread has its own instance of the
+   transfer state that xiotransfer() uses */
+#if WITH_THREADS
+#define SOCAT_THREADLOCAL __thread
+#else
+#define SOCAT_THREADLOCAL
+#endif
+
 void socat_usage(FILE *fd);
 void socat_version(FILE *fd);
 int socat(const char *address1, const char *address2);
 int _socat(void);
-int cv_newline(unsigned char **buff, ssize_t *bytes, int lineterm1, int lineterm2);
+int cv_newline(unsigned char **buff, unsigned char **scratch, ssize_t *bytes,
+	       int lineterm1, int lineterm2);
 void socat_signal(int sig);
 static int socat_sigchild(struct single *file);
 
@@ -65,7 +98,17 @@ void crlftolf(char **in, ssize_t *len, size_t bufsiz);
 
 static int socat_lock(void);
 static void socat_unlock(void);
+static void socat_captureclose(void);
 static int socat_newchild(void);
+static xiofile_t *socat_poolopen(void);
+#if WITH_EPOLL
+static int socat_multi(const char *address2);
+#if _WITH_SOCKET
+struct socat_session;
+static int socat_sessions(void);
+static xiofile_t *socat_sessopen2(struct socat_session *s);
+#endif
+#endif
 
 static const char socatversion[] =
 #include "./VERSION"
@@ -85,6 +128,7 @@ int main(int argc, const char *argv[]) {
    const char **arg1, *a;
    char *mainwaitstring;
    char buff[10];
+   char c;
    double rto;
    int i, argc0, result;
    struct utsname ubuf;
@@ -156,6 +200,34 @@ int main(int argc, const char *argv[]) {
 	    break;
 	 }
 	 break;
+      case 'c':
+	 switch (arg1[0][2]) {
+	 case 'f': /* capture file */
+	 case 's': /* rotation size */
+	    c = arg1[0][2];
+	    if (arg1[0][3]) {
+	       a = *arg1+3;
+	    } else if (arg1[1]) {
+	       a = *++arg1, --argc;
+	    } else {
+	       Error1("option -c%c requires an argument; use option \"-h\" for help", c);
+	       Exit(1);
+	    }
+	    if (c == 'f') {
+	       socat_opts.capfile = a;
+	       break;
+	    }
+	    socat_opts.caprotate = strtoul(a, (char **)&a, 0);
+	    if (*a != '\0') {
+	       Error1("option -cs: invalid size \"%s\"", *arg1);
+	       Exit(1);
+	    }
+	    break;
+	 default:
+	    Error1("unknown capture option \"%s\"; use option \"-h\" for help", arg1[0]);
+	    break;
+	 }
+	 break;
       case 'v': socat_opts.verbose = true; break;
       case 'x': socat_opts.verbhex = true; break;
       case 'b': if (arg1[0][2]) {
@@ -167,7 +239,42 @@ int main(int argc, const char *argv[]) {
 	       Exit(1);
 	    }
 	 }
-	 socat_opts.bufsiz = strtoul(a, (char **)&a, 0);
+	 if (!strncmp(a, "auto", 4)) {
+	    /* auto[:<min>[:<max>]] */
+	    socat_opts.bufauto = true;
+	    socat_opts.bufmin = SOCAT_BUFAUTO_MIN;
+	    socat_opts.bufsiz = SOCAT_BUFAUTO_MAX;
+	    a += 4;
+	    if (*a == ':') {
+	       socat_opts.bufmin = strtoul(a+1, (char **)&a, 0);
+	       if (*a == ':') {
+		  socat_opts.bufsiz = strtoul(a+1, (char **)&a, 0);
+	       }
+	    }
+	    if (*a != '\0' || socat_opts.bufmin == 0 ||
+		socat_opts.bufmin > socat_opts.bufsiz) {
+	       Error1("option -b: invalid value \"%s\"", *arg1);
+	       Exit(1);
+	    }
+	 } else {
+	    socat_opts.bufsiz = strtoul(a, (char **)&a, 0);
+	 }
+	 break;
+      case 'B': if (arg1[0][2]) {
+	    a = *arg1+2;
+	 } else {
+	    ++arg1, --argc;
+	    if ((a = *arg1) == NULL) {
+	       Error("option -B requires an argument; use option \"-h\" for help");
+	       Exit(1);
+	    }
+	 }
+	 socat_opts.batch = strtoul(a, (char **)&a, 0);
+	 if (*a != '\0' || socat_opts.batch == 0 ||
+	     socat_opts.batch > SOCAT_BATCHMAX) {
+	    Error1("option -B: invalid value \"%s\"", *arg1);
+	    Exit(1);
+	 }
 	 break;
       case 's':
 	 diag_set_int('e', E_FATAL); break;
@@ -202,6 +309,30 @@ int main(int argc, const char *argv[]) {
       case 'u': socat_opts.lefttoright = true; break;
       case 'U': socat_opts.righttoleft = true; break;
       case 'g': xioopts_ignoregroups = true; break;
+      case 'P': if (arg1[0][2]) {
+	    a = *arg1+2;
+	 } else {
+	    ++arg1, --argc;
+	    if ((a = *arg1) == NULL) {
+	       Error("option -P requires an argument; use option \"-h\" for help");
+	       Exit(1);
+	    }
+	 }
+	 if (!strcmp(a, "select")) {
+	    socat_opts.pollmethod = XIOPOLL_SELECT;
+#if WITH_EPOLL
+	 } else if (!strcmp(a, "epoll")) {
+	    socat_opts.pollmethod = XIOPOLL_EPOLL;
+#endif
+#if WITH_IO_URING
+	 } else if (!strcmp(a, "io_uring")) {
+	    socat_opts.pollmethod = XIOPOLL_IO_URING;
+#endif
+	 } else {
+	    Error1("option -P: unknown or unsupported method \"%s\"", a);
+	    Exit(1);
+	 }
+	 break;
       case 'L': if (socat_opts.lock.lockfile)
 	     Error("only one -L and -W option allowed");
 	 if (arg1[0][2]) {
@@ -314,6 +445,7 @@ int main(int argc, const char *argv[]) {
    }
 
    Atexit(socat_unlock);
+   Atexit(socat_captureclose);
 
    result = socat(arg1[0], arg1[1]);
    Notice1("exiting with status %d", result);
@@ -346,7 +478,23 @@ void socat_usage(FILE *fd) {
    fputs("      -lh            add hostname to log messages\n", fd);
    fputs("      -v     verbose data traffic, text\n", fd);
    fputs("      -x     verbose data traffic, hexadecimal\n", fd);
+   fputs("      -cf<file>      capture data traffic to pcapng file\n", fd);
+   fputs("      -cs<size>      rotate capture file when it reaches size bytes\n", fd);
    fputs("      -b<size_t>     set data buffer size (8192)\n", fd);
+   fputs("      -b auto[:<min>[:<max>]] adapt buffer size per direction (1024:131072)\n", fd);
+#if HAVE_RECVMMSG && HAVE_SENDMMSG
+   fputs("      -B<count>      transfer up to count datagrams per system call (1)\n", fd);
+#endif
+#if WITH_EPOLL || WITH_IO_URING
+   fputs("      -P<method>     event method of transfer loop: select (default)"
+#if WITH_EPOLL
+	 ", epoll"
+#endif
+#if WITH_IO_URING
+	 ", io_uring"
+#endif
+	 "\n", fd);
+#endif
    fputs("      -s     sloppy (continue on error)\n", fd);
    fputs("      -t<timeout>    wait seconds before closing second channel\n", fd);
    fputs("      -T<timeout>    total inactivity timeout in seconds\n", fd);
@@ -518,6 +666,21 @@ void socat_version(FILE *fd) {
 #else
    fputs("  #undef WITH_LIBWRAP\n", fd);
 #endif
+#ifdef WITH_EPOLL
+   fprintf(fd, "  #define WITH_EPOLL %d\n", WITH_EPOLL);
+#else
+   fputs("  #undef WITH_EPOLL\n", fd);
+#endif
+#ifdef WITH_THREADS
+   fprintf(fd, "  #define WITH_THREADS %d\n", WITH_THREADS);
+#else
+   fputs("  #undef WITH_THREADS\n", fd);
+#endif
+#ifdef WITH_IO_URING
+   fprintf(fd, "  #define WITH_IO_URING %d\n", WITH_IO_URING);
+#else
+   fputs("  #undef WITH_IO_URING\n", fd);
+#endif
 #ifdef WITH_SYCLS
    fprintf(fd, "  #define WITH_SYCLS %d\n", WITH_SYCLS);
 #else
@@ -543,14 +706,19 @@ void socat_version(FILE *fd) {
 
 
 xiofile_t *sock1, *sock2;
-int closing = 0;	/* 0..no eof yet, 1..first eof just occurred,
+SOCAT_THREADLOCAL int closing = 0;	/* 0..no eof yet, 1..first eof just occurred,
 			   2..counting down closing timeout */
 
 /* call this function when the common command line options are parsed, and the
    addresses are extracted (but not resolved). */
+static const char *socat_pooladdr;	/* address2, for option pool */
+
 int socat(const char *address1, const char *address2) {
    int mayexec;
 
+   /* option pool of a listening address1 opens address2 in advance */
+   socat_pooladdr = address2;
+   xiohook_poolopen = &socat_poolopen;
    if (socat_opts.lefttoright) {
       if ((sock1 = xioopen(address1, XIO_RDONLY|XIO_MAYFORK|XIO_MAYCHILD|XIO_MAYCONVERT)) == NULL) {
 	 return -1;
@@ -567,6 +735,7 @@ int socat(const char *address1, const char *address2) {
       }
       xiosetsigchild(sock1, socat_sigchild);
    }
+   xiohook_poolopen = NULL;
 #if 1	/*! */
    if (XIO_READABLE(sock1) &&
        (XIO_RDSTREAM(sock1)->howtoend == END_KILL ||
@@ -599,8 +768,23 @@ int socat(const char *address1, const char *address2) {
    }
 #endif
 
+   if (sock1->tag != XIO_TAG_DUAL && (sock1->stream.flags & XIO_DOESMULTI)) {
+      /* option multi: this process serves all connections */
+#if WITH_EPOLL
+      return socat_multi(address2);
+#else
+      Error("option multi requires epoll");
+      return -1;
+#endif
+   }
+
    mayexec = (sock1->common.flags&XIO_DOESCONVERT ? 0 : XIO_MAYEXEC);
-   if (XIO_WRITABLE(sock1)) {
+   if (xiopooled != NULL) {
+      /* option pool: the listening parent process already opened address2 */
+      sock2 = xiopooled;
+      sock[1] = sock2;
+      xiosetsigchild(sock2, socat_sigchild);
+   } else if (XIO_WRITABLE(sock1)) {
       if (XIO_READABLE(sock1)) {
 	 if ((sock2 = xioopen(address2, XIO_RDWR|XIO_MAYFORK|XIO_MAYCHILD|mayexec|XIO_MAYCONVERT)) == NULL) {
 	    return -1;
@@ -702,12 +886,111 @@ int childleftdata(xiofile_t *xfd) {
 
 int xiotransfer(xiofile_t *inpipe, xiofile_t *outpipe,
 		unsigned char **buff, size_t bufsiz, bool righttoleft);
+static int xiotransfer_block(xiofile_t *inpipe, xiofile_t *outpipe,
+			     unsigned char **buff, ssize_t bytes,
+			     bool righttoleft);
 
 bool mayrd1;		/* sock1 has read data or eof, according to poll() */
 bool mayrd2;		/* sock2 has read data or eof, according to poll() */
 bool maywr1;		/* sock1 can be written to, according to poll() */
 bool maywr2;		/* sock2 can be written to, according to poll() */
 
+#if HAVE_SPLICE
+/* kernel pipes for zero copy transfer with splice(); [0] is used for sock1 to
+   sock2, [1] for sock2 to sock1. -1 means this direction uses buff */
+int splicepipe[2][2] = { { -1, -1 }, { -1, -1 } };
+
+static bool socat_maysplice(xiofile_t *inpipe, xiofile_t *outpipe);
+static int socat_splicepipe(int pipefd[2]);
+static int xiotransfer_splice(xiofile_t *inpipe, xiofile_t *outpipe,
+			      int pipefd[2], unsigned char **buff,
+			      size_t bufsiz, bool righttoleft);
+#endif /* HAVE_SPLICE */
+
+/* the transfer buffers, one per direction ([0] is sock1 to sock2, [1] is
+   sock2 to sock1), so each direction can hold data while the other one
+   transfers. Data that was read but not yet accepted by the output stays in
+   buff; while a direction has unwritten data, its input is not read. With
+   splice() the data stays in the kernel pipe and only bytes is used. With
+   option multi, xferbuf points to the buffers of the current connection */
+struct socat_xferbuf {
+   unsigned char *buff;	/* Malloc()'ed in _socat(), 2*bufsiz+1 bytes */
+   unsigned char *ptr;	/* first byte not yet written */
+   size_t bytes;	/* number of bytes not yet written */
+   unsigned char *scratch;	/* same size as buff, for cv_newline() */
+   size_t bufsiz;	/* read size; changed by socat_bufadapt() with -b auto */
+   size_t peak;		/* largest bufsiz, for the statistics */
+   unsigned int nfull;	/* consecutive reads that filled the buffer */
+   unsigned int nsmall;	/* consecutive reads of less than bufsiz/4 */
+   struct socat_mmsg *mmsg;	/* -B: datagram batches of the direction, or
+				   NULL */
+   size_t segsize;	/* udp-gro: segment size of the unwritten bytes */
+} ;
+static struct socat_xferbuf socat_xferbufs[2];
+SOCAT_THREADLOCAL struct socat_xferbuf *xferbuf = socat_xferbufs;
+
+static void socat_bufadapt(int d, ssize_t bytes);
+
+#if HAVE_RECVMMSG && HAVE_SENDMMSG
+/* option -B: a direction between two datagram sockets receives up to
+   socat_opts.batch packets with one recvmmsg() and sends them with one
+   sendmmsg(). Each packet has its own slot of bufsiz bytes, so the packet
+   boundaries are kept. Packets that the output did not accept stay in their
+   slots, xferbuf[].bytes counts their bytes */
+struct socat_mmsg {
+   struct mmsghdr *rmsgs;	/* for recvmmsg(), one per slot */
+   struct iovec *riov;
+   union sockaddr_union *from;	/* sender of each packet */
+   struct mmsghdr *smsgs;	/* for sendmmsg(), the packets to pass on */
+   struct iovec *siov;
+   unsigned int first;	/* first packet in smsgs not yet sent */
+   unsigned int num;	/* number of packets in smsgs */
+   bool checkpeer;	/* input is XIOREAD_RECV: check the senders */
+} ;
+
+static bool socat_maymmsg(xiofile_t *inpipe, xiofile_t *outpipe);
+static struct socat_mmsg *socat_mmsgalloc(xiofile_t *inpipe,
+					  xiofile_t *outpipe);
+static ssize_t socat_mmsgsend(xiofile_t *outpipe, bool righttoleft);
+static int xiotransfer_mmsg(xiofile_t *inpipe, xiofile_t *outpipe,
+			    bool righttoleft);
+#endif /* HAVE_RECVMMSG && HAVE_SENDMMSG */
+
+/* the output of -v and -x is formatted into dumpbuf and written to stderr
+   with one write() per block, or per SOCAT_DUMPBUFSIZ bytes of output */
+#define SOCAT_DUMPBUFSIZ 65536
+static char *dumpbuf;	/* Malloc()'ed in _socat() */
+static size_t dumplen;	/* bytes in dumpbuf */
+
+#if WITH_THREADS
+/* the threads of option multi serialize the output of -v and -x, and the
+   distribution of the connections to the loops; xiolockstate() protects sock[]
+   and the environment */
+static pthread_mutex_t socat_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define socat_multilock()   pthread_mutex_lock(&socat_mutex)
+#define socat_multiunlock() pthread_mutex_unlock(&socat_mutex)
+#else
+#define socat_multilock()
+#define socat_multiunlock()
+#endif /* !WITH_THREADS */
+
+#if WITH_EPOLL
+/* the epoll instance of the transfer loop; epfd -1 means xiopoll() */
+struct xioepoll socat_epoll = { -1 };
+#endif
+
+#if WITH_IO_URING
+static int socat_uring(void);
+#endif
+
+/* the pcapng capture of option -cf; fd -1 means no capture */
+struct xiopcapng socat_capture = { -1 };
+static int socat_captureopen(void);
+
+static ssize_t socat_flushunwritten(xiofile_t *outpipe, bool righttoleft);
+static void socat_transferfree(void);
+static void socat_grocheck(xiofile_t *sock, size_t bufsiz);
+
 /* here we come when the sockets are opened (in the meaning of C language),
    and their options are set/applied
    returns -1 on error or 0 on success */
@@ -718,7 +1001,6 @@ int _socat(void) {
        *fd2in  = &fds[2],
        *fd2out = &fds[3];
    int retval;
-   unsigned char *buff;
    ssize_t bytes1, bytes2;
    int polling = 0;	/* handling ignoreeof */
    int wasaction = 1;	/* last poll was active, do NOT sleep before next */
@@ -753,9 +1035,63 @@ int _socat(void) {
    }
 #endif /* WITH_FILAN */
 
+   /* with -b auto each direction starts with the smallest read size */
+   xferbuf[0].bufsiz = xferbuf[1].bufsiz =
+      socat_opts.bufauto ? socat_opts.bufmin : socat_opts.bufsiz;
+   xferbuf[0].peak = xferbuf[1].peak = xferbuf[0].bufsiz;
+   socat_grocheck(sock1, xferbuf[0].bufsiz);
+   socat_grocheck(sock2, xferbuf[1].bufsiz);
+   if (socat_opts.bufauto) {
+      Info3("adaptive read buffer size "F_Zu" bytes ("F_Zu".."F_Zu")",
+	    xferbuf[0].bufsiz, socat_opts.bufmin, socat_opts.bufsiz);
+   }
    /* when converting nl to crnl, size might double */
-   buff = Malloc(2*socat_opts.bufsiz+1);
-   if (buff == NULL)  return -1;
+   if (!socat_opts.righttoleft) {
+      if ((xferbuf[0].buff = Malloc(2*xferbuf[0].bufsiz+1)) == NULL) {
+	 return -1;
+      }
+   }
+   if (!socat_opts.lefttoright) {
+      if ((xferbuf[1].buff = Malloc(2*xferbuf[1].bufsiz+1)) == NULL) {
+	 socat_transferfree();
+	 return -1;
+      }
+   }
+   /* converting to CRLF makes the data longer; cv_newline() converts it into
+      a second buffer */
+   if (xferbuf[0].buff != NULL &&
+       XIO_RDSTREAM(sock1)->lineterm != LINETERM_CRNL &&
+       XIO_WRSTREAM(sock2)->lineterm == LINETERM_CRNL) {
+      if ((xferbuf[0].scratch = Malloc(2*xferbuf[0].bufsiz+1)) == NULL) {
+	 socat_transferfree();
+	 return -1;
+      }
+   }
+   if (xferbuf[1].buff != NULL &&
+       XIO_RDSTREAM(sock2)->lineterm != LINETERM_CRNL &&
+       XIO_WRSTREAM(sock1)->lineterm == LINETERM_CRNL) {
+      if ((xferbuf[1].scratch = Malloc(2*xferbuf[1].bufsiz+1)) == NULL) {
+	 socat_transferfree();
+	 return -1;
+      }
+   }
+
+   if ((socat_opts.verbose || socat_opts.verbhex) &&
+       (dumpbuf = Malloc(SOCAT_DUMPBUFSIZ)) == NULL) {
+      socat_transferfree();
+      return -1;
+   }
+
+   if (socat_opts.capfile != NULL && socat_captureopen() < 0) {
+      socat_transferfree();
+      return -1;
+   }
+
+#if WITH_EPOLL
+   if (socat_opts.pollmethod == XIOPOLL_EPOLL) {
+      xioepoll_init(&socat_epoll);
+   }
+#endif
 
    if (socat_opts.logopt == 'm' && xioinqopt('l', NULL, 0) == 'm') {
       Info("switching to syslog");
@@ -764,11 +1100,54 @@ int _socat(void) {
    }
    total_timeout = socat_opts.total_timeout;
 
+#if WITH_IO_URING
+   if (socat_opts.pollmethod == XIOPOLL_IO_URING) {
+      if ((retval = socat_uring()) <= 0) {
+	 if (retval == 0) {
+	    xioclose(sock1);
+	    xioclose(sock2);
+	 }
+	 socat_transferfree();
+	 return retval;
+      }
+      /* not applicable, use the poll loop */
+   }
+#endif /* WITH_IO_URING */
+
+#if HAVE_RECVMMSG && HAVE_SENDMMSG
+   /* datagram to datagram directions transfer batches of packets */
+   if (XIO_READABLE(sock1) && XIO_WRITABLE(sock2) && !socat_opts.righttoleft &&
+       socat_maymmsg(sock1, sock2)) {
+      xferbuf[0].mmsg = socat_mmsgalloc(sock1, sock2);
+   }
+   if (XIO_READABLE(sock2) && XIO_WRITABLE(sock1) && !socat_opts.lefttoright &&
+       socat_maymmsg(sock2, sock1)) {
+      xferbuf[1].mmsg = socat_mmsgalloc(sock2, sock1);
+   }
+#endif /* HAVE_RECVMMSG && HAVE_SENDMMSG */
+
+#if HAVE_SPLICE
+   /* plain stream to stream directions do not need to see the data */
+   if (XIO_READABLE(sock1) && XIO_WRITABLE(sock2) && !socat_opts.righttoleft &&
+       xferbuf[0].mmsg == NULL && socat_maysplice(sock1, sock2)) {
+      socat_splicepipe(splicepipe[0]);
+   }
+   if (XIO_READABLE(sock2) && XIO_WRITABLE(sock1) && !socat_opts.lefttoright &&
+       xferbuf[1].mmsg == NULL && socat_maysplice(sock2, sock1)) {
+      socat_splicepipe(splicepipe[1]);
+   }
+#endif /* HAVE_SPLICE */
+
+   /* a recvfrom address holds the packet that it read while opening */
+   if (XIO_READABLE(sock1) && xiopending(sock1) > 0)  mayrd1 = true;
+   if (XIO_READABLE(sock2) && xiopending(sock2) > 0)  mayrd2 = true;
+
    Notice4("starting data transfer loop with FDs [%d,%d] and [%d,%d]",
 	   XIO_GETRDFD(sock1), XIO_GETWRFD(sock1),
 	   XIO_GETRDFD(sock2), XIO_GETWRFD(sock2));
    while (XIO_RDSTREAM(sock1)->eof <= 1 ||
-	  XIO_RDSTREAM(sock2)->eof <= 1) {
+	  XIO_RDSTREAM(sock2)->eof <= 1 ||
+	  xferbuf[0].bytes || xferbuf[1].bytes) {
       struct timeval timeout, *to = NULL;
 
       Debug6("data loop: sock1->eof=%d, sock2->eof=%d, closing=%d, wasaction=%d, total_to={"F_tv_sec"."F_tv_usec"}",
@@ -790,7 +1169,7 @@ int _socat(void) {
 	       if (total_timeout.tv_sec < 0 ||
 		   total_timeout.tv_sec == 0 && total_timeout.tv_usec < 0) {
 		  Notice("inactivity timeout triggered");
-		  free(buff);
+		  socat_transferfree();
 		  return 0;
 	       }
 	    }
@@ -844,11 +1223,14 @@ int _socat(void) {
 	    }
 	 }
 
-	 /* now the fds will be assigned */
+	 /* now the fds will be assigned; a direction with unwritten data
+	    waits only for its output */
 	 if (XIO_READABLE(sock1) &&
 	     !(XIO_RDSTREAM(sock1)->eof > 1 && !XIO_RDSTREAM(sock1)->ignoreeof) &&
-	     !socat_opts.righttoleft) {
-	    if (!mayrd1 && !(XIO_RDSTREAM(sock1)->eof > 1)) {
+	     !socat_opts.righttoleft ||
+	     xferbuf[0].bytes) {
+	    if (!mayrd1 && !(XIO_RDSTREAM(sock1)->eof > 1) &&
+		xferbuf[0].bytes == 0) {
 		fd1in->fd = XIO_GETRDFD(sock1);
 		fd1in->events = POLLIN;
 	    } else {
@@ -866,8 +1248,10 @@ int _socat(void) {
 	 }
 	 if (XIO_READABLE(sock2) &&
 	     !(XIO_RDSTREAM(sock2)->eof > 1 && !XIO_RDSTREAM(sock2)->ignoreeof) &&
-	     !socat_opts.lefttoright) {
-	    if (!mayrd2 && !(XIO_RDSTREAM(sock2)->eof > 1)) {
+	     !socat_opts.lefttoright ||
+	     xferbuf[1].bytes) {
+	    if (!mayrd2 && !(XIO_RDSTREAM(sock2)->eof > 1) &&
+		xferbuf[1].bytes == 0) {
 		fd2in->fd = XIO_GETRDFD(sock2);
 		fd2in->events = POLLIN;
 	    } else {
@@ -884,7 +1268,11 @@ int _socat(void) {
 	     fd2in->fd = -1;
 	 }
 	 /* frame 0: innermost part of the transfer loop: check FD status */
+#if WITH_EPOLL
+	 retval = xioepoll(&socat_epoll, fds, 4, to);
+#else
 	 retval = xiopoll(fds, 4, to);
+#endif
 	 if (retval >= 0 || errno != EINTR) {
 	    break;
 	 }
@@ -903,7 +1291,7 @@ int _socat(void) {
 		 fds[0].fd, fds[0].events, fds[1].fd, fds[1].events,
 		 fds[2].fd, fds[2].events, fds[3].fd, fds[3].events,
 		 timeout.tv_sec, timeout.tv_usec, strerror(errno));
-		  free(buff);
+		  socat_transferfree();
 	    return -1;
       } else if (retval == 0) {
 	 Info2("poll timed out (no data within %ld.%06ld seconds)",
@@ -925,7 +1313,7 @@ int _socat(void) {
 		    socat_opts.total_timeout.tv_usec != 0) {
 	    /* there was a total inactivity timeout */
 	    Notice("inactivity timeout triggered");
-		  free(buff);
+		  socat_transferfree();
 	    return 0;
 	 }
 
@@ -944,7 +1332,7 @@ int _socat(void) {
 	       named pipe. a read() might imm. return with 0 bytes, resulting
 	       in a loop? */ 
 	    Error1("poll(...[%d]: invalid request", fd1in->fd);
-		  free(buff);
+		  socat_transferfree();
 	    return -1;
 	 }
 	 mayrd1 = true;
@@ -953,7 +1341,7 @@ int _socat(void) {
 	  (fd2in->revents)) {
 	 if (fd2in->revents & POLLNVAL) {
 	    Error1("poll(...[%d]: invalid request", fd2in->fd);
-		  free(buff);
+		  socat_transferfree();
 	    return -1;
 	 }
 	 mayrd2 = true;
@@ -961,7 +1349,7 @@ int _socat(void) {
       if (XIO_GETWRFD(sock1) >= 0 && fd1out->fd >= 0 && fd1out->revents) {
 	 if (fd1out->revents & POLLNVAL) {
 	    Error1("poll(...[%d]: invalid request", fd1out->fd);
-		  free(buff);
+		  socat_transferfree();
 	    return -1;
 	 }
 	 maywr1 = true;
@@ -969,15 +1357,33 @@ int _socat(void) {
       if (XIO_GETWRFD(sock2) >= 0 && fd2out->fd >= 0 && fd2out->revents) {
 	 if (fd2out->revents & POLLNVAL) {
 	    Error1("poll(...[%d]: invalid request", fd2out->fd);
-		  free(buff);
+		  socat_transferfree();
 	    return -1;
 	 }
 	 maywr2 = true;
       }
 
-      if (mayrd1 && maywr2) {
+      if (xferbuf[0].bytes && maywr2) {
+	 /* first get rid of the data that is still waiting */
+	 maywr2 = false;
+	 if ((bytes1 = socat_flushunwritten(sock2, false)) < 0) {
+	    if (errno != EAGAIN) {
+	       closing = MAX(closing, 1);
+	       Notice("socket 1 to socket 2 is in error");
+	       if (socat_opts.lefttoright) {
+		  break;
+	       }
+	    }
+	 } else {
+	    total_timeout = socat_opts.total_timeout;
+	    wasaction = 1;
+	    if (xferbuf[0].bytes == 0 && XIO_RDSTREAM(sock1)->actescape) {
+	       bytes1 = 0;	/* indicate EOF */
+	    }
+	 }
+      } else if (mayrd1 && maywr2) {
 	 mayrd1 = false;
-	 if ((bytes1 = xiotransfer(sock1, sock2, &buff, socat_opts.bufsiz, false))
+	 if ((bytes1 = xiotransfer(sock1, sock2, &xferbuf[0].buff, xferbuf[0].bufsiz, false))
 	     < 0) {
 	    if (errno != EAGAIN) {
 	       closing = MAX(closing, 1);
@@ -998,7 +1404,7 @@ int _socat(void) {
 	       mayrd1 = true;
 	    }
 	    /* escape char occurred? */
-	    if (XIO_RDSTREAM(sock1)->actescape) {
+	    if (XIO_RDSTREAM(sock1)->actescape && xferbuf[0].bytes == 0) {
 	       bytes1 = 0;	/* indicate EOF */
 	    }
 	 }
@@ -1007,9 +1413,26 @@ int _socat(void) {
 	 bytes1 = -1;
       }
 
-      if (mayrd2 && maywr1) {
+      if (xferbuf[1].bytes && maywr1) {
+	 maywr1 = false;
+	 if ((bytes2 = socat_flushunwritten(sock1, true)) < 0) {
+	    if (errno != EAGAIN) {
+	       closing = MAX(closing, 1);
+	       Notice("socket 2 to socket 1 is in error");
+	       if (socat_opts.righttoleft) {
+		  break;
+	       }
+	    }
+	 } else {
+	    total_timeout = socat_opts.total_timeout;
+	    wasaction = 1;
+	    if (xferbuf[1].bytes == 0 && XIO_RDSTREAM(sock2)->actescape) {
+	       bytes2 = 0;	/* indicate EOF */
+	    }
+	 }
+      } else if (mayrd2 && maywr1) {
 	 mayrd2 = false;
-	 if ((bytes2 = xiotransfer(sock2, sock1, &buff, socat_opts.bufsiz, true))
+	 if ((bytes2 = xiotransfer(sock2, sock1, &xferbuf[1].buff, xferbuf[1].bufsiz, true))
 	     < 0) {
 	    if (errno != EAGAIN) {
 	       closing = MAX(closing, 1);
@@ -1030,7 +1453,7 @@ int _socat(void) {
 	       mayrd2 = true;
 	    }          
 	    /* escape char occurred? */
-	    if (XIO_RDSTREAM(sock2)->actescape) {
+	    if (XIO_RDSTREAM(sock2)->actescape && xferbuf[1].bytes == 0) {
 	       bytes2 = 0;	/* indicate EOF */
 	    }
 	 }
@@ -1044,7 +1467,9 @@ int _socat(void) {
       /*0 Debug4("bytes1=F_Zd, XIO_RDSTREAM(sock1)->eof=%d, XIO_RDSTREAM(sock1)->ignoreeof=%d, closing=%d",
 	     bytes1, XIO_RDSTREAM(sock1)->eof, XIO_RDSTREAM(sock1)->ignoreeof,
 	     closing);*/
-      if (bytes1 == 0 || XIO_RDSTREAM(sock1)->eof >= 2) {
+      /* an EOF is passed on only after all data has been written */
+      if ((bytes1 == 0 || XIO_RDSTREAM(sock1)->eof >= 2) &&
+	  xferbuf[0].bytes == 0) {
 	 if (XIO_RDSTREAM(sock1)->ignoreeof &&
 	     !XIO_RDSTREAM(sock1)->actescape && !closing) {
 	    Debug1("socket 1 (fd %d) is at EOF, ignoring",
@@ -1060,14 +1485,15 @@ int _socat(void) {
       } else if (polling && XIO_RDSTREAM(sock1)->ignoreeof) {
 	 polling = 0;
       }
-      if (XIO_RDSTREAM(sock1)->eof >= 2) {
+      if (XIO_RDSTREAM(sock1)->eof >= 2 && xferbuf[0].bytes == 0) {
 	 if (socat_opts.lefttoright) {
 	    break;
 	 }
 	 closing = 1;
       }
 
-      if (bytes2 == 0 || XIO_RDSTREAM(sock2)->eof >= 2) {
+      if ((bytes2 == 0 || XIO_RDSTREAM(sock2)->eof >= 2) &&
+	  xferbuf[1].bytes == 0) {
 	 if (XIO_RDSTREAM(sock2)->ignoreeof &&
 	     !XIO_RDSTREAM(sock2)->actescape && !closing) {
 	    Debug1("socket 2 (fd %d) is at EOF, ignoring",
@@ -1083,7 +1509,7 @@ int _socat(void) {
       } else if (polling && XIO_RDSTREAM(sock2)->ignoreeof) {
 	 polling = 0;
       }
-      if (XIO_RDSTREAM(sock2)->eof >= 2) {
+      if (XIO_RDSTREAM(sock2)->eof >= 2 && xferbuf[1].bytes == 0) {
 	 if (socat_opts.righttoleft) {
 	    break;
 	 }
@@ -1095,7 +1521,7 @@ int _socat(void) {
    xioclose(sock1);
    xioclose(sock2);
 
-		  free(buff);
+		  socat_transferfree();
    return 0;
 }
 
@@ -1121,7 +1547,16 @@ int gettimestamp(char *timestamp) {
    } else {
       nowt = now.tv_sec;
 #if HAVE_STRFTIME
-      bytes = strftime(timestamp, 20, "%Y/%m/%d %H:%M:%S", localtime(&nowt));
+      /* localtime() and strftime() only once per second */
+      static time_t lastt = (time_t)-1;
+      static char lastsec[20];
+      if (nowt != lastt) {
+	 strftime(lastsec, sizeof(lastsec), "%Y/%m/%d %H:%M:%S",
+		  localtime(&nowt));
+	 lastt = nowt;
+      }
+      memcpy(timestamp, lastsec, 19);
+      bytes = 19;
       bytes += sprintf(timestamp+19, "."F_tv_usec" ", now.tv_usec);
 #else
       strcpy(timestamp, ctime(&nowt));
@@ -1147,34 +1582,155 @@ static const char *prefixltor = "> ";
 static const char *prefixrtol = "< ";
 static unsigned long numltor;
 static unsigned long numrtol;
-/* print block header (during verbose or hex dump)
+static const char hexdigits[] = "0123456789abcdef";
+
+/* writes the contents of dumpbuf to stderr.
+   returns 0 on success or -1 if an error occurred */
+static int socat_dumpflush(void) {
+   ssize_t writt = 0;
+
+   if (dumplen > 0) {
+      writt = writefull(fileno(stderr), dumpbuf, dumplen);
+      dumplen = 0;
+   }
+   return writt < 0 ? -1 : 0;
+}
+
+/* returns a pointer to at least len (<= SOCAT_DUMPBUFSIZ) free bytes at the
+   end of dumpbuf; the caller adds the bytes it used to dumplen */
+static char *socat_dumpspace(size_t len) {
+   if (dumplen + len > SOCAT_DUMPBUFSIZ) {
+      socat_dumpflush();
+   }
+   return dumpbuf + dumplen;
+}
+
+/* print block header (during verbose or hex dump) to dumpbuf
    returns 0 on success or -1 if an error occurred */
 static int
-   xioprintblockheader(FILE *file, size_t bytes, bool righttoleft) {
+   xioprintblockheader(size_t bytes, bool righttoleft) {
    char timestamp[MAXTIMESTAMPLEN];
-   char buff[128+MAXTIMESTAMPLEN];
+   char *buff = socat_dumpspace(128+MAXTIMESTAMPLEN);
    if (gettimestamp(timestamp) < 0) {
       return -1;
    }
    if (righttoleft) {
-      sprintf(buff, "%s%s length="F_Zu" from=%lu to=%lu\n",
+      dumplen += sprintf(buff, "%s%s length="F_Zu" from=%lu to=%lu\n",
 	      prefixrtol, timestamp, bytes, numrtol, numrtol+bytes-1);
       numrtol+=bytes;
    } else {
-      sprintf(buff, "%s%s length="F_Zu" from=%lu to=%lu\n",
+      dumplen += sprintf(buff, "%s%s length="F_Zu" from=%lu to=%lu\n",
 	      prefixltor, timestamp, bytes, numltor, numltor+bytes-1);
       numltor+=bytes;
    }
-   fputs(buff, file);
    return 0;
 }
 
+/* formats the block of data like -v (text), -x (hex), or both (hex dump with
+   text column) request and writes it to stderr */
+static void xioprintblock(const unsigned char *data, size_t bytes,
+			  bool righttoleft) {
+   const unsigned char *s = data, *end = data+bytes;
+   char *p;
+
+   xioprintblockheader(bytes, righttoleft);
+   if (socat_opts.verbose && socat_opts.verbhex) {
+      /* lines of at most N bytes, and ending after LF */
+      const size_t N = 16;
+      const unsigned char *t;
+      size_t i, j;
+      while (s < end) {
+	 /*! prefix? */
+	 j = Min(N, (size_t)(end-s));
+	 p = socat_dumpspace(4*N+3);
+
+	 /* print hex */
+	 t = s;
+	 i = 0;
+	 while (i < j) {
+	    int c = *t++;
+	    *p++ = ' ';
+	    *p++ = hexdigits[c>>4];
+	    *p++ = hexdigits[c&0x0f];
+	    ++i;
+	    if (c == '\n')  break;
+	 }
+
+	 /* fill hex column */
+	 memset(p, ' ', 3*(N-i)+2);
+	 p += 3*(N-i)+2;
+
+	 /* print acsii */
+	 t = s;
+	 i = 0;
+	 while (i < j) {
+	    int c = *t++;
+	    if (c == '\n') {
+	       *p++ = '.';
+	       break;
+	    }
+	    *p++ = isprint(c) ? c : '.';
+	    ++i;
+	 }
+
+	 *p++ = '\n';
+	 dumplen = p - dumpbuf;
+	 s = t;
+      }
+      p = socat_dumpspace(3);
+      memcpy(p, "--\n", 3);
+      dumplen += 3;
+   } else if (socat_opts.verbose) {
+      while (s < end) {
+	 /* at most two characters per byte */
+	 const unsigned char *z = s + Min((size_t)(end-s), SOCAT_DUMPBUFSIZ/4);
+	 p = socat_dumpspace(2*(z-s));
+	 while (s < z) {
+	    int c = *s++;
+	    switch (c) {
+	    case '\a' : *p++ = '\\'; *p++ = 'a'; break;
+	    case '\b' : *p++ = '\\'; *p++ = 'b'; break;
+	    case '\t' : *p++ = '\t'; break;
+	    case '\n' : *p++ = '\n'; break;
+	    case '\v' : *p++ = '\\'; *p++ = 'v'; break;
+	    case '\f' : *p++ = '\\'; *p++ = 'f'; break;
+	    case '\r' : *p++ = '\\'; *p++ = 'r'; break;
+	    case '\\' : *p++ = '\\'; *p++ = '\\'; break;
+	    default:
+	       *p++ = isprint(c) ? c : '.';
+	       break;
+	    }
+	 }
+	 dumplen = p - dumpbuf;
+      }
+   } else if (socat_opts.verbhex) {
+      while (s < end) {
+	 const unsigned char *z = s + Min((size_t)(end-s), SOCAT_DUMPBUFSIZ/4);
+	 p = socat_dumpspace(3*(z-s)+1);
+	 while (s < z) {
+	    int c = *s++;
+	    *p++ = ' ';
+	    *p++ = hexdigits[c>>4];
+	    *p++ = hexdigits[c&0x0f];
+	 }
+	 dumplen = p - dumpbuf;
+      }
+      p = socat_dumpspace(1);
+      *p = '\n';
+      ++dumplen;
+   }
+   socat_dumpflush();
+}
+
 
 /* inpipe is suspected to have read data available; read at most bufsiz bytes
    and transfer them to outpipe. Perform required data conversions.
    buff must be a malloc()'ed storage and might be realloc()'ed in this
    function if more space is required after conversions. 
-   Returns the number of bytes written, or 0 on EOF or <0 if an
+   Data that outpipe does not accept now is left in buff and described by
+   xferbuf[righttoleft]; the caller must flush it before calling this function
+   again for this direction.
+   Returns the number of bytes written or kept, or 0 on EOF or <0 if an
    error occurred or when data was read but none written due to conversions
    (with EAGAIN). EAGAIN also occurs when reading from a nonblocking FD where
    the file has a mandatory lock.
@@ -1184,7 +1740,20 @@ static int
 /* inpipe, outpipe must be single descriptors (not dual!) */
 int xiotransfer(xiofile_t *inpipe, xiofile_t *outpipe,
 		unsigned char **buff, size_t bufsiz, bool righttoleft) {
-   ssize_t bytes, writt = 0;
+   ssize_t bytes;
+
+#if HAVE_SPLICE
+   if (splicepipe[righttoleft][0] >= 0) {
+      /* the data stays in the kernel, so -b auto needs no adaptation */
+      return xiotransfer_splice(inpipe, outpipe, splicepipe[righttoleft],
+				buff, socat_opts.bufsiz, righttoleft);
+   }
+#endif /* HAVE_SPLICE */
+#if HAVE_RECVMMSG && HAVE_SENDMMSG
+   if (xferbuf[righttoleft].mmsg != NULL) {
+      return xiotransfer_mmsg(inpipe, outpipe, righttoleft);
+   }
+#endif /* HAVE_RECVMMSG && HAVE_SENDMMSG */
 
 	 bytes = xioread(inpipe, *buff, bufsiz);
 	 if (bytes < 0) {
@@ -1193,6 +1762,9 @@ int xiotransfer(xiofile_t *inpipe, xiofile_t *outpipe,
 	    /*xioshutdown(inpipe, SHUT_RD);*/
 	    return -1;
 	 }
+	 if (socat_opts.bufauto) {
+	    socat_bufadapt(righttoleft, bytes);
+	 }
 	 if (bytes == 0 && XIO_RDSTREAM(inpipe)->ignoreeof && !closing) {
 	    ;
 	 } else if (bytes == 0) {
@@ -1203,227 +1775,2523 @@ int xiotransfer(xiofile_t *inpipe, xiofile_t *outpipe,
 	 if (bytes > 0) {
 	    /* handle escape char */
 	    if (XIO_RDSTREAM(inpipe)->escape != -1) {
-	       /* check input data for escape char */
-	       unsigned char *ptr = *buff;
-	       size_t ctr = 0;
-	       while (ctr < bytes) {
-		  if (*ptr == XIO_RDSTREAM(inpipe)->escape) {
-		     /* found: set flag, truncate input data */
-		     XIO_RDSTREAM(inpipe)->actescape = true;
-		     bytes = ctr;
-		     Info("escape char found in input");
-		     break;
-		  }
-		  ++ptr; ++ctr;
-	       }
-	       if (ctr != bytes) {
-		  XIO_RDSTREAM(inpipe)->eof = 2;
+	       /* check input data for escape char; memchr() is vectorized in
+		  the C library */
+	       unsigned char *ptr;
+	       if ((ptr = memchr(*buff, XIO_RDSTREAM(inpipe)->escape, bytes))
+		   != NULL) {
+		  /* found: set flag, truncate input data */
+		  XIO_RDSTREAM(inpipe)->actescape = true;
+		  bytes = ptr - *buff;
+		  Info("escape char found in input");
 	       }
 	    }
 	 }
 
-	    if (bytes > 0) {
-
-	    if (XIO_RDSTREAM(inpipe)->lineterm !=
-		XIO_WRSTREAM(outpipe)->lineterm) {
-	       cv_newline(buff, &bytes,
-			  XIO_RDSTREAM(inpipe)->lineterm,
-			  XIO_WRSTREAM(outpipe)->lineterm);
-	    }
-	    if (bytes == 0) {
-	       errno = EAGAIN;  return -1;
-	    }
+	 if (bytes > 0) {
+	    return xiotransfer_block(inpipe, outpipe, buff, bytes,
+				     righttoleft);
+	 }
+   return 0;
+}
 
-	    if (socat_opts.verbose && socat_opts.verbhex) {
-	       /* Hack-o-rama */
-	       size_t i = 0;
-	       size_t j;
-	       size_t N = 16;
-	       const unsigned char *end, *s, *t;
-	       s = *buff;
-	       end = (*buff)+bytes;
-	       xioprintblockheader(stderr, bytes, righttoleft);
-	       while (s < end) {
-		  /*! prefix? */
-		  j = Min(N, (size_t)(end-s));
-
-		  /* print hex */
-		  t = s;
-		  i = 0;
-		  while (i < j) {
-		     int c = *t++;
-		     fprintf(stderr, " %02x", c);
-		     ++i;
-		     if (c == '\n')  break;
-		  }
+/* the second part of xiotransfer(): converts the bytes of data read from
+   inpipe in *buff, dumps them, and writes them to outpipe.
+   Returns like xiotransfer() */
+static int xiotransfer_block(xiofile_t *inpipe, xiofile_t *outpipe,
+			     unsigned char **buff, ssize_t bytes,
+			     bool righttoleft) {
+   size_t segsize = 0;	/* coalesced packet: size of its segments */
+   ssize_t writt;
 
-		  /* fill hex column */
-		  while (i < N) {
-		     fputs("   ", stderr);
-		     ++i;
-		  }
-		  fputs("  ", stderr);
-
-		  /* print acsii */
-		  t = s;
-		  i = 0;
-		  while (i < j) {
-		     int c = *t++;
-		     if (c == '\n') {
-			fputc('.', stderr);
-			break;
-		     }
-		     if (!isprint(c))
-			c = '.';
-		     fputc(c, stderr);
-		     ++i;
-		  }
+#if _WITH_SOCKET
+   segsize = XIO_RDSTREAM(inpipe)->segsize;
+#endif
+   if (XIO_RDSTREAM(inpipe)->lineterm !=
+       XIO_WRSTREAM(outpipe)->lineterm) {
+      cv_newline(buff, &xferbuf[righttoleft].scratch, &bytes,
+		 XIO_RDSTREAM(inpipe)->lineterm,
+		 XIO_WRSTREAM(outpipe)->lineterm);
+      segsize = 0;	/* the conversion moved the segment boundaries */
+   }
+   if (bytes == 0) {
+      errno = EAGAIN;  return -1;
+   }
 
-		  fputc('\n', stderr);
-		  s = t;
-	       }
-	       fputs("--\n", stderr);
-	    } else if (socat_opts.verbose) {
-	       size_t i = 0;
-	       xioprintblockheader(stderr, bytes, righttoleft);
-	       while (i < (size_t)bytes) {
-		  int c = (*buff)[i];
-		  if (i > 0 && (*buff)[i-1] == '\n')
-		     /*! prefix? */;
-		  switch (c) {
-		  case '\a' : fputs("\\a", stderr); break;
-		  case '\b' : fputs("\\b", stderr); break;
-		  case '\t' : fputs("\t", stderr); break;
-		  case '\n' : fputs("\n", stderr); break;
-		  case '\v' : fputs("\\v", stderr); break;
-		  case '\f' : fputs("\\f", stderr); break;
-		  case '\r' : fputs("\\r", stderr); break;
-		  case '\\' : fputs("\\\\", stderr); break;
-		  default:
-		     if (!isprint(c))
-			c = '.';
-		     fputc(c, stderr);
-		     break;
-		  }
-		  ++i;
-	       }
-	    } else if (socat_opts.verbhex) {
-	       int i;
-	       /* print prefix */
-	       xioprintblockheader(stderr, bytes, righttoleft);
-	       for (i = 0; i < bytes; ++i) {
-		  fprintf(stderr, " %02x", (*buff)[i]);
-	       }
-	       fputc('\n', stderr);
-	    }
+   if (socat_opts.verbose || socat_opts.verbhex) {
+      socat_multilock();
+      xioprintblock(*buff, bytes, righttoleft);
+      socat_multiunlock();
+   }
+   if (socat_capture.fd >= 0) {
+      xiopcapng_block(&socat_capture, righttoleft, XIOPCAPNG_INBOUND,
+		      *buff, bytes);
+   }
 
-	    writt = xiowrite(outpipe, *buff, bytes);
-	    if (writt < 0) {
-	       /* EAGAIN when nonblocking but a mandatory lock is on file.
-		  the problem with EAGAIN is that the read cannot be repeated,
-		  so we need to buffer the data and try to write it later
-		  again. not yet implemented, sorry. */
+   writt = xiowritesegs(outpipe, *buff, bytes, segsize);
+   if (writt < 0) {
 #if 0
-	       if (errno == EPIPE) {
-		  return 0;	/* can no longer write; handle like EOF */
-	       }
+      if (errno == EPIPE) {
+	 return 0;	/* can no longer write; handle like EOF */
+      }
 #endif
-	       return -1;
-	    } else {
-	       Info3("transferred "F_Zu" bytes from %d to %d",
-		     writt, XIO_GETRDFD(inpipe), XIO_GETWRFD(outpipe));
-	    }
-	 }
-   return writt;
+      return -1;
+   }
+   Info3("transferred "F_Zu" bytes from %d to %d",
+	 writt, XIO_GETRDFD(inpipe), XIO_GETWRFD(outpipe));
+   if (writt < bytes) {
+      /* EAGAIN when nonblocking, or a mandatory lock is on file. the
+	 read cannot be repeated, so keep the data and write it when
+	 poll() reports the FD writeable again */
+      xferbuf[righttoleft].ptr   = *buff+writt;
+      xferbuf[righttoleft].bytes = bytes-writt;
+      xferbuf[righttoleft].segsize = segsize;
+      Info1("keeping "F_Zu" unwritten bytes", bytes-writt);
+   }
+   return bytes;
 }
 
-#define CR '\r'
-#define LF '\n'
 
+/* opens the capture file of option -cf and describes the two sockets; the
+   blocks read from socket 1 are recorded on interface 0, those from socket 2
+   on interface 1.
+   returns 0 on success or -1 if an error occurred */
+static int socat_captureopen(void) {
+   xiofile_t *socks[2];
+   char name[16], descr[256];
+   int i;
 
-/* converts the newline characters (or character sequences) from the one
-   specified in lineterm1 to that of lineterm2. Possible values are
-   LINETERM_CR, LINETERM_CRNL, LINETERM_RAW.
-   buff points to the malloc()'ed data, input and output. It may be subject to
-   realloc(). bytes specifies the number of bytes input and output */
-int cv_newline(unsigned char **buff, ssize_t *bufsiz,
-	       int lineterm1, int lineterm2) {
-   ssize_t *bytes = bufsiz;
-   /* must perform newline changes */
-   if (lineterm1 <= LINETERM_CR && lineterm2 <= LINETERM_CR) {
-      /* no change in data length */
-      unsigned char from, to,  *p, *z;
-      if (lineterm1 == LINETERM_RAW) {
-	 from = '\n'; to = '\r';
-      } else {
-	 from = '\r'; to = '\n';
-      }
-      z = *buff + *bytes;
-      p = *buff;
-      while (p < z) {
-	 if (*p == from)  *p = to;
-	 ++p;
-      }
+   socks[0] = sock1;  socks[1] = sock2;
+   if (xiopcapng_open(&socat_capture, socat_opts.capfile,
+		      socat_opts.caprotate) < 0) {
+      return -1;
+   }
+   for (i = 0; i < 2; ++i) {
+      struct single *pipe = XIO_RDSTREAM(socks[i]);
+#if _WITH_SOCKET
+      union sockaddr_union sa;
+      socklen_t salen = sizeof(sa);
+#endif /* _WITH_SOCKET */
 
-   } else if (lineterm1 == LINETERM_CRNL) {
-      /* buffer becomes shorter */
-      unsigned char to,  *s, *t, *z;
-      if (lineterm2 == LINETERM_RAW) {
-	 to = '\n';
-      } else {
-	 to = '\r';
-      }
-      z = *buff + *bytes;
-      s = t = *buff;
-      while (s < z) {
-	 if (*s == '\r') {
-	    ++s;
-	    continue;
-	 }
-	 if (*s == '\n') {
-	    *t++ = to; ++s;
-	 } else {
-	    *t++ = *s++;
-	 }
-      }
-      *bufsiz = t - *buff;
-   } else {
-      /* buffer becomes longer, must alloc another space */
-      unsigned char *buf2;
-      unsigned char from;  unsigned char *s, *t, *z;
-      if (lineterm1 == LINETERM_RAW) {
-	 from = '\n';
-      } else {
-	 from = '\r';
-      }
-      if ((buf2 = Malloc(2*socat_opts.bufsiz/*sic!*/+1)) == NULL) {
+      snprintf(name, sizeof(name), "socket %d", i+1);
+#if _WITH_SOCKET
+      /* the peer address known from connect() or recvfrom(), else ask the
+	 socket (e.g. after accept()) */
+      if (pipe->salen > 0) {
+	 sockaddr_info(&pipe->peersa.soa, pipe->salen, descr, sizeof(descr));
+      } else if (Getpeername(XIO_GETRDFD(socks[i]), &sa.soa, &salen) == 0) {
+	 sockaddr_info(&sa.soa, salen, descr, sizeof(descr));
+      } else
+#endif /* _WITH_SOCKET */
+	 snprintf(descr, sizeof(descr), "fd %d", XIO_GETRDFD(socks[i]));
+      if (xiopcapng_interface(&socat_capture, name, descr) < 0) {
+	 xiopcapng_close(&socat_capture);
 	 return -1;
       }
-      s = *buff;  t = buf2;  z = *buff + *bytes;
-      while (s < z) {
-	 if (*s == from) {
-	    *t++ = '\r'; *t++ = '\n';
-	    ++s;
-	    continue;
-	 } else {
-	    *t++ = *s++;
-	 }
-      }
-      free(*buff);
-      *buff = buf2;
-      *bufsiz = t - buf2;;
    }
    return 0;
 }
 
-void socat_signal(int signum) {
-   int _errno;
-   _errno = errno;
-   diag_in_handler = 1;
-   Notice1("socat_signal(): handling signal %d", signum);
-   switch (signum) {
-   case SIGQUIT:
-   case SIGILL:
+/* writes the collected blocks of the capture when socat exits in the
+   transfer loop */
+static void socat_captureclose(void) {
+   xiopcapng_close(&socat_capture);
+}
+
+/* the kernel truncates coalesced packets of option udp-gro that do not fit
+   the read buffer; warns when bufsiz is smaller than the largest packet */
+static void socat_grocheck(xiofile_t *sock, size_t bufsiz) {
+#if _WITH_SOCKET
+   if (sock == NULL || !XIO_RDSTREAM(sock)->gro) {
+      return;
+   }
+   if (bufsiz < 65535) {
+      Warn1("option udp-gro: coalesced packets may be truncated to the read size of "F_Zu" bytes; use -b 65535",
+	    bufsiz);
+   }
+#endif /* _WITH_SOCKET */
+}
+
+/* releases the resources of the data transfer loop */
+static void socat_transferfree(void) {
+   int i;
+
+   for (i = 0; i < 2; ++i) {
+      if (socat_opts.bufauto && xferbuf[i].buff != NULL) {
+	 Info4("socket %d to socket %d: read buffer size at end "F_Zu" bytes, largest "F_Zu" bytes",
+	       i+1, 2-i, xferbuf[i].bufsiz, xferbuf[i].peak);
+      }
+      free(xferbuf[i].buff);
+      free(xferbuf[i].scratch);
+      free(xferbuf[i].mmsg);
+      xferbuf[i].buff = xferbuf[i].ptr = xferbuf[i].scratch = NULL;
+      xferbuf[i].mmsg = NULL;
+      xferbuf[i].bytes = 0;
+#if HAVE_SPLICE
+      if (splicepipe[i][0] >= 0) {
+	 Close(splicepipe[i][0]);  Close(splicepipe[i][1]);
+	 splicepipe[i][0] = splicepipe[i][1] = -1;
+      }
+#endif /* HAVE_SPLICE */
+   }
+   free(dumpbuf);
+   dumpbuf = NULL;
+   xiopcapng_close(&socat_capture);
+#if WITH_EPOLL
+   xioepoll_close(&socat_epoll);
+#endif
+}
+
+/* -b auto: adapts the read size of direction d to a read that returned bytes.
+   After SOCAT_BUFGROW consecutive reads that filled the buffer it is doubled,
+   after SOCAT_BUFSHRINK consecutive reads of less than a quarter of it it is
+   halved, within socat_opts.bufmin and socat_opts.bufsiz. The data just read
+   is kept in the reallocated buffer. */
+static void socat_bufadapt(int d, ssize_t bytes) {
+   size_t oldsiz = xferbuf[d].bufsiz, newsiz = oldsiz;
+   unsigned char *buff;
+
+   if (bytes <= 0) {
+      return;
+   }
+   if ((size_t)bytes >= oldsiz) {
+      xferbuf[d].nsmall = 0;
+      if (++xferbuf[d].nfull >= SOCAT_BUFGROW) {
+	 newsiz = Min(2*oldsiz, socat_opts.bufsiz);
+      }
+   } else if ((size_t)bytes < oldsiz/4) {
+      xferbuf[d].nfull = 0;
+      if (++xferbuf[d].nsmall >= SOCAT_BUFSHRINK) {
+	 newsiz = Max(oldsiz/2, socat_opts.bufmin);
+      }
+   } else {
+      xferbuf[d].nfull = xferbuf[d].nsmall = 0;
+   }
+   if (newsiz == oldsiz) {
+      return;
+   }
+   xferbuf[d].nfull = xferbuf[d].nsmall = 0;
+   if (newsiz < oldsiz) {
+      /* the buffers stay large enough even if realloc() fails */
+      xferbuf[d].bufsiz = newsiz;
+   }
+   /* when converting nl to crnl, size might double */
+   if ((buff = Realloc(xferbuf[d].buff, 2*newsiz+1)) == NULL) {
+      return;
+   }
+   xferbuf[d].buff = buff;
+   if (xferbuf[d].scratch != NULL) {
+      if ((buff = Realloc(xferbuf[d].scratch, 2*newsiz+1)) == NULL) {
+	 return;
+      }
+      xferbuf[d].scratch = buff;
+   }
+   xferbuf[d].bufsiz = newsiz;
+   xferbuf[d].peak = Max(xferbuf[d].peak, newsiz);
+   Info4("socket %d to socket %d: read buffer size %s to "F_Zu" bytes",
+	 d+1, 2-d, newsiz > oldsiz ? "increased" : "decreased", newsiz);
+}
+
+#if HAVE_SPLICE
+/* moves at most bytes bytes from the pipe pipefd to the write FD of outpipe,
+   without waiting for a nonblocking FD.
+   returns the number of bytes written, or <0 if an error occurred (errno is
+   EINVAL when the FD does not support splice()) */
+static ssize_t socat_splicewrite(xiofile_t *outpipe, int pipefd[2],
+				 size_t bytes) {
+   int outfd = XIO_GETWRFD(outpipe);
+   size_t writt = 0;
+   ssize_t chk;
+   int _errno;
+
+   while (writt < bytes) {
+      chk = Splice(pipefd[0], NULL, outfd, NULL, bytes-writt, SPLICE_F_MOVE);
+      if (chk >= 0) {
+	 writt += chk;
+	 continue;
+      }
+      _errno = errno;
+      switch (_errno) {
+      case EINTR:
+	 continue;
+      case EAGAIN:
+#if EAGAIN != EWOULDBLOCK
+      case EWOULDBLOCK:
+#endif
+	 Info4("splice(%d, NULL, %d, NULL, "F_Zu", ...): %s",
+	       pipefd[0], outfd, bytes-writt, strerror(_errno));
+	 return writt;
+      case EINVAL:
+	 if (writt > 0)  return writt;
+	 break;
+      case EPIPE:
+      case ECONNRESET:
+	 if (XIO_WRSTREAM(outpipe)->cool_write) {
+	    Notice4("splice(%d, NULL, %d, NULL, "F_Zu", ...): %s",
+		    pipefd[0], outfd, bytes-writt, strerror(_errno));
+	    break;
+	 }
+	 /*PASSTHROUGH*/
+      default:
+	 Error4("splice(%d, NULL, %d, NULL, "F_Zu", ...): %s",
+		pipefd[0], outfd, bytes-writt, strerror(_errno));
+      }
+      errno = _errno;
+      return -1;
+   }
+   return writt;
+}
+
+/* stops using splice() for the direction, e.g. when the kernel refuses it for
+   one of the FDs. unwritten data that is still in the pipe is moved to the
+   transfer buffer, and the classic transfer is used from now on.
+   returns 0 on success or -1 if an error occurred */
+static int socat_spliceend(bool righttoleft) {
+   int *pipefd = splicepipe[righttoleft];
+   size_t bytes = xferbuf[righttoleft].bytes, got = 0;
+   ssize_t chk;
+   int result = 0;
+
+   if (bytes > xferbuf[righttoleft].bufsiz) {
+      /* -b auto: splice() moved more than the current read size */
+      unsigned char *buff;
+      if ((buff = Realloc(xferbuf[righttoleft].buff, 2*bytes+1)) == NULL) {
+	 bytes = 0;
+	 result = -1;
+      } else {
+	 xferbuf[righttoleft].buff = buff;
+	 xferbuf[righttoleft].bufsiz = bytes;
+	 xferbuf[righttoleft].peak = Max(xferbuf[righttoleft].peak, bytes);
+      }
+   }
+   if (bytes > 0) {
+      while (got < bytes) {
+	 chk = Read(pipefd[0], xferbuf[righttoleft].buff+got, bytes-got);
+	 if (chk < 0 && errno == EINTR)  continue;
+	 if (chk <= 0) {
+	    Error3("read(%d, ...): lost "F_Zu" bytes in splice pipe: %s",
+		   pipefd[0], bytes-got, chk<0?strerror(errno):"EOF");
+	    result = -1;
+	    break;
+	 }
+	 got += chk;
+      }
+      xferbuf[righttoleft].ptr   = xferbuf[righttoleft].buff;
+      xferbuf[righttoleft].bytes = got;
+   }
+   Close(pipefd[0]);  Close(pipefd[1]);
+   pipefd[0] = pipefd[1] = -1;
+   return result;
+}
+#endif /* HAVE_SPLICE */
+
+/* tries to write the unwritten data of the direction to outpipe.
+   returns the number of bytes written; or <0 with errno EAGAIN when nothing
+   could be written, or <0 if an error occurred (the data is dropped) */
+static ssize_t socat_flushunwritten(xiofile_t *outpipe, bool righttoleft) {
+   ssize_t writt;
+
+#if HAVE_SPLICE
+   if (splicepipe[righttoleft][0] >= 0) {
+      writt = socat_splicewrite(outpipe, splicepipe[righttoleft],
+				xferbuf[righttoleft].bytes);
+      if (writt < 0 && errno == EINVAL) {
+	 /* output FD does not support splice(); write the data that is still
+	    in the pipe the classic way */
+	 Info1("splice(..., %d, ...): not supported, using write()",
+	       XIO_GETWRFD(outpipe));
+	 if (socat_spliceend(righttoleft) < 0) {
+	    return -1;
+	 }
+      } else {
+	 if (writt < 0) {
+	    xferbuf[righttoleft].bytes = 0;
+	    return -1;
+	 }
+	 xferbuf[righttoleft].bytes -= writt;
+	 if (writt == 0) {
+	    errno = EAGAIN;  return -1;
+	 }
+	 return writt;
+      }
+   }
+#endif /* HAVE_SPLICE */
+#if HAVE_RECVMMSG && HAVE_SENDMMSG
+   if (xferbuf[righttoleft].mmsg != NULL) {
+      return socat_mmsgsend(outpipe, righttoleft);
+   }
+#endif /* HAVE_RECVMMSG && HAVE_SENDMMSG */
+   writt = xiowritesegs(outpipe, xferbuf[righttoleft].ptr,
+			xferbuf[righttoleft].bytes,
+			xferbuf[righttoleft].segsize);
+   if (writt < 0) {
+      xferbuf[righttoleft].bytes = 0;
+      return -1;
+   }
+   Info2("transferred "F_Zu" unwritten bytes to %d",
+	 writt, XIO_GETWRFD(outpipe));
+   xferbuf[righttoleft].ptr   += writt;
+   xferbuf[righttoleft].bytes -= writt;
+   if (writt == 0) {
+      errno = EAGAIN;  return -1;
+   }
+   return writt;
+}
+
+#if HAVE_SPLICE
+/* checks if the transfer from inpipe to outpipe can bypass the user space
+   buffer: both sides must use plain read() and write(), and no data
+   conversion, escape check, byte count, or traffic dump may be active.
+   returns true if splice() may be used */
+static bool socat_maysplice(xiofile_t *inpipe, xiofile_t *outpipe) {
+   struct single *in  = XIO_RDSTREAM(inpipe);
+   struct single *out = XIO_WRSTREAM(outpipe);
+
+   if (socat_opts.verbose || socat_opts.verbhex || socat_capture.fd >= 0) {
+      return false;
+   }
+   if ((in->dtype & XIODATA_READMASK) != XIOREAD_STREAM) {
+      return false;
+   }
+   switch (out->dtype & XIODATA_WRITEMASK) {
+   case XIOWRITE_STREAM:
+   case XIOWRITE_PIPE:
+   case XIOWRITE_2PIPE:
+      break;
+   default:
+      return false;
+   }
+   /* readline scans the written data for its prompt */
+   if ((out->dtype & XIODATA_READMASK) == XIOREAD_READLINE) {
+      return false;
+   }
+   if (in->lineterm != out->lineterm || in->escape != -1 ||
+       in->readbytes != 0) {
+      return false;
+   }
+#if _WITH_SOCKET
+   if (in->gro) {
+      return false;
+   }
+#endif
+   return true;
+}
+
+/* creates the kernel pipe for a splice() direction. On failure pipefd is
+   left at -1, so this direction falls back to the read()/write() transfer.
+   returns 0 on success or -1 if an error occurred */
+static int socat_splicepipe(int pipefd[2]) {
+   if (Pipe(pipefd) < 0) {
+      Warn2("pipe(%p): %s, not using splice()", pipefd, strerror(errno));
+      pipefd[0] = pipefd[1] = -1;
+      return -1;
+   }
+   Fcntl_l(pipefd[0], F_SETFD, FD_CLOEXEC);
+   Fcntl_l(pipefd[1], F_SETFD, FD_CLOEXEC);
+#ifdef F_SETPIPE_SZ
+   if (socat_opts.bufsiz > 65536) {
+      /* let one splice() call move a whole block */
+      if (Fcntl_l(pipefd[1], F_SETPIPE_SZ, socat_opts.bufsiz) < 0) {
+	 Info3("fcntl(%d, F_SETPIPE_SZ, "F_Zu"): %s",
+	       pipefd[1], socat_opts.bufsiz, strerror(errno));
+      }
+   }
+#endif /* F_SETPIPE_SZ */
+   Info2("using splice() via pipe [%d,%d]", pipefd[0], pipefd[1]);
+   return 0;
+}
+
+/* like xiotransfer(), but moves the data from inpipe through a kernel pipe to
+   outpipe with splice(), so it is never copied to user space. Data that
+   outpipe does not accept now stays in the pipe.
+   returns the number of bytes written or kept, or 0 on EOF or <0 if an error
+   occurred */
+static int xiotransfer_splice(xiofile_t *inpipe, xiofile_t *outpipe,
+			      int pipefd[2], unsigned char **buff,
+			      size_t bufsiz, bool righttoleft) {
+   int infd  = XIO_GETRDFD(inpipe);
+   ssize_t bytes;
+   int _errno;
+
+   do {
+      bytes = Splice(infd, NULL, pipefd[1], NULL, bufsiz,
+		     SPLICE_F_MOVE|SPLICE_F_NONBLOCK);
+   } while (bytes < 0 && errno == EINTR);
+   if (bytes < 0) {
+      _errno = errno;
+      if (_errno == EINVAL) {
+	 /* this FD type does not support splice() */
+	 Info1("splice(%d, ...): not supported, using read()", infd);
+	 socat_spliceend(righttoleft);
+	 return xiotransfer(inpipe, outpipe, buff, xferbuf[righttoleft].bufsiz,
+			    righttoleft);
+      }
+      switch (_errno) {
+      case EAGAIN:
+	 break;
+      case EPIPE: case ECONNRESET:
+	 Warn4("splice(%d, NULL, %d, NULL, "F_Zu", ...): %s",
+	       infd, pipefd[1], bufsiz, strerror(_errno));
+	 break;
+      default:
+	 Error4("splice(%d, NULL, %d, NULL, "F_Zu", ...): %s",
+		infd, pipefd[1], bufsiz, strerror(_errno));
+      }
+      if (_errno != EAGAIN)
+	 XIO_RDSTREAM(inpipe)->eof = 2;
+      errno = _errno;
+      return -1;
+   }
+   if (bytes == 0) {
+      if (!XIO_RDSTREAM(inpipe)->ignoreeof || closing) {
+	 XIO_RDSTREAM(inpipe)->eof = 2;
+	 closing = MAX(closing, 1);
+      }
+      return 0;
+   }
+
+   xferbuf[righttoleft].bytes = bytes;
+   if (socat_flushunwritten(outpipe, righttoleft) < 0 && errno != EAGAIN) {
+      return -1;
+   }
+   Info3("transferred "F_Zu" bytes from %d to %d",
+	 bytes-xferbuf[righttoleft].bytes, infd, XIO_GETWRFD(outpipe));
+   return bytes;
+}
+#endif /* HAVE_SPLICE */
+
+#if HAVE_RECVMMSG && HAVE_SENDMMSG
+/* returns true if fd is a datagram socket */
+static bool socat_isdgram(int fd) {
+   int type;
+   socklen_t typelen = sizeof(type);
+
+   if (Getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &typelen) < 0) {
+      return false;	/* e.g. ENOTSOCK */
+   }
+   return type == SOCK_DGRAM;
+}
+
+/* checks if the transfer from inpipe to outpipe can pass batches of packets:
+   both must be datagram sockets, the input without peer registration,
+   one shot, or IP header removal, and no data conversion, escape check, byte
+   count, or ignoreeof may be active.
+   returns true if recvmmsg() and sendmmsg() may be used */
+static bool socat_maymmsg(xiofile_t *inpipe, xiofile_t *outpipe) {
+   struct single *in  = XIO_RDSTREAM(inpipe);
+   struct single *out = XIO_WRSTREAM(outpipe);
+
+   if (socat_opts.batch <= 1) {
+      return false;
+   }
+   switch (in->dtype & XIODATA_READMASK) {
+   case XIOREAD_RECV:
+      if (in->dtype &
+	  (XIOREAD_RECV_FROM|XIOREAD_RECV_ONESHOT|XIOREAD_RECV_SKIPIP)) {
+	 return false;
+      }
+      break;
+   case XIOREAD_STREAM:
+      break;
+   default:
+      return false;
+   }
+   switch (out->dtype & XIODATA_WRITEMASK) {
+   case XIOWRITE_STREAM:
+   case XIOWRITE_SENDTO:
+      break;
+   default:
+      return false;
+   }
+   if (in->lineterm != out->lineterm || in->escape != -1 ||
+       in->readbytes != 0 || in->ignoreeof) {
+      return false;
+   }
+   if (in->gro) {
+      /* coalesced packets need their segment sizes */
+      return false;
+   }
+   return socat_isdgram(XIO_GETRDFD(inpipe)) &&
+      socat_isdgram(XIO_GETWRFD(outpipe));
+}
+
+/* allocates the batch state of the transfer from inpipe to outpipe, with
+   socat_opts.batch slots of bufsiz bytes.
+   returns the state, or NULL when the direction transfers single packets */
+static struct socat_mmsg *socat_mmsgalloc(xiofile_t *inpipe,
+					  xiofile_t *outpipe) {
+   struct single *in  = XIO_RDSTREAM(inpipe);
+   struct single *out = XIO_WRSTREAM(outpipe);
+   unsigned int n = socat_opts.batch, i;
+   size_t bufsiz = socat_opts.bufsiz;	/* with -b auto the largest size */
+   size_t headsiz;
+   struct socat_mmsg *mm;
+   unsigned char *data;
+
+   headsiz = sizeof(*mm) + n*(2*sizeof(struct mmsghdr) +
+			      2*sizeof(struct iovec) +
+			      sizeof(union sockaddr_union));
+   if ((mm = Malloc(headsiz + n*bufsiz)) == NULL) {
+      return NULL;
+   }
+   memset(mm, 0, headsiz);
+   mm->rmsgs = (struct mmsghdr *)(mm+1);
+   mm->smsgs = mm->rmsgs + n;
+   mm->riov  = (struct iovec *)(mm->smsgs + n);
+   mm->siov  = mm->riov + n;
+   mm->from  = (union sockaddr_union *)(mm->siov + n);
+   data = (unsigned char *)(mm->from + n);
+   mm->checkpeer = ((in->dtype & XIODATA_READMASK) == XIOREAD_RECV);
+   for (i = 0; i < n; ++i) {
+      mm->riov[i].iov_base = data + i*bufsiz;
+      mm->riov[i].iov_len  = bufsiz;
+      mm->rmsgs[i].msg_hdr.msg_iov    = &mm->riov[i];
+      mm->rmsgs[i].msg_hdr.msg_iovlen = 1;
+      if (mm->checkpeer) {
+	 mm->rmsgs[i].msg_hdr.msg_name = &mm->from[i];
+      }
+      mm->smsgs[i].msg_hdr.msg_iov    = &mm->siov[i];
+      mm->smsgs[i].msg_hdr.msg_iovlen = 1;
+      if ((out->dtype & XIODATA_WRITEMASK) == XIOWRITE_SENDTO) {
+	 mm->smsgs[i].msg_hdr.msg_name = &out->peersa;
+      }
+   }
+   Info3("using recvmmsg() and sendmmsg() with up to %u datagrams from %d to %d",
+	 n, XIO_GETRDFD(inpipe), XIO_GETWRFD(outpipe));
+   return mm;
+}
+
+/* sends the kept packets of the direction to outpipe, without waiting for a
+   nonblocking FD.
+   returns the number of bytes sent; or <0 with errno EAGAIN when nothing
+   could be sent, or <0 if an error occurred (the packets are dropped) */
+static ssize_t socat_mmsgsend(xiofile_t *outpipe, bool righttoleft) {
+   struct socat_mmsg *mm = xferbuf[righttoleft].mmsg;
+   struct single *out = XIO_WRSTREAM(outpipe);
+   int outfd = XIO_GETWRFD(outpipe);
+   unsigned int num = mm->num - mm->first, i;
+   ssize_t writt = 0;
+   int n, _errno;
+
+   if ((out->dtype & XIODATA_WRITEMASK) == XIOWRITE_SENDTO) {
+      /* the peer may have changed, e.g. UDP-RECVFROM in the other
+	 direction */
+      for (i = mm->first; i < mm->num; ++i) {
+	 mm->smsgs[i].msg_hdr.msg_namelen = out->salen;
+      }
+   }
+   do {
+      n = Sendmmsg(outfd, mm->smsgs+mm->first, num, 0);
+   } while (n < 0 && errno == EINTR);
+   if (n < 0) {
+      _errno = errno;
+      if (_errno == EAGAIN || _errno == EWOULDBLOCK) {
+	 Info4("sendmmsg(%d, %p, %u, 0): %s",
+	       outfd, mm->smsgs+mm->first, num, strerror(_errno));
+	 errno = EAGAIN;  return -1;
+      }
+      Error4("sendmmsg(%d, %p, %u, 0): %s",
+	     outfd, mm->smsgs+mm->first, num, strerror(_errno));
+      mm->first = mm->num;
+      xferbuf[righttoleft].bytes = 0;
+      errno = _errno;  return -1;
+   }
+   for (i = 0; i < (unsigned int)n; ++i) {
+      writt += mm->siov[mm->first+i].iov_len;
+   }
+   mm->first += n;
+   xferbuf[righttoleft].bytes -= writt;
+   if ((out->dtype & XIODATA_WRITEMASK) == XIOWRITE_SENDTO) {
+      xiosendtocount(out, n, writt);
+   }
+   Info4("sent %d of %u datagrams with "F_Zd" bytes to %d",
+	 n, num, writt, outfd);
+   if (n == 0) {
+      errno = EAGAIN;  return -1;
+   }
+   return writt;
+}
+
+/* receives a batch of datagrams from inpipe and sends them to outpipe;
+   the packets that outpipe does not accept now are kept in xferbuf.
+   returns the number of bytes received, 0 on EOF, or <0 with errno EAGAIN
+   when no packet was passed on, or <0 if an error occurred */
+static int xiotransfer_mmsg(xiofile_t *inpipe, xiofile_t *outpipe,
+			    bool righttoleft) {
+   struct socat_mmsg *mm = xferbuf[righttoleft].mmsg;
+   struct single *in = XIO_RDSTREAM(inpipe);
+   int infd = XIO_GETRDFD(inpipe);
+   ssize_t bytes = 0;
+   size_t len;
+   bool eof = false;
+   int n, i, _errno;
+
+   if (mm->checkpeer) {
+      for (i = 0; i < (int)socat_opts.batch; ++i) {
+	 mm->rmsgs[i].msg_hdr.msg_namelen = sizeof(mm->from[i]);
+      }
+   }
+   do {
+      n = Recvmmsg(infd, mm->rmsgs, socat_opts.batch, MSG_DONTWAIT, NULL);
+   } while (n < 0 && errno == EINTR);
+   if (n < 0) {
+      _errno = errno;
+      if (_errno == EAGAIN || _errno == EWOULDBLOCK) {
+	 errno = EAGAIN;  return -1;
+      }
+      Error4("recvmmsg(%d, %p, %u, MSG_DONTWAIT, NULL): %s",
+	     infd, mm->rmsgs, socat_opts.batch, strerror(_errno));
+      in->eof = 2;
+      errno = _errno;  return -1;
+   }
+
+   mm->first = mm->num = 0;
+   for (i = 0; i < n; ++i) {
+      len = mm->rmsgs[i].msg_len;
+      if (mm->checkpeer &&
+	  xiocheckpeer(in, &mm->from[i], &in->para.socket.la) < 0) {
+	 continue;	/* drop */
+      }
+      if (len == 0) {
+	 if (mm->checkpeer && !in->para.socket.null_eof) {
+	    continue;
+	 }
+	 eof = true;	/* the packets before it are passed on */
+	 break;
+      }
+      if (socat_opts.verbose || socat_opts.verbhex) {
+	 socat_multilock();
+	 xioprintblock(mm->riov[i].iov_base, len, righttoleft);
+	 socat_multiunlock();
+      }
+      if (socat_capture.fd >= 0) {
+	 xiopcapng_block(&socat_capture, righttoleft, XIOPCAPNG_INBOUND,
+			 mm->riov[i].iov_base, len);
+      }
+      mm->siov[mm->num].iov_base = mm->riov[i].iov_base;
+      mm->siov[mm->num].iov_len  = len;
+      ++mm->num;
+      bytes += len;
+   }
+   Info3("received %d datagrams from %d, passing on %u", n, infd, mm->num);
+   if (eof) {
+      in->eof = 2;
+   }
+   if (mm->num == 0) {
+      if (eof) {
+	 return 0;
+      }
+      errno = EAGAIN;  return -1;
+   }
+
+   xferbuf[righttoleft].bytes = bytes;
+   if (socat_mmsgsend(outpipe, righttoleft) < 0 && errno != EAGAIN) {
+      return -1;
+   }
+   return bytes;
+}
+#endif /* HAVE_RECVMMSG && HAVE_SENDMMSG */
+
+#if WITH_IO_URING
+/* the io_uring transfer engine: for each direction a read into the transfer
+   buffer is submitted; when it completed, the write of the data is submitted
+   together with the next read, linked so the read starts only after the write
+   succeeded. Both directions share one io_uring_enter() per loop cycle.
+   Datagram input (XIOREAD_RECV) is waited for with a poll request and then
+   read with xioread(), so its peer checks still apply. */
+
+/* the user_data of a request is direction<<3|operation */
+#define SOCAT_URING_READ	0	/* read into transfer buffer */
+#define SOCAT_URING_RECV	1	/* poll for datagram, then xioread() */
+#define SOCAT_URING_WRITE	2	/* write from transfer buffer */
+#define SOCAT_URING_WAIT	3	/* poll before a linked retry */
+#define SOCAT_URING_TIMER	4	/* closing timeout (direction 2) */
+
+struct socat_uringdir {
+   xiofile_t *in, *out;
+   bool active;		/* direction still transfers data */
+   bool recv;		/* input is XIOREAD_RECV */
+   bool sendto;		/* output is XIOWRITE_SENDTO */
+   bool ineof;		/* input reached EOF (one shot datagram), after
+			   the pending write the direction ends */
+   int infd, outfd;
+   int bufindex;	/* index of the registered buffer, or -1 */
+   unsigned char *buff;
+   unsigned int nread;	/* read requests in flight */
+   size_t writeoff;	/* start of the data not yet written */
+   size_t writelen;	/* data not yet written */
+   struct msghdr msgh;	/* for sendmsg() to the peer */
+   struct iovec iov;
+} ;
+
+/* checks if the io_uring engine can handle the transfer from inpipe to
+   outpipe: plain reads and writes without data conversion, dumps, escape
+   character, byte count, or ignoreeof.
+   returns true if the io_uring engine may be used */
+static bool socat_mayuring(xiofile_t *inpipe, xiofile_t *outpipe) {
+   struct single *in  = XIO_RDSTREAM(inpipe);
+   struct single *out = XIO_WRSTREAM(outpipe);
+
+   switch (in->dtype & XIODATA_READMASK) {
+   case XIOREAD_STREAM:
+#if _WITH_SOCKET
+   case XIOREAD_RECV:
+#endif
+      break;
+   default:
+      return false;
+   }
+   switch (out->dtype & XIODATA_WRITEMASK) {
+   case XIOWRITE_STREAM:
+   case XIOWRITE_PIPE:
+   case XIOWRITE_2PIPE:
+#if _WITH_SOCKET
+   case XIOWRITE_SENDTO:
+#endif
+      break;
+   default:
+      return false;
+   }
+   if ((out->dtype & XIODATA_READMASK) == XIOREAD_READLINE) {
+      return false;
+   }
+   if (in->lineterm != out->lineterm || in->escape != -1 ||
+       in->readbytes != 0 || in->ignoreeof) {
+      return false;
+   }
+   /* a packet that was read while opening would not be polled for */
+   if (xiopending(inpipe) > 0) {
+      return false;
+   }
+#if _WITH_SOCKET
+   /* coalesced packets need their segment sizes */
+   if (in->gro) {
+      return false;
+   }
+#endif
+   return true;
+}
+
+/* queues the next read of the direction; with wait, a poll for input is
+   linked before it */
+static int socat_uringread(struct xiouring *ur, struct socat_uringdir *dir,
+			   int d, bool wait) {
+   struct io_uring_sqe *sqe;
+
+   if (wait && !dir->recv) {
+      if ((sqe = xiouring_getsqe(ur)) == NULL)  goto full;
+      sqe->opcode = IORING_OP_POLL_ADD;
+      sqe->fd = dir->infd;
+      sqe->poll32_events = POLLIN;
+      sqe->flags = IOSQE_IO_LINK;
+      sqe->user_data = d<<3|SOCAT_URING_WAIT;
+   }
+   if ((sqe = xiouring_getsqe(ur)) == NULL)  goto full;
+   sqe->fd = dir->infd;
+   if (dir->recv) {
+      sqe->opcode = IORING_OP_POLL_ADD;
+      sqe->poll32_events = POLLIN;
+      sqe->user_data = d<<3|SOCAT_URING_RECV;
+   } else {
+      sqe->opcode = dir->bufindex >= 0 ? IORING_OP_READ_FIXED : IORING_OP_READ;
+      sqe->addr = (unsigned long)dir->buff;
+      sqe->len = xferbuf[d].bufsiz;
+      sqe->off = (__u64)-1;	/* current file position, like read() */
+      sqe->buf_index = Max(dir->bufindex, 0);
+      sqe->user_data = d<<3|SOCAT_URING_READ;
+   }
+   ++dir->nread;
+   return 0;
+ full:
+   Error("io_uring submission queue is full");
+   return -1;
+}
+
+/* queues the write of the pending data of the direction, followed by the
+   next read; with wait, a poll for output is linked before them */
+static int socat_uringwrite(struct xiouring *ur, struct socat_uringdir *dir,
+			    int d, bool wait) {
+   struct io_uring_sqe *sqe;
+
+   if (wait) {
+      if ((sqe = xiouring_getsqe(ur)) == NULL)  goto full;
+      sqe->opcode = IORING_OP_POLL_ADD;
+      sqe->fd = dir->outfd;
+      sqe->poll32_events = POLLOUT;
+      sqe->flags = IOSQE_IO_LINK;
+      sqe->user_data = d<<3|SOCAT_URING_WAIT;
+   }
+   if ((sqe = xiouring_getsqe(ur)) == NULL)  goto full;
+   sqe->fd = dir->outfd;
+   if (dir->sendto) {
+      dir->iov.iov_base = dir->buff+dir->writeoff;
+      dir->iov.iov_len  = dir->writelen;
+      sqe->opcode = IORING_OP_SENDMSG;
+      sqe->addr = (unsigned long)&dir->msgh;
+      sqe->len = 1;
+   } else {
+      sqe->opcode =
+	 dir->bufindex >= 0 ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+      sqe->addr = (unsigned long)(dir->buff+dir->writeoff);
+      sqe->len = dir->writelen;
+      sqe->off = (__u64)-1;	/* current file position, like write() */
+      sqe->buf_index = Max(dir->bufindex, 0);
+   }
+   sqe->user_data = d<<3|SOCAT_URING_WRITE;
+   if (dir->ineof) {
+      return 0;
+   }
+   sqe->flags = IOSQE_IO_LINK;
+   return socat_uringread(ur, dir, d, false);
+ full:
+   Error("io_uring submission queue is full");
+   return -1;
+}
+
+/* handles EOF on the input of the direction like the poll loop does.
+   returns true when the transfer loop should end */
+static bool socat_uringeof(struct socat_uringdir *dir, int d) {
+   Notice2("socket %d (fd %d) is at EOF", d+1, dir->infd);
+   xioshutdown(dir->out, SHUT_WR);
+   XIO_RDSTREAM(dir->in)->eof = 2;
+   dir->active = false;
+   if (d == 0 ? socat_opts.lefttoright : socat_opts.righttoleft) {
+      return true;
+   }
+   closing = MAX(closing, 1);
+   return false;
+}
+
+/* transfers data between sock1 and sock2 with io_uring.
+   returns 0 when the transfer has ended, 1 when io_uring cannot be used here
+   (the caller uses the poll loop), or -1 if an error occurred */
+static int socat_uring(void) {
+   static const int ops[] = {
+      IORING_OP_READ_FIXED, IORING_OP_WRITE_FIXED, IORING_OP_READ,
+      IORING_OP_WRITE, IORING_OP_POLL_ADD, IORING_OP_SENDMSG,
+      IORING_OP_TIMEOUT } ;
+   struct xiouring ur;
+   struct socat_uringdir dirs[2], *dir;
+   struct iovec regbufs[2];
+   struct __kernel_timespec closets;
+   struct io_uring_cqe *cqe;
+   unsigned long long transferred = 0;
+   bool timerset = false, done = false;
+   int nregbufs = 0;
+   int result = 0, d, op, res;
+
+   memset(dirs, 0, sizeof(dirs));
+   dirs[0].in = sock1;  dirs[0].out = sock2;
+   dirs[0].active = XIO_READABLE(sock1) && XIO_WRITABLE(sock2) &&
+      !socat_opts.righttoleft;
+   dirs[1].in = sock2;  dirs[1].out = sock1;
+   dirs[1].active = XIO_READABLE(sock2) && XIO_WRITABLE(sock1) &&
+      !socat_opts.lefttoright;
+   if (socat_opts.verbose || socat_opts.verbhex || socat_capture.fd >= 0 ||
+       socat_opts.total_timeout.tv_sec != 0 ||
+       socat_opts.total_timeout.tv_usec != 0 ||
+       (!dirs[0].active && !dirs[1].active) ||
+       (dirs[0].active && !socat_mayuring(sock1, sock2)) ||
+       (dirs[1].active && !socat_mayuring(sock2, sock1))) {
+      Info("io_uring engine not applicable to these addresses or options, using select()");
+      return 1;
+   }
+   if (xiouring_init(&ur, 16, ops, sizeof(ops)/sizeof(int)) < 0) {
+      Warn("io_uring not available, using select()");
+      return 1;
+   }
+
+   for (d = 0; d < 2; ++d) {
+      dir = &dirs[d];
+      dir->bufindex = -1;
+      if (!dir->active)  continue;
+      dir->infd   = XIO_GETRDFD(dir->in);
+      dir->outfd  = XIO_GETWRFD(dir->out);
+      dir->buff   = xferbuf[d].buff;
+      dir->recv   = ((XIO_RDSTREAM(dir->in)->dtype & XIODATA_READMASK) ==
+		     XIOREAD_RECV);
+      dir->sendto = ((XIO_WRSTREAM(dir->out)->dtype & XIODATA_WRITEMASK) ==
+		     XIOWRITE_SENDTO);
+      if (dir->sendto) {
+	 dir->msgh.msg_name    = &XIO_WRSTREAM(dir->out)->peersa;
+	 dir->msgh.msg_namelen = XIO_WRSTREAM(dir->out)->salen;
+	 dir->msgh.msg_iov     = &dir->iov;
+	 dir->msgh.msg_iovlen  = 1;
+      }
+      if (socat_opts.bufauto) {
+	 continue;	/* buffers are reallocated, cannot be registered */
+      }
+      regbufs[nregbufs].iov_base = dir->buff;
+      regbufs[nregbufs].iov_len  = xferbuf[d].bufsiz;
+      dir->bufindex = nregbufs++;
+   }
+   /* registered buffers save the page pinning per request; without them
+      (e.g. RLIMIT_MEMLOCK) plain reads and writes are used */
+   if (nregbufs > 0 &&
+       Io_uring_register(ur.fd, IORING_REGISTER_BUFFERS, regbufs, nregbufs)
+       < 0) {
+      Info1("io_uring_register(, IORING_REGISTER_BUFFERS, ...): %s",
+	    strerror(errno));
+      dirs[0].bufindex = dirs[1].bufindex = -1;
+   }
+
+   Notice4("starting io_uring transfer loop with FDs [%d,%d] and [%d,%d]",
+	   XIO_GETRDFD(sock1), XIO_GETWRFD(sock1),
+	   XIO_GETRDFD(sock2), XIO_GETWRFD(sock2));
+   for (d = 0; d < 2; ++d) {
+      if (dirs[d].active && socat_uringread(&ur, &dirs[d], d, false) < 0) {
+	 xiouring_close(&ur);
+	 return -1;
+      }
+   }
+
+   while (!done && (dirs[0].active || dirs[1].active)) {
+      if (closing >= 1 && !timerset) {
+	 /* first eof occurred, or child died: start end timer */
+	 struct io_uring_sqe *sqe;
+	 closets.tv_sec  = socat_opts.closwait.tv_sec;
+	 closets.tv_nsec = socat_opts.closwait.tv_usec*1000;
+	 if ((sqe = xiouring_getsqe(&ur)) == NULL) {
+	    Error("io_uring submission queue is full");
+	    result = -1;  break;
+	 }
+	 sqe->opcode = IORING_OP_TIMEOUT;
+	 sqe->addr = (unsigned long)&closets;
+	 sqe->len = 1;
+	 sqe->user_data = 2<<3|SOCAT_URING_TIMER;
+	 timerset = true;
+	 closing = 2;
+      }
+      if (xiouring_enter(&ur, 1) < 0) {
+	 if (errno == EINTR)  continue;
+	 Error1("io_uring_enter(): %s", strerror(errno));
+	 result = -1;  break;
+      }
+
+      while (!done && (cqe = xiouring_peekcqe(&ur)) != NULL) {
+	 d   = cqe->user_data >> 3;
+	 op  = cqe->user_data & 7;
+	 res = cqe->res;
+	 xiouring_cqeseen(&ur);
+
+	 if (op == SOCAT_URING_TIMER) {
+	    Info("closing timeout elapsed");
+	    done = true;
+	    break;
+	 }
+	 dir = &dirs[d];
+	 if (op == SOCAT_URING_READ || op == SOCAT_URING_RECV) {
+	    --dir->nread;
+	 }
+	 if (!dir->active)  continue;
+
+	 switch (op) {
+	 case SOCAT_URING_WAIT:
+	    if (res < 0 && res != -ECANCELED) {
+	       Error2("poll(%d): %s",
+		      dir->writelen ? dir->outfd : dir->infd, strerror(-res));
+	       dir->active = false;
+	       closing = MAX(closing, 1);
+	    }
+	    break;
+
+	 case SOCAT_URING_RECV:
+	    if (res == -ECANCELED) {
+	       res = 0;
+	    } else if (res < 0) {
+	       Error2("poll(%d, POLLIN): %s", dir->infd, strerror(-res));
+	       dir->active = false;
+	       closing = MAX(closing, 1);
+	       break;
+	    } else {
+	       /* the datagram is checked and read like in the poll loop */
+	       ssize_t bytes = xioread(dir->in, dir->buff, xferbuf[d].bufsiz);
+	       if (socat_opts.bufauto) {
+		  socat_bufadapt(d, bytes);
+		  dir->buff = xferbuf[d].buff;
+	       }
+	       if (bytes < 0 && errno == EAGAIN) {
+		  res = 0;	/* dropped or no datagram, wait again */
+	       } else if (bytes < 0) {
+		  Notice2("socket %d to socket %d is in error", d+1, 2-d);
+		  dir->active = false;
+		  closing = MAX(closing, 1);
+		  break;
+	       } else if (bytes == 0) {
+		  done = socat_uringeof(dir, d);
+		  break;
+	       } else {
+		  dir->writeoff = 0;  dir->writelen = bytes;
+		  transferred += bytes;
+		  /* XIOREAD_RECV_ONESHOT */
+		  dir->ineof = (XIO_RDSTREAM(dir->in)->eof >= 2);
+		  if (socat_uringwrite(&ur, dir, d, false) < 0) {
+		     result = -1;  done = true;
+		  }
+		  break;
+	       }
+	    }
+	    if (dir->writelen == 0 && dir->nread == 0 &&
+		socat_uringread(&ur, dir, d, false) < 0) {
+	       result = -1;  done = true;
+	    }
+	    break;
+
+	 case SOCAT_URING_READ:
+	    if (res > 0) {
+	       if (socat_opts.bufauto) {
+		  socat_bufadapt(d, res);
+		  dir->buff = xferbuf[d].buff;
+	       }
+	       dir->writeoff = 0;  dir->writelen = res;
+	       transferred += res;
+	       if (socat_uringwrite(&ur, dir, d, false) < 0) {
+		  result = -1;  done = true;
+	       }
+	    } else if (res == 0) {
+	       done = socat_uringeof(dir, d);
+	    } else if (res == -ECANCELED) {
+	       /* the write before it was short or failed */
+	       if (dir->writelen == 0 && dir->nread == 0 &&
+		   socat_uringread(&ur, dir, d, false) < 0) {
+		  result = -1;  done = true;
+	       }
+	    } else if (res == -EAGAIN || res == -EINTR) {
+	       if (socat_uringread(&ur, dir, d, true) < 0) {
+		  result = -1;  done = true;
+	       }
+	    } else {
+	       if (res == -EPIPE || res == -ECONNRESET) {
+		  Warn4("read(%d, %p, "F_Zu"): %s",
+			dir->infd, dir->buff, xferbuf[d].bufsiz,
+			strerror(-res));
+	       } else {
+		  Error4("read(%d, %p, "F_Zu"): %s",
+			 dir->infd, dir->buff, xferbuf[d].bufsiz,
+			 strerror(-res));
+	       }
+	       Notice2("socket %d to socket %d is in error", d+1, 2-d);
+	       XIO_RDSTREAM(dir->in)->eof = 2;
+	       dir->active = false;
+	       closing = MAX(closing, 1);
+	    }
+	    break;
+
+	 case SOCAT_URING_WRITE:
+	    if (res == -ECANCELED) {
+	       break;	/* the poll before it failed, already reported */
+	    }
+	    if (res == -EAGAIN || res == -EINTR) {
+	       if (socat_uringwrite(&ur, dir, d, true) < 0) {
+		  result = -1;  done = true;
+	       }
+	       break;
+	    }
+	    if (res < 0) {
+	       if ((res == -EPIPE || res == -ECONNRESET) &&
+		   XIO_WRSTREAM(dir->out)->cool_write) {
+		  Notice4("write(%d, %p, "F_Zu"): %s",
+			  dir->outfd, dir->buff+dir->writeoff, dir->writelen,
+			  strerror(-res));
+	       } else {
+		  Error4("write(%d, %p, "F_Zu"): %s",
+			 dir->outfd, dir->buff+dir->writeoff, dir->writelen,
+			 strerror(-res));
+	       }
+	       Notice2("socket %d to socket %d is in error", d+1, 2-d);
+	       dir->writelen = 0;
+	       dir->active = false;
+	       closing = MAX(closing, 1);
+	       break;
+	    }
+	    Info3("transferred %d bytes from %d to %d",
+		  res, dir->infd, dir->outfd);
+	    if (dir->sendto) {
+	       /* the sends bypass xiowrite(), so count them here */
+	       xiosendtocount(XIO_WRSTREAM(dir->out), 1, res);
+	       if ((size_t)res < dir->writelen) {
+		  Warn3("sendmsg(%d, ...) only wrote %d of "F_Zu" bytes",
+			dir->outfd, res, dir->writelen);
+		  res = dir->writelen;
+	       }
+	    }
+	    dir->writeoff += res;  dir->writelen -= res;
+	    if (dir->writelen > 0) {
+	       /* short write broke the link: the read was cancelled */
+	       if (socat_uringwrite(&ur, dir, d, false) < 0) {
+		  result = -1;  done = true;
+	       }
+	    } else if (dir->ineof) {
+	       done = socat_uringeof(dir, d);
+	    } else if (dir->nread == 0) {
+	       if (socat_uringread(&ur, dir, d, false) < 0) {
+		  result = -1;  done = true;
+	       }
+	    }
+	    break;
+	 }
+      }
+   }
+
+   Info4("io_uring: transferred %llu bytes with %lu requests in %lu io_uring_enter() calls (%s)",
+	 transferred, ur.submitted, ur.enters,
+	 dirs[0].bufindex >= 0 || dirs[1].bufindex >= 0 ?
+	 "registered buffers" : "unregistered buffers");
+   /* pending requests are cancelled by the kernel */
+   xiouring_close(&ur);
+   return result;
+}
+#endif /* WITH_IO_URING */
+
+#if WITH_EPOLL
+/* option multi of a listening address: this process accepts all
+   connections and relays each one to its own instance of the second address,
+   using one epoll instance per loop. Data is read into buffers shared by the
+   connections of a loop; only data that an output did not accept is copied
+   into a Malloc()'ed buffer of its connection, so an idle connection holds no
+   transfer buffers. With option threads, each thread runs its own loop; the
+   main thread accepts the connections. With thread support, opener threads
+   open the second address of each new connection, so a slow connect delays
+   no loop, and pass the connections to the loops in turn. */
+#define SOCAT_MULTIEVENTS 256	/* events per epoll_wait() */
+#define SOCAT_MULTIACCEPT 64	/* connections accepted per wakeup */
+#define SOCAT_MULTICLOSING 100	/* ms between checks of closing connections */
+#define SOCAT_MULTIOPENERS 8	/* threads that open the second address */
+#define SOCAT_MULTILISTEN (~(uint64_t)0)	/* epoll data of the listener */
+#define SOCAT_MULTIHANDOFF (~(uint64_t)1)	/* ... of the handoff pipe */
+
+struct socat_conn {
+   struct socat_multiloop *loop;	/* the loop that serves it */
+   unsigned int index;		/* in loop->conns */
+   xiofile_t *sock[2];		/* [0] accepted, [1] second address */
+   struct socat_xferbuf xfer[2];	/* [0] is sock[0] to sock[1] */
+   bool done[2];		/* direction is at EOF, failed, or unused */
+   int fd[4];			/* the distinct FDs of sock[0] and sock[1] */
+   uint32_t events[4];		/* events registered for fd[i], 0: none */
+   unsigned int nfds;
+   struct timeval closing;	/* end of the close wait, when one is done */
+   struct socat_conn *cprev, *cnext;	/* list of closing connections */
+} ;
+
+/* the state of one transfer loop */
+struct socat_multiloop {
+   int epfd;
+   int handoff[2];		/* pipe that passes new connections to it */
+   struct socat_conn **conns;	/* NULL: free slot */
+   unsigned int size;		/* entries of conns */
+   unsigned int *freeslots;	/* stack of free indexes of conns */
+   unsigned int nfree;
+   unsigned int nconns;		/* open connections */
+   unsigned char *buff;		/* shared, 2*bufsiz+1 bytes */
+   unsigned char *scratch;	/* shared, for cv_newline() */
+   struct socat_conn *chead, *ctail;	/* closing, by end of close wait */
+} ;
+
+static const char *socat_multiaddr2;	/* the second address */
+static int socat_multiflags;		/* for opening the second address */
+static struct socat_multiloop *socat_multiloops;	/* one per thread */
+static unsigned int socat_multinloops;
+#if WITH_THREADS
+static int socat_multiopen[2] = { -1, -1 };	/* requests to the openers */
+static int socat_multiopened[2] = { -1, -1 };	/* opened datagram sessions */
+static sigset_t socat_multisigmask;	/* of the process, for its children */
+#endif
+
+/* a new connection on its way to an opener, or to the loop of a thread */
+struct socat_multinew {
+   xiofile_t *cfd, *sock2x;
+   struct socat_session *sess;	/* datagram session instead of cfd */
+} ;
+
+/* frees an address of a connection, with the parameters and options that
+   xioopen() copied. For FDs that xioclose() leaves open (END_SHUTDOWN etc.) this
+   process is the last user, so close them too.
+   Only the references in sock[] are changed under the lock */
+static void socat_multifree(xiofile_t *xfd) {
+   struct single *pipes[2] = { NULL, NULL };
+   int i, s;
+
+   if (xfd == NULL) {
+      return;
+   }
+   xioclose(xfd);
+   for (s = 0; s < 2; ++s) {
+      struct single *pipe;
+      if (xfd->tag == XIO_TAG_DUAL) {
+	 pipe = pipes[s] = xfd->dual.stream[s];
+      } else if (s == 0) {
+	 pipe = &xfd->stream;
+      } else {
+	 break;
+      }
+      if (pipe->fd >= 0 &&
+	  pipe->howtoend != END_CLOSE && pipe->howtoend != END_CLOSE_KILL &&
+	  pipe->howtoend != END_NONE) {
+	 Close(pipe->fd);
+      }
+      for (i = 0; i < pipe->argc; ++i) {
+	 free((char *)pipe->argv[i]);
+      }
+      pipe->argc = 0;
+      free(pipe->opts);		/* unless the address freed them */
+      pipe->opts = NULL;
+   }
+   xiolockstate();
+   for (i = 0; i < XIO_MAXSOCK; ++i) {
+      if (sock[i] == xfd ||
+	  (pipes[0] != NULL && sock[i] == (xiofile_t *)pipes[0]) ||
+	  (pipes[1] != NULL && sock[i] == (xiofile_t *)pipes[1])) {
+	 sock[i] = NULL;
+      }
+   }
+   xiounlockstate();
+   free(pipes[0]);
+   free(pipes[1]);
+   free(xfd);
+}
+
+/* returns the index of fd in the FDs of connection c */
+static int socat_multislot(struct socat_conn *c, int fd) {
+   unsigned int k;
+
+   for (k = 0; k < c->nfds; ++k) {
+      if (c->fd[k] == fd)  return k;
+   }
+   return -1;
+}
+
+/* closes connection c and frees its slot */
+static void socat_multiclose(struct socat_conn *c) {
+   struct socat_multiloop *ml = c->loop;
+   unsigned int k;
+   int d;
+
+   for (k = 0; k < c->nfds; ++k) {
+      if (c->events[k] != 0) {
+	 Epoll_ctl(ml->epfd, EPOLL_CTL_DEL, c->fd[k], NULL);
+      }
+   }
+   if (c->closing.tv_sec != 0) {
+      if (c->cprev)  c->cprev->cnext = c->cnext;
+      else           ml->chead = c->cnext;
+      if (c->cnext)  c->cnext->cprev = c->cprev;
+      else           ml->ctail = c->cprev;
+   }
+   for (d = 0; d < 2; ++d) {
+      free(c->xfer[d].buff);
+   }
+   Info1("connection %u: closing", c->index);
+   socat_multifree(c->sock[0]);
+   socat_multifree(c->sock[1]);
+   ml->conns[c->index] = NULL;
+   ml->freeslots[ml->nfree++] = c->index;
+   --ml->nconns;
+   free(c);
+}
+
+/* registers the events connection c waits for: input of a direction that
+   has no unwritten data, output of a direction that has.
+   returns 0 on success or -1 if an error occurred */
+static int socat_multiwatch(struct socat_conn *c) {
+   struct socat_multiloop *ml = c->loop;
+   uint32_t want[4] = { 0, 0, 0, 0 };
+   struct epoll_event ev;
+   unsigned int k;
+   int d;
+
+   for (d = 0; d < 2; ++d) {
+      if (c->done[d]) {
+	 continue;
+      }
+      if (c->xfer[d].bytes > 0) {
+	 want[socat_multislot(c, XIO_GETWRFD(c->sock[1-d]))] |= EPOLLOUT;
+      } else {
+	 want[socat_multislot(c, XIO_GETRDFD(c->sock[d]))] |= EPOLLIN;
+      }
+   }
+   for (k = 0; k < c->nfds; ++k) {
+      int op;
+      if (want[k] == c->events[k]) {
+	 continue;
+      }
+      op = (c->events[k] == 0 ? EPOLL_CTL_ADD :
+	    want[k] == 0 ? EPOLL_CTL_DEL : EPOLL_CTL_MOD);
+      ev.events = want[k];
+      ev.data.u64 = (uint64_t)c->index<<2 | k;
+      if (Epoll_ctl(ml->epfd, op, c->fd[k], &ev) < 0) {
+	 Error4("epoll_ctl(%d, %d, %d, ...): %s",
+		ml->epfd, op, c->fd[k], strerror(errno));
+	 return -1;
+      }
+      c->events[k] = want[k];
+   }
+   return 0;
+}
+
+/* (re)starts the close wait of connection c: it ends closwait from now, so
+   c goes to the end of the list of closing connections */
+static void socat_multiclosing(struct socat_conn *c) {
+   struct socat_multiloop *ml = c->loop;
+   struct timeval now;
+
+   if (c->closing.tv_sec != 0) {
+      if (c == ml->ctail)  goto restart;
+      if (c->cprev)  c->cprev->cnext = c->cnext;
+      else           ml->chead = c->cnext;
+      c->cnext->cprev = c->cprev;
+   }
+   c->cnext = NULL;
+   c->cprev = ml->ctail;
+   if (ml->ctail)  ml->ctail->cnext = c;
+   else            ml->chead = c;
+   ml->ctail = c;
+ restart:
+   gettimeofday(&now, NULL);
+   timeradd(&now, &socat_opts.closwait, &c->closing);
+}
+
+/* direction d of connection c has ended; with eof, passes the EOF on to
+   the other side. The connection is closed when both directions ended, or
+   when the other direction has not transferred data for closwait */
+static void socat_multiend(struct socat_conn *c, int d, bool eof) {
+   c->done[d] = true;
+   if (eof) {
+      xioshutdown(c->sock[1-d], SHUT_WR);
+   }
+   if (c->done[1-d] || c->closing.tv_sec != 0) {
+      return;
+   }
+   socat_multiclosing(c);
+}
+
+/* handles events on FD slot k of connection c */
+static void socat_multievent(struct socat_conn *c, unsigned int k,
+			     uint32_t events) {
+   struct socat_multiloop *ml = c->loop;
+   int fd = c->fd[k];
+   int d;
+
+   xferbuf = c->xfer;
+   for (d = 0; d < 2; ++d) {
+      xiofile_t *in = c->sock[d], *out = c->sock[1-d];
+      ssize_t bytes;
+
+      if (c->done[d]) {
+	 continue;
+      }
+      if (xferbuf[d].bytes > 0) {
+	 if (fd != XIO_GETWRFD(out) ||
+	     !(events & (EPOLLOUT|EPOLLERR|EPOLLHUP))) {
+	    continue;
+	 }
+	 if (socat_flushunwritten(out, d) < 0) {
+	    if (errno != EAGAIN) {
+	       socat_multiend(c, d, false);
+	       continue;
+	    }
+	 } else if (c->closing.tv_sec != 0) {
+	    socat_multiclosing(c);	/* data still flows */
+	 }
+	 if (xferbuf[d].bytes == 0) {
+	    free(xferbuf[d].buff);
+	    xferbuf[d].buff = xferbuf[d].ptr = NULL;
+	    if (XIO_RDSTREAM(in)->eof >= 2 || XIO_RDSTREAM(in)->actescape) {
+	       socat_multiend(c, d, true);
+	    }
+	 }
+	 continue;
+      }
+      if (fd != XIO_GETRDFD(in) || !(events & (EPOLLIN|EPOLLERR|EPOLLHUP))) {
+	 continue;
+      }
+      xferbuf[d].scratch = ml->scratch;
+      bytes = xiotransfer(in, out, &ml->buff, socat_opts.bufsiz,
+			  d);
+      /* cv_newline() may have swapped the shared buffers */
+      ml->scratch = xferbuf[d].scratch;
+      xferbuf[d].scratch = NULL;
+      closing = 0;
+      if (bytes > 0 && c->closing.tv_sec != 0) {
+	 socat_multiclosing(c);	/* data still flows */
+      }
+      if (xferbuf[d].bytes > 0) {
+	 /* keep the unwritten data */
+	 unsigned char *keep;
+	 if ((keep = Malloc(xferbuf[d].bytes)) == NULL) {
+	    xferbuf[d].bytes = 0;
+	    socat_multiend(c, d, false);
+	    continue;
+	 }
+	 memcpy(keep, xferbuf[d].ptr, xferbuf[d].bytes);
+	 xferbuf[d].buff = xferbuf[d].ptr = keep;
+	 continue;
+      }
+      if (bytes < 0 && errno != EAGAIN) {
+	 socat_multiend(c, d, false);
+      } else if (bytes == 0 || XIO_RDSTREAM(in)->eof >= 2 ||
+		 XIO_RDSTREAM(in)->actescape) {
+	 socat_multiend(c, d, true);
+      }
+   }
+   xferbuf = socat_xferbufs;
+
+   if ((c->done[0] && c->done[1]) || socat_multiwatch(c) < 0) {
+      socat_multiclose(c);
+   }
+}
+
+/* takes a new connection, with sock2x its instance of the second address,
+   into the table of loop ml. Closes both if an error occurred */
+static void socat_multiadd(struct socat_multiloop *ml, xiofile_t *cfd,
+			   xiofile_t *sock2x) {
+   struct socat_conn *c;
+   int fds[4];
+   unsigned int i;
+
+   if (ml->nfree == 0) {
+      /* grow the table */
+      unsigned int size = ml->size ? 2*ml->size : 1024;
+      struct socat_conn **conns;
+      unsigned int *freeslots;
+      if ((conns = Realloc(ml->conns, size*sizeof(struct socat_conn *)))
+	  == NULL) {
+	 goto failed;
+      }
+      ml->conns = conns;
+      if ((freeslots = Realloc(ml->freeslots, size*sizeof(unsigned int)))
+	  == NULL) {
+	 goto failed;
+      }
+      ml->freeslots = freeslots;
+      for (i = size; i > ml->size; --i) {
+	 conns[i-1] = NULL;
+	 freeslots[ml->nfree++] = i-1;
+      }
+      ml->size = size;
+   }
+   if ((c = Calloc(1, sizeof(struct socat_conn))) == NULL) {
+      goto failed;
+   }
+   c->loop = ml;
+   c->sock[0] = cfd;
+   c->sock[1] = sock2x;
+   c->done[0] = socat_opts.righttoleft ||
+      !XIO_READABLE(cfd) || !XIO_WRITABLE(sock2x);
+   c->done[1] = socat_opts.lefttoright ||
+      !XIO_READABLE(sock2x) || !XIO_WRITABLE(cfd);
+   fds[0] = XIO_GETRDFD(cfd);     fds[1] = XIO_GETWRFD(cfd);
+   fds[2] = XIO_GETRDFD(sock2x);  fds[3] = XIO_GETWRFD(sock2x);
+   for (i = 0; i < 4; ++i) {
+      if (fds[i] < 0 || socat_multislot(c, fds[i]) >= 0) {
+	 continue;
+      }
+      /* a connection must never block the others */
+      Fcntl_l(fds[i], F_SETFL, Fcntl(fds[i], F_GETFL)|O_NONBLOCK);
+      c->fd[c->nfds++] = fds[i];
+   }
+   c->index = ml->freeslots[--ml->nfree];
+   ml->conns[c->index] = c;
+   ++ml->nconns;
+   Info3("connection %u: FDs %d and %d", c->index,
+	 XIO_GETRDFD(cfd), XIO_GETRDFD(sock2x));
+   if ((c->done[0] && c->done[1]) || socat_multiwatch(c) < 0) {
+      socat_multiclose(c);
+   }
+   return;
+
+ failed:
+   socat_multifree(sock2x);
+   socat_multifree(cfd);
+}
+
+/* prepares loop ml: its shared buffers and its epoll instance, with its
+   handoff pipe and, for the main thread, the listening socket lis
+   registered.
+   returns 0 on success or -1 if an error occurred */
+static int socat_multiinit(struct socat_multiloop *ml, struct single *lis) {
+   struct epoll_event ev;
+
+   /* when converting nl to crnl, size might double */
+   if ((ml->buff = Malloc(2*socat_opts.bufsiz+1)) == NULL ||
+       (ml->scratch = Malloc(2*socat_opts.bufsiz+1)) == NULL) {
+      return -1;
+   }
+   if ((ml->epfd = Epoll_create1(EPOLL_CLOEXEC)) < 0) {
+      Error1("epoll_create1(EPOLL_CLOEXEC): %s", strerror(errno));
+      return -1;
+   }
+   if (Pipe(ml->handoff) < 0) {
+      Error1("pipe(): %s", strerror(errno));
+      return -1;
+   }
+   Fcntl_l(ml->handoff[0], F_SETFD, FD_CLOEXEC);
+   Fcntl_l(ml->handoff[1], F_SETFD, FD_CLOEXEC);
+   Fcntl_l(ml->handoff[0], F_SETFL, Fcntl(ml->handoff[0], F_GETFL)|O_NONBLOCK);
+   ev.events = EPOLLIN;
+   ev.data.u64 = SOCAT_MULTIHANDOFF;
+   if (Epoll_ctl(ml->epfd, EPOLL_CTL_ADD, ml->handoff[0], &ev) < 0) {
+      Error3("epoll_ctl(%d, EPOLL_CTL_ADD, %d, ...): %s",
+	     ml->epfd, ml->handoff[0], strerror(errno));
+      return -1;
+   }
+   if (lis != NULL) {
+      ev.data.u64 = SOCAT_MULTILISTEN;
+      if (Epoll_ctl(ml->epfd, EPOLL_CTL_ADD, lis->fd, &ev) < 0) {
+	 Error3("epoll_ctl(%d, EPOLL_CTL_ADD, %d, ...): %s",
+		ml->epfd, lis->fd, strerror(errno));
+	 return -1;
+      }
+   }
+   return 0;
+}
+
+/* opens the second address for the client with the address peer, which
+   xioclientpeer provides to it, e.g. for option lb=hash.
+   returns the address, or NULL if an error occurred */
+static xiofile_t *socat_multiopen2(const union sockaddr_union *peer,
+				   socklen_t peerlen) {
+   xiofile_t *sock2x;
+
+   memcpy(&xioclientpeer, peer, peerlen);
+   xioclientpeerlen = peerlen;
+   sock2x = xioopen(socat_multiaddr2, socat_multiflags);
+   xioclientpeerlen = 0;
+   return sock2x;
+}
+
+/* the second address of a new connection has been opened, by loop ml or, with
+   ml NULL, by an opener thread; passes the connection to the loops in turn */
+static void socat_multipass(struct socat_multiloop *ml, xiofile_t *cfd,
+			    xiofile_t *sock2x) {
+   static unsigned int next;
+   struct socat_multiloop *to;
+   struct socat_multinew new;
+
+   socat_multilock();
+   to = &socat_multiloops[next];
+   next = (next + 1) % socat_multinloops;
+   socat_multiunlock();
+   if (to == ml) {
+      socat_multiadd(ml, cfd, sock2x);
+      return;
+   }
+   new.cfd = cfd;  new.sock2x = sock2x;
+   /* less than PIPE_BUF bytes are written atomically */
+   if (writefull(to->handoff[1], &new, sizeof(new)) < 0) {
+      Error2("write(%d, ...): %s", to->handoff[1], strerror(errno));
+      socat_multifree(sock2x);
+      socat_multifree(cfd);
+   }
+}
+
+/* takes the connections that were passed to loop ml */
+static void socat_multitake(struct socat_multiloop *ml) {
+   struct socat_multinew new[SOCAT_MULTIACCEPT];
+   ssize_t bytes;
+   int i;
+
+   do {
+      bytes = Read(ml->handoff[0], new, sizeof(new));
+   } while (bytes < 0 && errno == EINTR);
+   if (bytes < 0) {
+      if (errno != EAGAIN) {
+	 Error2("read(%d, ...): %s", ml->handoff[0], strerror(errno));
+      }
+      return;
+   }
+   for (i = 0; i < bytes/(ssize_t)sizeof(new[0]); ++i) {
+      socat_multiadd(ml, new[i].cfd, new[i].sock2x);
+   }
+}
+
+/* the transfer loop of option multi; does not return unless an error
+   occurred.
+   returns -1 */
+static int socat_multirun(struct socat_multiloop *ml) {
+   struct epoll_event events[SOCAT_MULTIEVENTS];
+   struct single *lis = &sock1->stream;
+   xiofile_t *cfd, *sock2x;
+   struct timeval now;
+   bool accepting, taking;
+   int n, i;
+
+   while (true) {
+      n = Epoll_wait(ml->epfd, events, SOCAT_MULTIEVENTS,
+		     ml->chead ? SOCAT_MULTICLOSING : -1);
+      if (n < 0) {
+	 if (errno == EINTR)  continue;
+	 Error4("epoll_wait(%d, %p, %d, ...): %s", ml->epfd,
+		events, SOCAT_MULTIEVENTS, strerror(errno));
+	 return -1;
+      }
+      /* new connections are taken after the events of this call, so an event
+	 never meets a connection that reused the slot of a closed one */
+      accepting = false;  taking = false;
+      for (i = 0; i < n; ++i) {
+	 struct socat_conn *c;
+	 if (events[i].data.u64 == SOCAT_MULTILISTEN) {
+	    accepting = true;
+	 } else if (events[i].data.u64 == SOCAT_MULTIHANDOFF) {
+	    taking = true;
+	 } else if ((c = ml->conns[events[i].data.u64>>2]) != NULL) {
+	    socat_multievent(c, events[i].data.u64&3, events[i].events);
+	 }
+      }
+      if (taking) {
+	 socat_multitake(ml);
+      }
+      for (i = 0; accepting && i < SOCAT_MULTIACCEPT; ++i) {
+	 /* accepting changes no process wide state */
+	 if (xioaccept_multi(lis, &cfd) <= 0) {
+	    break;
+	 }
+#if WITH_THREADS
+	 if (socat_multiopen[1] >= 0) {
+	    struct socat_multinew new;
+	    new.cfd = cfd;  new.sock2x = NULL;  new.sess = NULL;
+	    /* less than PIPE_BUF bytes are written atomically */
+	    if (Write(socat_multiopen[1], &new, sizeof(new)) < 0) {
+	       Warn2("write(%d, ...): %s, closing new connection",
+		     socat_multiopen[1], strerror(errno));
+	       socat_multifree(cfd);
+	    }
+	    continue;
+	 }
+#endif /* WITH_THREADS */
+	 sock2x = socat_multiopen2(&cfd->stream.peersa, cfd->stream.salen);
+	 if (sock2x == NULL) {
+	    socat_multifree(cfd);
+	    continue;
+	 }
+	 socat_multipass(ml, cfd, sock2x);
+      }
+      if (ml->chead != NULL) {
+	 gettimeofday(&now, NULL);
+	 while (ml->chead != NULL &&
+		!timercmp(&now, &ml->chead->closing, <)) {
+	    socat_multiclose(ml->chead);
+	 }
+      }
+      diag_flush();
+   }
+}
+
+#if WITH_THREADS
+/* start routine of the additional transfer threads */
+static void *socat_multithread(void *arg) {
+   socat_multirun(arg);
+   Exit(1);
+   return NULL;
+}
+
+/* start routine of the opener threads: opens the second address for each
+   connection that the main thread accepted, and passes both to a loop. A
+   datagram session goes back to socat_sessions(), also when the open
+   failed */
+static void *socat_multiopener(void *arg) {
+   struct socat_multinew new;
+   ssize_t bytes;
+
+   while (true) {
+      /* the requests are written atomically, so each read gets a whole one */
+      if ((bytes = Read(socat_multiopen[0], &new, sizeof(new))) < 0) {
+	 if (errno == EINTR)  continue;
+	 Error2("read(%d, ...): %s", socat_multiopen[0], strerror(errno));
+	 break;
+      }
+      if (bytes != sizeof(new)) {
+	 break;
+      }
+      /* xioopen() changes sock[] and the environment under xiolockstate(), so
+	 the openers connect in parallel */
+#if _WITH_SOCKET
+      if (new.sess != NULL) {
+	 new.sock2x = socat_sessopen2(new.sess);
+	 if (writefull(socat_multiopened[1], &new, sizeof(new)) < 0) {
+	    Error2("write(%d, ...): %s", socat_multiopened[1], strerror(errno));
+	 }
+	 continue;
+      }
+#endif /* _WITH_SOCKET */
+      new.sock2x =
+	 socat_multiopen2(&new.cfd->stream.peersa, new.cfd->stream.salen);
+      if (new.sock2x == NULL) {
+	 socat_multifree(new.cfd);
+	 continue;
+      }
+      socat_multipass(NULL, new.cfd, new.sock2x);
+   }
+   Exit(1);
+   return NULL;
+}
+
+/* fork() takes xiolockstate(), so the child process does not inherit it locked by
+   another thread */
+static void socat_multiprefork(void) {
+   xiolockstate();
+}
+
+static void socat_multipostfork(void) {
+   xiounlockstate();
+}
+
+/* a program that the second address starts must not inherit the signal mask
+   of the thread that forked it */
+static void socat_multiforked(void) {
+   xiounlockstate();
+   pthread_sigmask(SIG_SETMASK, &socat_multisigmask, NULL);
+}
+
+/* starts the opener threads, with the write end of their request pipe
+   nonblocking, so the main thread never waits for them.
+   returns 0 on success or -1 if an error occurred */
+static int socat_multiopeners(void) {
+   pthread_t thread;
+   unsigned int t;
+   int rc;
+
+   if (Pipe(socat_multiopen) < 0) {
+      Error1("pipe(): %s", strerror(errno));
+      return -1;
+   }
+   Fcntl_l(socat_multiopen[0], F_SETFD, FD_CLOEXEC);
+   Fcntl_l(socat_multiopen[1], F_SETFD, FD_CLOEXEC);
+   Fcntl_l(socat_multiopen[1], F_SETFL,
+	   Fcntl(socat_multiopen[1], F_GETFL)|O_NONBLOCK);
+   if ((rc = pthread_atfork(socat_multiprefork, socat_multipostfork,
+			    socat_multiforked)) != 0) {
+      Error1("pthread_atfork(): %s", strerror(rc));
+      return -1;
+   }
+   for (t = 0; t < SOCAT_MULTIOPENERS; ++t) {
+      if ((rc = pthread_create(&thread, NULL, socat_multiopener, NULL)) != 0) {
+	 Error1("pthread_create(): %s", strerror(rc));
+	 return -1;
+      }
+      pthread_detach(thread);
+   }
+   return 0;
+}
+#endif /* WITH_THREADS */
+
+/* serves the connections of the listening address sock1 with option multi,
+   in one loop per thread; does not return unless an error occurred.
+   returns -1 */
+static int socat_multi(const char *address2) {
+   struct single *lis = &sock1->stream;
+   unsigned int threads = Max(lis->para.socket.threads, 1), t;
+
+   socat_multiaddr2 = address2;
+   socat_multiflags =
+      (socat_opts.lefttoright ? XIO_WRONLY :
+       socat_opts.righttoleft ? XIO_RDONLY : XIO_RDWR) |
+      XIO_MAYCHILD|XIO_MAYCONVERT;
+   if (socat_opts.bufauto) {
+      Info1("option multi: using fixed read buffer size "F_Zu" bytes",
+	    socat_opts.bufsiz);
+      socat_opts.bufauto = false;
+   }
+   if (socat_opts.capfile != NULL) {
+      Warn("option -cf is not supported with option multi");
+   }
+   if ((socat_opts.verbose || socat_opts.verbhex) &&
+       (dumpbuf = Malloc(SOCAT_DUMPBUFSIZ)) == NULL) {
+      return -1;
+   }
+#if _WITH_SOCKET
+   if ((lis->dtype & XIODATA_READMASK) == XIOREAD_RECV) {
+      /* a datagram address */
+      return socat_sessions();
+   }
+#endif /* _WITH_SOCKET */
+   if ((socat_multiloops = Calloc(threads, sizeof(struct socat_multiloop)))
+       == NULL) {
+      return -1;
+   }
+   socat_multinloops = threads;
+   for (t = 0; t < threads; ++t) {
+      if (socat_multiinit(&socat_multiloops[t], t == 0 ? lis : NULL) < 0) {
+	 return -1;
+      }
+   }
+   if (socat_opts.logopt == 'm' && xioinqopt('l', NULL, 0) == 'm') {
+      Info("switching to syslog");
+      diag_set('y', xioopts.syslogfac);
+      xiosetopt('l', "\0");
+   }
+   /* an error of one connection must not terminate the others */
+   diag_set_int('e', E_FATAL);
+
+#if WITH_THREADS
+   {
+      sigset_t all;
+      pthread_t thread;
+      int rc;
+
+      /* signals are handled by the main thread */
+      sigfillset(&all);
+      pthread_sigmask(SIG_BLOCK, &all, &socat_multisigmask);
+      if (socat_multiopeners() < 0) {
+	 return -1;
+      }
+      for (t = 1; t < threads; ++t) {
+	 if ((rc = pthread_create(&thread, NULL, socat_multithread,
+				  &socat_multiloops[t])) != 0) {
+	    Error1("pthread_create(): %s", strerror(rc));
+	    return -1;
+	 }
+	 pthread_detach(thread);
+      }
+      pthread_sigmask(SIG_SETMASK, &socat_multisigmask, NULL);
+      if (threads > 1) {
+	 Info1("serving connections with %u threads", threads);
+      }
+   }
+#endif /* WITH_THREADS */
+   return socat_multirun(&socat_multiloops[0]);
+}
+
+#if _WITH_SOCKET
+/* option multi of a datagram address (UDP-RECVFROM, UDP-LISTEN etc.): this
+   process receives all packets on the one socket and keeps a session per
+   peer address in a hash table. Each session has its own instance of the
+   second address; what it returns is sent to the peer from the receiving
+   socket. With thread support, the opener threads open the second address,
+   and the packets of the peer that arrive meanwhile are queued. A session
+   that has not transferred a packet for the -T time, by default
+   SOCAT_SESSIDLE seconds, is closed; with max-children, packets of new peers
+   are dropped while that many sessions exist. Packets that an output does
+   not accept immediately are dropped. */
+#define SOCAT_SESSBUCKETS 4096	/* hash buckets, a power of 2 */
+#define SOCAT_SESSQUEUE 16	/* packets queued while a session opens */
+#define SOCAT_SESSIDLE 60	/* default idle timeout of a session */
+
+/* a packet that arrived while its session was opening; the data follow */
+struct socat_sesspacket {
+   struct socat_sesspacket *next;
+   size_t bytes;
+   size_t segsize;			/* see struct single */
+} ;
+
+struct socat_session {
+   struct socat_session *hnext;		/* in the hash bucket */
+   struct socat_session *iprev, *inext;	/* in the idle list, oldest first */
+   union sockaddr_union peer;
+   socklen_t peerlen;
+   unsigned int hash;
+   xiofile_t *sock2x;			/* the second address of the peer */
+   bool opening;			/* sock2x is being opened; the session
+					   is not in the idle list yet */
+   struct socat_sesspacket *qhead, **qtail;	/* queued while opening */
+   unsigned int queued;
+   int rdfd;				/* registered with epoll, or -1 */
+   struct timeval last;			/* the last packet */
+} ;
+
+static struct {
+   struct socat_session *bucket[SOCAT_SESSBUCKETS];
+   struct socat_session *ihead, *itail;
+   unsigned int nsessions;
+   int epfd;
+   unsigned char *buff;		/* 2*bufsiz+1 bytes */
+   struct timeval idle;		/* close sessions idle for so long */
+} socat_sess;
+
+/* hashes the address and port of a peer (FNV-1a) */
+static unsigned int socat_sesshash(const union sockaddr_union *peer,
+				   socklen_t peerlen) {
+   const unsigned char *p = (const unsigned char *)peer;
+   size_t len = peerlen, i;
+   unsigned int hash = 2166136261U;
+
+   switch (peer->soa.sa_family) {
+#if WITH_IP4
+   case AF_INET:
+      hash = (hash ^ (peer->ip4.sin_port & 0xff)) * 16777619U;
+      hash = (hash ^ (peer->ip4.sin_port >> 8)) * 16777619U;
+      p = (const unsigned char *)&peer->ip4.sin_addr;
+      len = sizeof(peer->ip4.sin_addr);
+      break;
+#endif
+#if WITH_IP6
+   case AF_INET6:
+      hash = (hash ^ (peer->ip6.sin6_port & 0xff)) * 16777619U;
+      hash = (hash ^ (peer->ip6.sin6_port >> 8)) * 16777619U;
+      p = (const unsigned char *)&peer->ip6.sin6_addr;
+      len = sizeof(peer->ip6.sin6_addr);
+      break;
+#endif
+   }
+   for (i = 0; i < len; ++i) {
+      hash = (hash ^ p[i]) * 16777619U;
+   }
+   return hash;
+}
+
+/* returns the session of the peer, or NULL */
+static struct socat_session *socat_sessfind(const union sockaddr_union *peer,
+					    socklen_t peerlen,
+					    unsigned int hash) {
+   struct socat_session *s;
+
+   for (s = socat_sess.bucket[hash & (SOCAT_SESSBUCKETS-1)]; s != NULL;
+	s = s->hnext) {
+      if (s->hash != hash || s->peer.soa.sa_family != peer->soa.sa_family) {
+	 continue;
+      }
+      switch (peer->soa.sa_family) {
+#if WITH_IP4
+      case AF_INET:
+	 if (s->peer.ip4.sin_port == peer->ip4.sin_port &&
+	     s->peer.ip4.sin_addr.s_addr == peer->ip4.sin_addr.s_addr) {
+	    return s;
+	 }
+	 break;
+#endif
+#if WITH_IP6
+      case AF_INET6:
+	 /* e.g. Solaris recvfrom sets a __sin6_src_id component */
+	 if (s->peer.ip6.sin6_port == peer->ip6.sin6_port &&
+	     !memcmp(&s->peer.ip6.sin6_addr, &peer->ip6.sin6_addr,
+		     sizeof(peer->ip6.sin6_addr))) {
+	    return s;
+	 }
+	 break;
+#endif
+      default:
+	 if (s->peerlen == peerlen && !memcmp(&s->peer, peer, peerlen)) {
+	    return s;
+	 }
+	 break;
+      }
+   }
+   return NULL;
+}
+
+/* moves session s to the end of the idle list, with the current time */
+static void socat_sesstouch(struct socat_session *s) {
+   gettimeofday(&s->last, NULL);
+   if (s == socat_sess.itail) {
+      return;
+   }
+   if (s->iprev)  s->iprev->inext = s->inext;
+   else           socat_sess.ihead = s->inext;
+   if (s->inext)  s->inext->iprev = s->iprev;
+   s->iprev = socat_sess.itail;  s->inext = NULL;
+   if (socat_sess.itail)  socat_sess.itail->inext = s;
+   else                   socat_sess.ihead = s;
+   socat_sess.itail = s;
+}
+
+/* removes session s from the table and frees it, with its queued packets */
+static void socat_sessfree(struct socat_session *s) {
+   struct socat_session **sp;
+   struct socat_sesspacket *p;
+
+   for (sp = &socat_sess.bucket[s->hash & (SOCAT_SESSBUCKETS-1)]; *sp != s;
+	sp = &(*sp)->hnext)
+      ;
+   *sp = s->hnext;
+   if (!s->opening) {
+      if (s->iprev)  s->iprev->inext = s->inext;
+      else           socat_sess.ihead = s->inext;
+      if (s->inext)  s->inext->iprev = s->iprev;
+      else           socat_sess.itail = s->iprev;
+   }
+   while ((p = s->qhead) != NULL) {
+      s->qhead = p->next;
+      free(p);
+   }
+   --socat_sess.nsessions;
+   free(s);
+}
+
+/* closes session s */
+static void socat_sessclose(struct socat_session *s) {
+   if (s->rdfd >= 0) {
+      Epoll_ctl(socat_sess.epfd, EPOLL_CTL_DEL, s->rdfd, NULL);
+   }
+   Info2("session of FD %d: closing, %u left", XIO_GETRDFD(s->sock2x),
+	 socat_sess.nsessions-1);
+   socat_multifree(s->sock2x);
+   socat_sessfree(s);
+}
+
+/* opens the second address for session s */
+static xiofile_t *socat_sessopen2(struct socat_session *s) {
+   return socat_multiopen2(&s->peer, s->peerlen);
+}
+
+/* passes the packet of bytes bytes in socat_sess.buff to session s.
+   returns 0 on success, or -1 if the session has been closed */
+static int socat_sessdeliver(struct socat_session *s, ssize_t bytes) {
+   if (bytes == 0) {
+      if (sock1->stream.para.socket.null_eof) {
+	 socat_sessclose(s);
+	 return -1;
+      }
+      return 0;
+   }
+   if (socat_opts.righttoleft || !XIO_WRITABLE(s->sock2x)) {
+      return 0;
+   }
+   if (xiotransfer_block(sock1, s->sock2x, &socat_sess.buff, bytes,
+			 false) < 0 && errno != EAGAIN) {
+      socat_sessclose(s);
+      return -1;
+   }
+   if (xferbuf[0].bytes > 0) {
+      Info1("dropping "F_Zu" unwritten bytes", xferbuf[0].bytes);
+      xferbuf[0].bytes = 0;
+   }
+   return 0;
+}
+
+/* keeps the packet of bytes bytes in socat_sess.buff until the second address
+   of session s has been opened */
+static void socat_sessqueue(struct socat_session *s, ssize_t bytes) {
+   struct socat_sesspacket *p;
+
+   if (s->queued >= SOCAT_SESSQUEUE) {
+      Info1("session is opening, dropping packet of "F_Zd" bytes", bytes);
+      return;
+   }
+   if ((p = Malloc(sizeof(struct socat_sesspacket)+bytes)) == NULL) {
+      return;
+   }
+   p->next = NULL;
+   p->bytes = bytes;
+   p->segsize = sock1->stream.segsize;
+   memcpy(p+1, socat_sess.buff, bytes);
+   *s->qtail = p;
+   s->qtail = &p->next;
+   ++s->queued;
+}
+
+/* the second address of session s has been opened, or failed with sock2x
+   NULL: starts to serve the session, and passes the queued packets to it.
+   returns 0 on success, or -1 if the session has been closed */
+static int socat_sessopened(struct socat_session *s) {
+   struct single *lis = &sock1->stream;
+   struct socat_sesspacket *p;
+   struct epoll_event ev;
+   ssize_t bytes;
+   int fd;
+
+   if (s->sock2x == NULL) {
+      socat_sessfree(s);
+      return -1;
+   }
+   /* a session must never block the others */
+   fd = XIO_GETWRFD(s->sock2x);
+   if (fd >= 0) {
+      Fcntl_l(fd, F_SETFL, Fcntl(fd, F_GETFL)|O_NONBLOCK);
+   }
+   fd = XIO_GETRDFD(s->sock2x);
+   if (!socat_opts.lefttoright && XIO_READABLE(s->sock2x) && fd >= 0) {
+      Fcntl_l(fd, F_SETFL, Fcntl(fd, F_GETFL)|O_NONBLOCK);
+      ev.events = EPOLLIN;
+      ev.data.ptr = s;
+      if (Epoll_ctl(socat_sess.epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+	 Error3("epoll_ctl(%d, EPOLL_CTL_ADD, %d, ...): %s",
+		socat_sess.epfd, fd, strerror(errno));
+	 socat_multifree(s->sock2x);
+	 socat_sessfree(s);
+	 return -1;
+      }
+      s->rdfd = fd;
+   }
+   s->opening = false;
+   s->iprev = socat_sess.itail;
+   if (socat_sess.itail)  socat_sess.itail->inext = s;
+   else                   socat_sess.ihead = s;
+   socat_sess.itail = s;
+   gettimeofday(&s->last, NULL);
+   while ((p = s->qhead) != NULL) {
+      s->qhead = p->next;
+      --s->queued;
+      bytes = p->bytes;
+      memcpy(socat_sess.buff, p+1, bytes);
+      lis->segsize = p->segsize;
+      free(p);
+      if (socat_sessdeliver(s, bytes) < 0) {
+	 return -1;
+      }
+   }
+   s->qtail = &s->qhead;
+   return 0;
+}
+
+/* takes the sessions that the opener threads have opened */
+static void socat_sesstake(void) {
+#if WITH_THREADS
+   struct socat_multinew new[SOCAT_MULTIACCEPT];
+   ssize_t bytes;
+   int i;
+
+   do {
+      bytes = Read(socat_multiopened[0], new, sizeof(new));
+   } while (bytes < 0 && errno == EINTR);
+   if (bytes < 0) {
+      if (errno != EAGAIN) {
+	 Error2("read(%d, ...): %s", socat_multiopened[0], strerror(errno));
+      }
+      return;
+   }
+   for (i = 0; i < bytes/(ssize_t)sizeof(new[0]); ++i) {
+      new[i].sess->sock2x = new[i].sock2x;
+      socat_sessopened(new[i].sess);
+   }
+#endif /* WITH_THREADS */
+}
+
+/* opens a session for a new peer with its own instance of the second
+   address; with opener threads, the session stays in state opening until
+   socat_sesstake() gets it back.
+   returns the session, or NULL if an error occurred */
+static struct socat_session *socat_sessopen(const union sockaddr_union *peer,
+					    socklen_t peerlen,
+					    unsigned int hash) {
+   struct socat_session *s;
+   char infobuff[256];
+
+   if ((s = Calloc(1, sizeof(struct socat_session))) == NULL) {
+      return NULL;
+   }
+   memcpy(&s->peer, peer, peerlen);
+   s->peerlen = peerlen;
+   s->hash = hash;
+   s->opening = true;
+   s->qtail = &s->qhead;
+   s->rdfd = -1;
+   if (diag_get_int('D') <= E_NOTICE) {
+      Notice1("new session of %s",
+	      sockaddr_info(&peer->soa, peerlen, infobuff, sizeof(infobuff)));
+   }
+   s->hnext = socat_sess.bucket[hash & (SOCAT_SESSBUCKETS-1)];
+   socat_sess.bucket[hash & (SOCAT_SESSBUCKETS-1)] = s;
+   ++socat_sess.nsessions;
+#if WITH_THREADS
+   if (socat_multiopen[1] >= 0) {
+      struct socat_multinew new;
+      new.cfd = NULL;  new.sock2x = NULL;  new.sess = s;
+      /* less than PIPE_BUF bytes are written atomically */
+      if (Write(socat_multiopen[1], &new, sizeof(new)) < 0) {
+	 Warn2("write(%d, ...): %s, dropping new session",
+	       socat_multiopen[1], strerror(errno));
+	 socat_sessfree(s);
+	 return NULL;
+      }
+      return s;
+   }
+#endif /* WITH_THREADS */
+   s->sock2x = socat_sessopen2(s);
+   if (socat_sessopened(s) < 0) {
+      return NULL;
+   }
+   return s;
+}
+
+/* receives the packets waiting on the socket of the first address and
+   passes each one to the session of its peer, opening new sessions */
+static void socat_sessreceive(void) {
+   struct single *lis = &sock1->stream;
+   union sockaddr_union peer;
+   socklen_t peerlen;
+   struct socat_session *s;
+   char ctrlbuff[1024];		/* ancillary messages */
+   struct msghdr msgh = {0};
+   unsigned int hash;
+   ssize_t bytes;
+   int i;
+
+   for (i = 0; i < SOCAT_MULTIACCEPT; ++i) {
+      msgh.msg_name = &peer;
+      msgh.msg_namelen = sizeof(peer);
+#if HAVE_STRUCT_MSGHDR_MSGCONTROL
+      msgh.msg_control = ctrlbuff;
+#endif
+#if HAVE_STRUCT_MSGHDR_MSGCONTROLLEN
+      msgh.msg_controllen = sizeof(ctrlbuff);
+#endif
+      if ((bytes = xiorecvpacket(lis->fd, socat_sess.buff, socat_opts.bufsiz,
+				 &msgh)) < 0) {
+	 if (errno != EAGAIN && errno != EWOULDBLOCK) {
+	    Warn2("recvmsg(%d, ...): %s", lis->fd, strerror(errno));
+	 }
+	 return;
+      }
+      peerlen = msgh.msg_namelen;
+      lis->segsize = lis->gro ? xiogrosegsize(&msgh) : 0;
+      hash = socat_sesshash(&peer, peerlen);
+      if ((s = socat_sessfind(&peer, peerlen, hash)) == NULL) {
+	 xiodopacketinfo(&msgh, true, false);
+	 if (xiocheckpeer(lis, &peer, &lis->para.socket.la) < 0) {
+	    continue;	/* drop packet */
+	 }
+	 if (lis->para.socket.maxsessions > 0 &&
+	     socat_sess.nsessions >= (unsigned int)lis->para.socket.maxsessions) {
+	    Info1("%u sessions, dropping packet of new peer",
+		  socat_sess.nsessions);
+	    continue;
+	 }
+	 if ((s = socat_sessopen(&peer, peerlen, hash)) == NULL) {
+	    continue;
+	 }
+      }
+      if (s->opening) {
+	 socat_sessqueue(s, bytes);
+	 continue;
+      }
+      socat_sesstouch(s);
+      socat_sessdeliver(s, bytes);
+   }
+}
+
+/* the second address of session s has data: sends it to the peer */
+static void socat_sessreply(struct socat_session *s) {
+   struct single *lis = &sock1->stream;
+   int bytes;
+
+   lis->peersa = s->peer;  lis->salen = s->peerlen;
+   bytes = xiotransfer(s->sock2x, sock1, &socat_sess.buff, socat_opts.bufsiz,
+		       true);
+   closing = 0;
+   if (xferbuf[1].bytes > 0) {
+      Info1("dropping "F_Zu" unwritten bytes", xferbuf[1].bytes);
+      xferbuf[1].bytes = 0;
+   }
+   if (bytes < 0 && errno == EAGAIN) {
+      return;
+   }
+   if (bytes <= 0 || XIO_RDSTREAM(s->sock2x)->eof >= 2) {
+      socat_sessclose(s);
+      return;
+   }
+   socat_sesstouch(s);
+}
+
+/* serves the peers of the datagram address sock1 with option multi; does not
+   return unless an error occurred.
+   returns -1 */
+static int socat_sessions(void) {
+   struct epoll_event events[SOCAT_MULTIEVENTS];
+   struct single *lis = &sock1->stream;
+   struct timeval now, end;
+   bool receiving, opened;
+   int timeout, n, i, d;
+
+   if ((socat_sess.buff = Malloc(2*socat_opts.bufsiz+1)) == NULL) {
+      return -1;
+   }
+   for (d = 0; d < 2; ++d) {
+      /* for cv_newline() */
+      if ((xferbuf[d].scratch = Malloc(2*socat_opts.bufsiz+1)) == NULL) {
+	 return -1;
+      }
+   }
+   socat_grocheck(sock1, socat_opts.bufsiz);
+   socat_sess.idle = socat_opts.total_timeout;
+   if (socat_sess.idle.tv_sec == 0 && socat_sess.idle.tv_usec == 0) {
+      socat_sess.idle.tv_sec = SOCAT_SESSIDLE;
+   }
+   if ((socat_sess.epfd = Epoll_create1(EPOLL_CLOEXEC)) < 0) {
+      Error1("epoll_create1(EPOLL_CLOEXEC): %s", strerror(errno));
+      return -1;
+   }
+   events[0].events = EPOLLIN;
+   events[0].data.u64 = SOCAT_MULTILISTEN;
+   if (Epoll_ctl(socat_sess.epfd, EPOLL_CTL_ADD, lis->fd, &events[0]) < 0) {
+      Error3("epoll_ctl(%d, EPOLL_CTL_ADD, %d, ...): %s",
+	     socat_sess.epfd, lis->fd, strerror(errno));
+      return -1;
+   }
+   if (socat_opts.logopt == 'm' && xioinqopt('l', NULL, 0) == 'm') {
+      Info("switching to syslog");
+      diag_set('y', xioopts.syslogfac);
+      xiosetopt('l', "\0");
+   }
+   /* an error of one session must not terminate the others */
+   diag_set_int('e', E_FATAL);
+
+#if WITH_THREADS
+   {
+      sigset_t all;
+
+      if (Pipe(socat_multiopened) < 0) {
+	 Error1("pipe(): %s", strerror(errno));
+	 return -1;
+      }
+      Fcntl_l(socat_multiopened[0], F_SETFD, FD_CLOEXEC);
+      Fcntl_l(socat_multiopened[1], F_SETFD, FD_CLOEXEC);
+      Fcntl_l(socat_multiopened[0], F_SETFL,
+	      Fcntl(socat_multiopened[0], F_GETFL)|O_NONBLOCK);
+      events[0].events = EPOLLIN;
+      events[0].data.u64 = SOCAT_MULTIHANDOFF;
+      if (Epoll_ctl(socat_sess.epfd, EPOLL_CTL_ADD, socat_multiopened[0],
+		    &events[0]) < 0) {
+	 Error3("epoll_ctl(%d, EPOLL_CTL_ADD, %d, ...): %s",
+		socat_sess.epfd, socat_multiopened[0], strerror(errno));
+	 return -1;
+      }
+      /* signals are handled by the main thread */
+      sigfillset(&all);
+      pthread_sigmask(SIG_BLOCK, &all, &socat_multisigmask);
+      if (socat_multiopeners() < 0) {
+	 return -1;
+      }
+      pthread_sigmask(SIG_SETMASK, &socat_multisigmask, NULL);
+   }
+#endif /* WITH_THREADS */
+
+   while (true) {
+      timeout = -1;
+      if (socat_sess.ihead != NULL) {
+	 gettimeofday(&now, NULL);
+	 timeradd(&socat_sess.ihead->last, &socat_sess.idle, &end);
+	 timeout = 0;
+	 if (timercmp(&now, &end, <)) {
+	    timersub(&end, &now, &end);
+	    timeout = Min(end.tv_sec, 86400)*1000 + (end.tv_usec+999)/1000;
+	 }
+      }
+      n = Epoll_wait(socat_sess.epfd, events, SOCAT_MULTIEVENTS, timeout);
+      if (n < 0) {
+	 if (errno == EINTR)  continue;
+	 Error4("epoll_wait(%d, %p, %d, ...): %s", socat_sess.epfd,
+		events, SOCAT_MULTIEVENTS, strerror(errno));
+	 return -1;
+      }
+      /* opened sessions and the packets of the first address are taken
+	 after the events of this call, so an event never meets a closed
+	 session; the queued packets of a session go before the new ones */
+      receiving = false;  opened = false;
+      for (i = 0; i < n; ++i) {
+	 if (events[i].data.u64 == SOCAT_MULTILISTEN) {
+	    receiving = true;
+	 } else if (events[i].data.u64 == SOCAT_MULTIHANDOFF) {
+	    opened = true;
+	 } else {
+	    socat_sessreply(events[i].data.ptr);
+	 }
+      }
+      if (opened) {
+	 socat_sesstake();
+      }
+      if (receiving) {
+	 socat_sessreceive();
+      }
+      if (socat_sess.ihead != NULL) {
+	 gettimeofday(&now, NULL);
+	 while (socat_sess.ihead != NULL) {
+	    timeradd(&socat_sess.ihead->last, &socat_sess.idle, &end);
+	    if (timercmp(&now, &end, <)) {
+	       break;
+	    }
+	    Info1("session of FD %d is idle",
+		  XIO_GETRDFD(socat_sess.ihead->sock2x));
+	    socat_sessclose(socat_sess.ihead);
+	 }
+      }
+      diag_flush();
+   }
+}
+#endif /* _WITH_SOCKET */
+#endif /* WITH_EPOLL */
+
+#define CR '\r'
+#define LF '\n'
+
+
+/* converts the newline characters (or character sequences) from the one
+   specified in lineterm1 to that of lineterm2. Possible values are
+   LINETERM_CR, LINETERM_CRNL, LINETERM_RAW.
+   buff points to the malloc()'ed data, input and output. bytes specifies the
+   number of bytes input and output. The line ends are searched with memchr(),
+   which the C library implements with vector instructions, and the data
+   between them is moved as a block. When the data becomes longer it is
+   converted into scratch, a buffer of the same size as *buff, and the two
+   buffers are exchanged, so no memory is allocated */
+int cv_newline(unsigned char **buff, unsigned char **scratch, ssize_t *bytes,
+	       int lineterm1, int lineterm2) {
+   /* must perform newline changes */
+   if (lineterm1 <= LINETERM_CR && lineterm2 <= LINETERM_CR) {
+      /* no change in data length */
+      unsigned char from, to,  *p, *z;
+      if (lineterm1 == LINETERM_RAW) {
+	 from = '\n'; to = '\r';
+      } else {
+	 from = '\r'; to = '\n';
+      }
+      z = *buff + *bytes;
+      p = *buff;
+      while ((p = memchr(p, from, z-p)) != NULL) {
+	 *p++ = to;
+      }
+
+   } else if (lineterm1 == LINETERM_CRNL) {
+      /* buffer becomes shorter: CR is dropped, LF becomes the new line end */
+      unsigned char to,  *s, *t, *z, *cr, *lf, *e;
+      if (lineterm2 == LINETERM_RAW) {
+	 to = '\n';
+      } else {
+	 to = '\r';
+      }
+      z = *buff + *bytes;
+      s = t = *buff;
+      cr = memchr(s, '\r', z-s);
+      /* with LINETERM_RAW LF is kept like the other characters */
+      lf = (to == '\n') ? NULL : memchr(s, '\n', z-s);
+      while (cr != NULL || lf != NULL) {
+	 e = (lf == NULL || (cr != NULL && cr < lf)) ? cr : lf;
+	 if (t != s)  memmove(t, s, e-s);
+	 t += e-s;
+	 s = e+1;
+	 if (e == cr) {
+	    cr = memchr(s, '\r', z-s);
+	 } else {
+	    *t++ = to;
+	    lf = memchr(s, '\n', z-s);
+	 }
+      }
+      if (t != s)  memmove(t, s, z-s);
+      t += z-s;
+      *bytes = t - *buff;
+   } else {
+      /* buffer becomes longer, convert into scratch */
+      unsigned char from;  unsigned char *s, *t, *z, *e;
+      if (lineterm1 == LINETERM_RAW) {
+	 from = '\n';
+      } else {
+	 from = '\r';
+      }
+      if (*scratch == NULL) {
+	 Error("cv_newline(): no scratch buffer");
+	 return -1;
+      }
+      s = *buff;  t = *scratch;  z = *buff + *bytes;
+      while ((e = memchr(s, from, z-s)) != NULL) {
+	 memcpy(t, s, e-s);
+	 t += e-s;
+	 *t++ = '\r'; *t++ = '\n';
+	 s = e+1;
+      }
+      memcpy(t, s, z-s);
+      t += z-s;
+      *bytes = t - *scratch;
+      e = *buff;  *buff = *scratch;  *scratch = e;
+   }
+   return 0;
+}
+
+void socat_signal(int signum) {
+   int _errno;
+   _errno = errno;
+   diag_in_handler = 1;
+   Notice1("socat_signal(): handling signal %d", signum);
+   switch (signum) {
+   case SIGQUIT:
+   case SIGILL:
    case SIGABRT:
    case SIGBUS:
    case SIGFPE:
@@ -1517,3 +4385,26 @@ static int socat_newchild(void) {
    havelock = false;
    return 0;
 }
+
+/* this is a callback function that is called by the listening process of
+   xio with option pool: it opens address2 the way the child process would,
+   but without fork or exec */
+static xiofile_t *socat_poolopen(void) {
+   xiofile_t *xfd, *saved = sock[1];
+   int flags = XIO_RDWR;
+   int exitlevel;
+
+   if (socat_opts.lefttoright) {
+      flags = XIO_WRONLY;
+   } else if (socat_opts.righttoleft) {
+      flags = XIO_RDONLY;
+   }
+   exitlevel = diag_get_int('e');	/* save current exit level */
+   diag_set_int('e', E_FATAL);	/* a failed connect must not terminate the
+				   listening process */
+   xfd = xioopen(socat_pooladdr, flags|XIO_MAYCONVERT|XIO_MAYNBCONNECT);
+   diag_set_int('e', exitlevel);	/* restore old exit level */
+   /* the pool, not xioexit(), takes care of the connection */
+   sock[1] = saved;
+   return xfd;
+}
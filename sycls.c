@@ -541,6 +541,36 @@ ssize_t Write(int fd, const void *buf, size_t count) {
    return result;
 }
 
+ssize_t Writev(int fd, const struct iovec *iov, int iovcnt) {
+   ssize_t result;
+   int _errno;
+   if (!diag_in_handler) diag_flush();
+   Debug3("writev(%d, %p, %d)", fd, iov, iovcnt);
+   result = writev(fd, iov, iovcnt);
+   _errno = errno;
+   if (!diag_in_handler) diag_flush();
+   Debug1("writev -> "F_Zd, result);
+   errno = _errno;
+   return result;
+}
+
+#if HAVE_SPLICE
+ssize_t Splice(int fd_in, loff_t *off_in, int fd_out, loff_t *off_out,
+	       size_t len, unsigned int flags) {
+   ssize_t result;
+   int _errno;
+   if (!diag_in_handler) diag_flush();
+   Debug6("splice(%d, %p, %d, %p, "F_Zu", 0x%x)",
+	  fd_in, off_in, fd_out, off_out, len, flags);
+   result = splice(fd_in, off_in, fd_out, off_out, len, flags);
+   _errno = errno;
+   if (!diag_in_handler) diag_flush();
+   Debug1("splice -> "F_Zd, result);
+   errno = _errno;
+   return result;
+}
+#endif /* HAVE_SPLICE */
+
 int Fcntl(int fd, int cmd) {
    int result, _errno;
    if (!diag_in_handler) diag_flush();
@@ -680,6 +710,16 @@ int Unlink(const char *pathname) {
    return retval;
 }
 
+int Rename(const char *oldpath, const char *newpath) {
+   int retval, _errno;
+   Debug2("rename(\"%s\", \"%s\")", oldpath, newpath);
+   retval = rename(oldpath, newpath);
+   _errno = errno;
+   Debug1("rename()  -> %d", retval);
+   errno = _errno;
+   return retval;
+}
+
 int Symlink(const char *oldpath, const char *newpath) {
    int retval, _errno;
    Debug2("symlink(\"%s\", \"%s\")", oldpath, newpath);
@@ -747,6 +787,123 @@ int Poll(struct pollfd *ufds, unsigned int nfds, int timeout) {
 }
 #endif /* HAVE_POLL */
 
+#if HAVE_EPOLL_CREATE1
+int Epoll_create1(int flags) {
+   int result, _errno;
+   if (!diag_in_handler) diag_flush();
+   Debug1("epoll_create1(0x%x)", flags);
+   result = epoll_create1(flags);
+   _errno = errno;
+   if (!diag_in_handler) diag_flush();
+   Debug1("epoll_create1 -> %d", result);
+   errno = _errno;
+   return result;
+}
+
+int Epoll_ctl(int epfd, int op, int fd, struct epoll_event *event) {
+   int result, _errno;
+   if (!diag_in_handler) diag_flush();
+   Debug4("epoll_ctl(%d, %d, %d, {0x%x,})", epfd, op, fd,
+	  event?event->events:0);
+   result = epoll_ctl(epfd, op, fd, event);
+   _errno = errno;
+   if (!diag_in_handler) diag_flush();
+   Debug1("epoll_ctl -> %d", result);
+   errno = _errno;
+   return result;
+}
+
+int Epoll_wait(int epfd, struct epoll_event *events, int maxevents,
+	       int timeout) {
+   int result, _errno;
+   if (!diag_in_handler) diag_flush();
+   Debug4("epoll_wait(%d, %p, %d, %d)", epfd, events, maxevents, timeout);
+   result = epoll_wait(epfd, events, maxevents, timeout);
+   _errno = errno;
+   if (!diag_in_handler) diag_flush();
+   if (result > 0) {
+      Debug3("epoll_wait -> %d, {0x%x,%d}...",
+	     result, events[0].events, events[0].data.fd);
+   } else {
+      Debug1("epoll_wait -> %d", result);
+   }
+   errno = _errno;
+   return result;
+}
+#endif /* HAVE_EPOLL_CREATE1 */
+
+#if WITH_IO_URING
+/* there are no libc functions for io_uring */
+int Io_uring_setup(unsigned int entries, struct io_uring_params *p) {
+   int result, _errno;
+   if (!diag_in_handler) diag_flush();
+   Debug2("io_uring_setup(%u, %p)", entries, p);
+   result = syscall(__NR_io_uring_setup, entries, p);
+   _errno = errno;
+   if (!diag_in_handler) diag_flush();
+   Debug1("io_uring_setup -> %d", result);
+   errno = _errno;
+   return result;
+}
+
+int Io_uring_enter(int fd, unsigned int to_submit, unsigned int min_complete,
+		   unsigned int flags) {
+   int result, _errno;
+   if (!diag_in_handler) diag_flush();
+   Debug4("io_uring_enter(%d, %u, %u, 0x%x, NULL, 0)",
+	  fd, to_submit, min_complete, flags);
+   result = syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags,
+		    NULL, 0);
+   _errno = errno;
+   if (!diag_in_handler) diag_flush();
+   Debug1("io_uring_enter -> %d", result);
+   errno = _errno;
+   return result;
+}
+
+int Io_uring_register(int fd, unsigned int opcode, void *arg,
+		      unsigned int nr_args) {
+   int result, _errno;
+   if (!diag_in_handler) diag_flush();
+   Debug4("io_uring_register(%d, %u, %p, %u)", fd, opcode, arg, nr_args);
+   result = syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+   _errno = errno;
+   if (!diag_in_handler) diag_flush();
+   Debug1("io_uring_register -> %d", result);
+   errno = _errno;
+   return result;
+}
+#endif /* WITH_IO_URING */
+
+#if HAVE_SYS_MMAN_H
+void *Mmap(void *addr, size_t length, int prot, int flags, int fd,
+	   off_t offset) {
+   void *result;
+   int _errno;
+   if (!diag_in_handler) diag_flush();
+   Debug6("mmap(%p, "F_Zu", 0x%x, 0x%x, %d, "F_off")",
+	  addr, length, prot, flags, fd, offset);
+   result = mmap(addr, length, prot, flags, fd, offset);
+   _errno = errno;
+   if (!diag_in_handler) diag_flush();
+   Debug1("mmap -> %p", result);
+   errno = _errno;
+   return result;
+}
+
+int Munmap(void *addr, size_t length) {
+   int result, _errno;
+   if (!diag_in_handler) diag_flush();
+   Debug2("munmap(%p, "F_Zu")", addr, length);
+   result = munmap(addr, length);
+   _errno = errno;
+   if (!diag_in_handler) diag_flush();
+   Debug1("munmap -> %d", result);
+   errno = _errno;
+   return result;
+}
+#endif /* HAVE_SYS_MMAN_H */
+
 /* we only show the first word of the fd_set's; hope this is enough for most
    cases. */
 int Select(int n, fd_set *readfds, fd_set *writefds, fd_set *exceptfds,
@@ -841,6 +998,18 @@ int Sigprocmask(int how, const sigset_t *set, sigset_t *oset) {
    return retval;
 }
 
+#if HAVE_SIGNALFD
+int Signalfd(int fd, const sigset_t *mask, int flags) {
+   int retval, _errno;
+   Debug3("signalfd(%d, %p, 0x%x)", fd, mask, flags);
+   retval = signalfd(fd, mask, flags);
+   _errno = errno;
+   Debug1("signalfd() -> %d", retval);
+   errno = _errno;
+   return retval;
+}
+#endif /* HAVE_SIGNALFD */
+
 unsigned int Alarm(unsigned int seconds) {
    unsigned int retval;
    Debug1("alarm(%u)", seconds);
@@ -1002,19 +1171,42 @@ int Accept(int s, struct sockaddr *addr, socklen_t *addrlen) {
    result = accept(s, addr, addrlen);
    _errno = errno;
    if (!diag_in_handler) diag_flush();
-   if (result >= 0) {
+   if (result >= 0 && diag_get_int('D') <= E_INFO) {
       char infobuff[256];
-      sockaddr_info(addr, *addrlen, infobuff, sizeof(infobuff));
       Info5("accept(%d, {%d, %s}, "F_socklen") -> %d", s,
 	    addr->sa_family,
 	    sockaddr_info(addr, *addrlen, infobuff, sizeof(infobuff)),
 	    *addrlen, result);
-   } else {
+   } else if (result < 0) {
       Debug1("accept(,,) -> %d", result);
    }
    errno = _errno;
    return result;
 }
+
+#if HAVE_ACCEPT4
+/* unlike Accept(), does not wait for a connection: with a nonblocking
+   socket it fails with EAGAIN when none is pending */
+int Accept4(int s, struct sockaddr *addr, socklen_t *addrlen, int flags) {
+   int result, _errno;
+   if (!diag_in_handler) diag_flush();
+   Debug4("accept4(%d, %p, %p, 0x%x)", s, addr, addrlen, flags);
+   result = accept4(s, addr, addrlen, flags);
+   _errno = errno;
+   if (!diag_in_handler) diag_flush();
+   if (result >= 0 && diag_get_int('D') <= E_INFO) {
+      char infobuff[256];
+      Info5("accept4(%d, {%d, %s}, "F_socklen") -> %d", s,
+	    addr->sa_family,
+	    sockaddr_info(addr, *addrlen, infobuff, sizeof(infobuff)),
+	    *addrlen, result);
+   } else if (result < 0) {
+      Debug1("accept4(,,,) -> %d", result);
+   }
+   errno = _errno;
+   return result;
+}
+#endif /* HAVE_ACCEPT4 */
 #endif /* _WITH_SOCKET */
 
 #if _WITH_SOCKET
@@ -1156,6 +1348,21 @@ int Recvmsg(int s, struct msghdr *msgh, int flags) {
 }
 #endif /* _WITH_SOCKET */
 
+#if _WITH_SOCKET && HAVE_RECVMMSG
+int Recvmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags,
+	     struct timespec *timeout) {
+   int retval, _errno;
+   if (!diag_in_handler) diag_flush();
+   Debug5("recvmmsg(%d, %p, %u, %d, %p)", s, msgvec, vlen, flags, timeout);
+   retval = recvmmsg(s, msgvec, vlen, flags, timeout);
+   _errno = errno;
+   if (!diag_in_handler) diag_flush();
+   Debug1("recvmmsg() -> %d", retval);
+   errno = _errno;
+   return retval;
+}
+#endif /* _WITH_SOCKET && HAVE_RECVMMSG */
+
 #if _WITH_SOCKET
 int Send(int s, const void *mesg, size_t len, int flags) {
    int retval, _errno;
@@ -1190,6 +1397,34 @@ int Sendto(int s, const void *mesg, size_t len, int flags,
 }
 #endif /* _WITH_SOCKET */
 
+#if _WITH_SOCKET
+int Sendmsg(int s, const struct msghdr *msgh, int flags) {
+   int retval, _errno;
+   if (!diag_in_handler) diag_flush();
+   Debug3("sendmsg(%d, %p, %d)", s, msgh, flags);
+   retval = sendmsg(s, msgh, flags);
+   _errno = errno;
+   if (!diag_in_handler) diag_flush();
+   Debug1("sendmsg() -> %d", retval);
+   errno = _errno;
+   return retval;
+}
+#endif /* _WITH_SOCKET */
+
+#if _WITH_SOCKET && HAVE_SENDMMSG
+int Sendmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags) {
+   int retval, _errno;
+   if (!diag_in_handler) diag_flush();
+   Debug4("sendmmsg(%d, %p, %u, %d)", s, msgvec, vlen, flags);
+   retval = sendmmsg(s, msgvec, vlen, flags);
+   _errno = errno;
+   if (!diag_in_handler) diag_flush();
+   Debug1("sendmmsg() -> %d", retval);
+   errno = _errno;
+   return retval;
+}
+#endif /* _WITH_SOCKET && HAVE_SENDMMSG */
+
 #if _WITH_SOCKET
 int Shutdown(int fd, int how) {
    int retval, _errno;
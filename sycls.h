@@ -56,6 +56,11 @@ int Dup2(int oldfd, int newfd);
 int Pipe(int filedes[2]);
 ssize_t Read(int fd, void *buf, size_t count);
 ssize_t Write(int fd, const void *buf, size_t count);
+ssize_t Writev(int fd, const struct iovec *iov, int iovcnt);
+#if HAVE_SPLICE
+ssize_t Splice(int fd_in, loff_t *off_in, int fd_out, loff_t *off_out,
+	       size_t len, unsigned int flags);
+#endif /* HAVE_SPLICE */
 int Fcntl(int fd, int cmd);
 int Fcntl_l(int fd, int cmd, long arg);
 int Fcntl_lock(int fd, int cmd, struct flock *l);
@@ -70,11 +75,30 @@ int Close(int fd);
 int Fchown(int fd, uid_t owner, gid_t group);
 int Fchmod(int fd, mode_t mode);
 int Unlink(const char *pathname);
+int Rename(const char *oldpath, const char *newpath);
 int Symlink(const char *oldpath, const char *newpath);
 int Readlink(const char *path, char *buf, size_t bufsiz);
 int Chown(const char *path, uid_t owner, gid_t group);
 int Chmod(const char *path, mode_t mode);
 int Poll(struct pollfd *ufds, unsigned int nfds, int timeout);
+#if HAVE_EPOLL_CREATE1
+int Epoll_create1(int flags);
+int Epoll_ctl(int epfd, int op, int fd, struct epoll_event *event);
+int Epoll_wait(int epfd, struct epoll_event *events, int maxevents,
+	       int timeout);
+#endif /* HAVE_EPOLL_CREATE1 */
+#if WITH_IO_URING
+int Io_uring_setup(unsigned int entries, struct io_uring_params *p);
+int Io_uring_enter(int fd, unsigned int to_submit, unsigned int min_complete,
+		   unsigned int flags);
+int Io_uring_register(int fd, unsigned int opcode, void *arg,
+		      unsigned int nr_args);
+#endif /* WITH_IO_URING */
+#if HAVE_SYS_MMAN_H
+void *Mmap(void *addr, size_t length, int prot, int flags, int fd,
+	   off_t offset);
+int Munmap(void *addr, size_t length);
+#endif /* HAVE_SYS_MMAN_H */
 int Select(int n, fd_set *readfds, fd_set *writefds, fd_set *exceptfds,
 	   struct timeval *timeout);
 pid_t Fork(void);
@@ -86,6 +110,9 @@ sighandler_t Signal(int signum, sighandler_t handler);
 int Sigaction(int signum, const struct sigaction *act,
 	      struct sigaction *oldact);
 int Sigprocmask(int how, const sigset_t *set, sigset_t *oset);
+#if HAVE_SIGNALFD
+int Signalfd(int fd, const sigset_t *mask, int flags);
+#endif
 unsigned int Alarm(unsigned int seconds);
 int Kill(pid_t pid, int sig);
 int Link(const char *oldpath, const char *newpath);
@@ -98,6 +125,9 @@ int Bind(int sockfd, struct sockaddr *my_addr, socklen_t addrlen);
 int Connect(int sockfd, const struct sockaddr *serv_addr, socklen_t addrlen);
 int Listen(int s, int backlog);
 int Accept(int s, struct sockaddr *addr, socklen_t *addrlen);
+#if HAVE_ACCEPT4
+int Accept4(int s, struct sockaddr *addr, socklen_t *addrlen, int flags);
+#endif
 int Getsockname(int s, struct sockaddr *name, socklen_t *namelen);
 int Getpeername(int s, struct sockaddr *name, socklen_t *namelen);
 int Getsockopt(int s, int level, int optname, void *optval, socklen_t *optlen);
@@ -106,9 +136,17 @@ int Recv(int s, void *buf, size_t len, int flags);
 int Recvfrom(int s, void *buf, size_t len, int flags, struct sockaddr *from,
 	     socklen_t *fromlen);
 int Recvmsg(int s, struct msghdr *msg, int flags);
+#if HAVE_RECVMMSG
+int Recvmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags,
+	     struct timespec *timeout);
+#endif
 int Send(int s, const void *mesg, size_t len, int flags);
 int Sendto(int s, const void *msg, size_t len, int flags,
 	   const struct sockaddr *to, socklen_t tolen);
+int Sendmsg(int s, const struct msghdr *msgh, int flags);
+#if HAVE_SENDMMSG
+int Sendmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags);
+#endif
 int Shutdown(int fd, int how);
 #endif /* _WITH_SOCKET */
 unsigned int Sleep(unsigned int seconds);
@@ -193,6 +231,8 @@ void Add_history(const char *string);
 #define Pipe(f) pipe(f)
 #define Read(f,b,c) read(f,b,c)
 #define Write(f,b,c) write(f,b,c)
+#define Writev(f,v,c) writev(f,v,c)
+#define Splice(fi,oi,fo,oo,l,f) splice(fi,oi,fo,oo,l,f)
 #define Fcntl(f,c) fcntl(f,c)
 #define Fcntl_l(f,c,a) fcntl(f,c,a)
 #define Fcntl_lock(f,c,l) fcntl(f,c,l)
@@ -205,17 +245,27 @@ void Add_history(const char *string);
 #define Fchown(f,o,g) fchown(f,o,g)
 #define Fchmod(f,m) fchmod(f,m)
 #define Unlink(p) unlink(p)
+#define Rename(o,n) rename(o,n)
 #define Symlink(op,np) symlink(op,np)
 #define Readlink(p,b,s) readlink(p,b,s)
 #define Chown(p,o,g) chown(p,o,g)
 #define Chmod(p,m) chmod(p,m)
 #define Poll(u, n, t) poll(u, n, t)
+#define Epoll_create1(f) epoll_create1(f)
+#define Epoll_ctl(e,o,f,v) epoll_ctl(e,o,f,v)
+#define Epoll_wait(e,v,m,t) epoll_wait(e,v,m,t)
+#define Io_uring_setup(e,p) syscall(__NR_io_uring_setup,e,p)
+#define Io_uring_enter(f,s,m,l) syscall(__NR_io_uring_enter,f,s,m,l,NULL,0)
+#define Io_uring_register(f,o,a,n) syscall(__NR_io_uring_register,f,o,a,n)
+#define Mmap(a,l,p,f,d,o) mmap(a,l,p,f,d,o)
+#define Munmap(a,l) munmap(a,l)
 #define Select(n,r,w,e,t) select(n,r,w,e,t)
 #define Fork() fork()
 #define Waitpid(p,s,o) waitpid(p,s,o)
 #define Signal(s,h) signal(s,h)
 #define Sigaction(s,a,o) sigaction(s,a,o)
 #define Sigprocmask(h,s,o) sigprocmask(h,s,o)
+#define Signalfd(d,m,f) signalfd(d,m,f)
 #define Alarm(s) alarm(s)
 #define Kill(p,s) kill(p,s)
 #define Link(o,n) link(o,n)
@@ -227,6 +277,7 @@ void Add_history(const char *string);
 #define Connect(s,a,l) connect(s,a,l)
 #define Listen(s,b) listen(s,b)
 #define Accept(s,a,l) accept(s,a,l)
+#define Accept4(s,a,l,f) accept4(s,a,l,f)
 #define Getsockname(s,n,l) getsockname(s,n,l)
 #define Getpeername(s,n,l) getpeername(s,n,l)
 #define Getsockopt(s,d,n,v,l) getsockopt(s,d,n,v,l)
@@ -234,8 +285,11 @@ void Add_history(const char *string);
 #define Recv(s,b,l,f) recv(s,b,l,f)
 #define Recvfrom(s,b,bl,f,fr,fl) recvfrom(s,b,bl,f,fr,fl)
 #define Recvmsg(s,m,f) recvmsg(s,m,f)
+#define Recvmmsg(s,m,v,f,t) recvmmsg(s,m,v,f,t)
 #define Send(s,m,l,f) send(s,m,l,f)
 #define Sendto(s,b,bl,f,t,tl) sendto(s,b,bl,f,t,tl)
+#define Sendmsg(s,m,f) sendmsg(s,m,f)
+#define Sendmmsg(s,m,v,f) sendmmsg(s,m,v,f)
 #define Shutdown(f,h) shutdown(f,h)
 #define Sleep(s) sleep(s)
 #define Usleep(u) usleep(u)
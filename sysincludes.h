@@ -89,6 +89,28 @@
 #if HAVE_SYS_SELECT_H
 #include <sys/select.h>	/* select(), fdset on AIX 4.1 */
 #endif
+#if HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>	/* epoll_create1(), epoll_wait() */
+#endif
+#if HAVE_SYS_SIGNALFD_H
+#include <sys/signalfd.h>	/* signalfd(), struct signalfd_siginfo */
+#endif
+#if HAVE_SCHED_H
+#include <sched.h>	/* sched_setaffinity(), cpu_set_t */
+#endif
+#if HAVE_SYS_PRCTL_H
+#include <sys/prctl.h>	/* prctl(), PR_SET_PDEATHSIG */
+#endif
+#if WITH_THREADS
+#include <pthread.h>	/* pthread_create(), pthread_mutex_lock() */
+#endif
+#if WITH_IO_URING
+#include <sys/syscall.h>	/* __NR_io_uring_setup */
+#include <linux/io_uring.h>
+#endif
+#if HAVE_SYS_MMAN_H
+#include <sys/mman.h>	/* mmap() */
+#endif
 #if HAVE_SYS_FILE_H
 #include <sys/file.h>	/* LOCK_EX, on AIX directly included */
 #endif
@@ -107,6 +129,9 @@
 #  if HAVE_NETINET_TCP_H
 #include <netinet/tcp.h>	/* TCP_RFC1323 */
 #  endif
+#  if HAVE_NETINET_UDP_H
+#include <netinet/udp.h>	/* UDP_SEGMENT, UDP_GRO */
+#  endif
 #  if HAVE_NETINET_IP6_H && _WITH_IP6
 #include <netinet/ip6.h>
 #  endif
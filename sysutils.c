@@ -16,6 +16,10 @@
 #include "utils.h"
 #include "sysutils.h"
 
+#if WITH_THREADS
+pthread_mutex_t xio_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
 /* Substitute for Write():
    Try to write all bytes before returning; this handles EINTR,
    EAGAIN/EWOULDBLOCK, and partial write situations. The drawback is that this
@@ -51,6 +55,38 @@ ssize_t writefull(int fd, const void *buff, size_t bytes) {
    return writt;
 }
 
+/* Substitute for Write() on the data path:
+   Write as many bytes as the FD accepts without waiting; this handles EINTR
+   and partial write situations. With EAGAIN/EWOULDBLOCK it returns the number
+   of bytes written so far, and the caller must keep the rest until the FD
+   becomes writeable again. Never sleeps; but with a blocking FD the write()
+   call itself may block.
+   Returns <0 on unhandled error, errno valid
+   Will only return <0 or the number of bytes written (0..bytes)
+*/
+ssize_t writeavail(int fd, const void *buff, size_t bytes) {
+   size_t writt = 0;
+   ssize_t chk;
+   while (writt < bytes) {
+      chk = Write(fd, (const char *)buff + writt, bytes - writt);
+      if (chk < 0) {
+	 switch (errno) {
+	 case EINTR:
+	    continue;
+	 case EAGAIN:
+#if EAGAIN != EWOULDBLOCK
+	 case EWOULDBLOCK:
+#endif
+	    Info4("write(%d, %p, "F_Zu"): %s", fd, (const char *)buff+writt, bytes-writt, strerror(errno));
+	    return writt;
+	 default: return -1;
+	 }
+      }
+      writt += chk;
+   }
+   return writt;
+}
+
 #if WITH_UNIX
 void socket_un_init(struct sockaddr_un *sa) {
 #if HAVE_STRUCT_SOCKADDR_SALEN
@@ -555,6 +591,312 @@ int xiopoll(struct pollfd fds[], unsigned long nfds, struct timeval *timeout) {
 #endif /* !HAVE_POLL */
    }
 }
+
+
+#if WITH_EPOLL
+/* creates the epoll instance; on failure the instance falls back to
+   xiopoll().
+   returns 0 on success or -1 if an error occurred */
+int xioepoll_init(struct xioepoll *ep) {
+   ep->nreg = 0;
+   if ((ep->epfd = Epoll_create1(EPOLL_CLOEXEC)) < 0) {
+      Warn1("epoll_create1(EPOLL_CLOEXEC): %s, using select()",
+	    strerror(errno));
+      return -1;
+   }
+   return 0;
+}
+
+/* drops the epoll instance; further calls of xioepoll() use xiopoll() */
+void xioepoll_close(struct xioepoll *ep) {
+   if (ep->epfd >= 0) {
+      Close(ep->epfd);
+      ep->epfd = -1;
+   }
+   ep->nreg = 0;
+}
+
+/* updates the registration of fd in the epoll instance to events; 0 removes
+   it.
+   returns 0 on success or -1 if an error occurred */
+static int xioepoll_reg(struct xioepoll *ep, int fd, uint32_t events) {
+   struct epoll_event ev;
+   unsigned int i;
+
+   for (i = 0; i < ep->nreg; ++i) {
+      if (ep->reg[i].fd == fd)  break;
+   }
+   if (i < ep->nreg ? ep->reg[i].events == events : events == 0) {
+      return 0;
+   }
+   ev.events = events;
+   ev.data.fd = fd;
+   if (events == 0) {
+      /* the FD might already be closed, which removed it from the set */
+      Epoll_ctl(ep->epfd, EPOLL_CTL_DEL, fd, &ev);
+      ep->reg[i] = ep->reg[--ep->nreg];
+      return 0;
+   }
+   if (i < ep->nreg) {
+      if (Epoll_ctl(ep->epfd, EPOLL_CTL_MOD, fd, &ev) == 0) {
+	 ep->reg[i].events = events;
+	 return 0;
+      }
+      if (errno != ENOENT) {
+	 return -1;
+      }
+      /* FD was closed and its number reused */
+      ep->reg[i] = ep->reg[--ep->nreg];
+   }
+   if (Epoll_ctl(ep->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+      return -1;
+   }
+   ep->reg[ep->nreg].fd = fd;
+   ep->reg[ep->nreg].events = events;
+   ++ep->nreg;
+   return 0;
+}
+
+/* like xiopoll(), but waits with the epoll instance ep. The FDs stay
+   registered between calls; epoll_ctl() is only called for FDs whose wanted
+   events changed. When an FD cannot be used with epoll (e.g. a regular
+   file), the instance is dropped and xiopoll() is used from now on */
+int xioepoll(struct xioepoll *ep, struct pollfd fds[], unsigned long nfds,
+	     struct timeval *timeout) {
+   struct epoll_event events[XIOEPOLL_MAXFDS];
+   uint32_t want[XIOEPOLL_MAXFDS];
+   int wantfd[XIOEPOLL_MAXFDS];
+   unsigned int nwant = 0, i, j;
+   int ms, result, n = 0;
+
+   if (ep->epfd < 0 || nfds > XIOEPOLL_MAXFDS) {
+      return xiopoll(fds, nfds, timeout);
+   }
+
+   /* merge the events of entries with the same FD, e.g. a socket that is
+      polled for reading and writing */
+   for (i = 0; i < nfds; ++i) {
+      fds[i].revents = 0;
+      if (fds[i].fd < 0)  continue;
+      for (j = 0; j < nwant; ++j) {
+	 if (wantfd[j] == fds[i].fd)  break;
+      }
+      if (j == nwant) {
+	 wantfd[j] = fds[i].fd;  want[j] = 0;  ++nwant;
+      }
+      if (fds[i].events & POLLIN)   want[j] |= EPOLLIN;
+      if (fds[i].events & POLLOUT)  want[j] |= EPOLLOUT;
+   }
+
+   /* remove FDs that are no longer wanted */
+   for (i = 0; i < ep->nreg; ) {
+      for (j = 0; j < nwant; ++j) {
+	 if (wantfd[j] == ep->reg[i].fd)  break;
+      }
+      if (j == nwant) {
+	 xioepoll_reg(ep, ep->reg[i].fd, 0);	/* moves last entry to i */
+      } else {
+	 ++i;
+      }
+   }
+   for (j = 0; j < nwant; ++j) {
+      if (xioepoll_reg(ep, wantfd[j], want[j]) < 0) {
+	 if (errno == EPERM) {
+	    /* regular files and directories do not support epoll */
+	    Info1("epoll_ctl(, , %d, ): not supported, using select()",
+		  wantfd[j]);
+	    xioepoll_close(ep);
+	    return xiopoll(fds, nfds, timeout);
+	 }
+	 return -1;
+      }
+   }
+
+   if (timeout == NULL) {
+      ms = -1;
+   } else {
+      ms = 1000*timeout->tv_sec + timeout->tv_usec/1000;
+   }
+   if ((result = Epoll_wait(ep->epfd, events, XIOEPOLL_MAXFDS, ms)) <= 0) {
+      return result;
+   }
+   for (j = 0; j < (unsigned int)result; ++j) {
+      for (i = 0; i < nfds; ++i) {
+	 if (fds[i].fd != events[j].data.fd)  continue;
+	 if ((fds[i].events & POLLIN)  && (events[j].events & EPOLLIN))
+	    fds[i].revents |= POLLIN;
+	 if ((fds[i].events & POLLOUT) && (events[j].events & EPOLLOUT))
+	    fds[i].revents |= POLLOUT;
+	 if (events[j].events & EPOLLERR)  fds[i].revents |= POLLERR;
+	 if (events[j].events & EPOLLHUP)  fds[i].revents |= POLLHUP;
+      }
+   }
+   for (i = 0; i < nfds; ++i) {
+      if (fds[i].revents)  ++n;
+   }
+   return n;
+}
+#endif /* WITH_EPOLL */
+
+
+#if WITH_IO_URING
+/* creates an io_uring instance with entries submission queue entries and
+   maps its rings. ops is a list of nops IORING_OP_* that the kernel must
+   support.
+   returns 0 on success, or -1 if io_uring is not available (the reason has
+   been logged as warning) */
+int xiouring_init(struct xiouring *ur, unsigned int entries,
+		  const int *ops, int nops) {
+   struct io_uring_params p;
+   struct io_uring_probe *probe;
+   size_t probesz;
+   int i;
+
+   memset(ur, 0, sizeof(*ur));
+   memset(&p, 0, sizeof(p));
+   if ((ur->fd = Io_uring_setup(entries, &p)) < 0) {
+      Warn2("io_uring_setup(%u, ...): %s", entries, strerror(errno));
+      return -1;
+   }
+   ur->entries = p.sq_entries;
+
+   /* the kernel must know all the operations we use */
+   probesz = sizeof(struct io_uring_probe) +
+      256*sizeof(struct io_uring_probe_op);
+   if ((probe = Calloc(1, probesz)) == NULL) {
+      xiouring_close(ur);
+      return -1;
+   }
+   if (Io_uring_register(ur->fd, IORING_REGISTER_PROBE, probe, 256) < 0) {
+      Warn1("io_uring_register(, IORING_REGISTER_PROBE, ...): %s",
+	    strerror(errno));
+      free(probe);
+      xiouring_close(ur);
+      return -1;
+   }
+   for (i = 0; i < nops; ++i) {
+      if (ops[i] > probe->last_op ||
+	  !(probe->ops[ops[i]].flags & IO_URING_OP_SUPPORTED)) {
+	 Warn1("io_uring: kernel does not support operation %d", ops[i]);
+	 free(probe);
+	 xiouring_close(ur);
+	 return -1;
+      }
+   }
+   free(probe);
+
+   ur->sqringsz = p.sq_off.array + p.sq_entries*sizeof(unsigned int);
+   ur->cqringsz = p.cq_off.cqes + p.cq_entries*sizeof(struct io_uring_cqe);
+   if (p.features & IORING_FEAT_SINGLE_MMAP) {
+      ur->sqringsz = ur->cqringsz = MAX(ur->sqringsz, ur->cqringsz);
+   }
+   ur->sqring = Mmap(NULL, ur->sqringsz, PROT_READ|PROT_WRITE,
+		     MAP_SHARED|MAP_POPULATE, ur->fd, IORING_OFF_SQ_RING);
+   if (ur->sqring == MAP_FAILED) {
+      Warn1("mmap(..., IORING_OFF_SQ_RING): %s", strerror(errno));
+      ur->sqring = NULL;
+      xiouring_close(ur);
+      return -1;
+   }
+   if (p.features & IORING_FEAT_SINGLE_MMAP) {
+      ur->cqring = ur->sqring;
+   } else {
+      ur->cqring = Mmap(NULL, ur->cqringsz, PROT_READ|PROT_WRITE,
+			MAP_SHARED|MAP_POPULATE, ur->fd, IORING_OFF_CQ_RING);
+      if (ur->cqring == MAP_FAILED) {
+	 Warn1("mmap(..., IORING_OFF_CQ_RING): %s", strerror(errno));
+	 ur->cqring = NULL;
+	 xiouring_close(ur);
+	 return -1;
+      }
+   }
+   ur->sqessz = p.sq_entries*sizeof(struct io_uring_sqe);
+   ur->sqes = Mmap(NULL, ur->sqessz, PROT_READ|PROT_WRITE,
+		   MAP_SHARED|MAP_POPULATE, ur->fd, IORING_OFF_SQES);
+   if (ur->sqes == MAP_FAILED) {
+      Warn1("mmap(..., IORING_OFF_SQES): %s", strerror(errno));
+      ur->sqes = NULL;
+      xiouring_close(ur);
+      return -1;
+   }
+   ur->sqhead  = (unsigned int *)((char *)ur->sqring + p.sq_off.head);
+   ur->sqtail  = (unsigned int *)((char *)ur->sqring + p.sq_off.tail);
+   ur->sqmask  = (unsigned int *)((char *)ur->sqring + p.sq_off.ring_mask);
+   ur->sqarray = (unsigned int *)((char *)ur->sqring + p.sq_off.array);
+   ur->cqhead  = (unsigned int *)((char *)ur->cqring + p.cq_off.head);
+   ur->cqtail  = (unsigned int *)((char *)ur->cqring + p.cq_off.tail);
+   ur->cqmask  = (unsigned int *)((char *)ur->cqring + p.cq_off.ring_mask);
+   ur->cqes = (struct io_uring_cqe *)((char *)ur->cqring + p.cq_off.cqes);
+   Info2("io_uring instance %d with %u entries", ur->fd, ur->entries);
+   return 0;
+}
+
+/* returns a cleared submission queue entry that will be submitted with the
+   next xiouring_enter(), or NULL when the submission queue is full */
+struct io_uring_sqe *xiouring_getsqe(struct xiouring *ur) {
+   unsigned int tail = *ur->sqtail;
+   unsigned int index;
+   struct io_uring_sqe *sqe;
+
+   if (tail - __atomic_load_n(ur->sqhead, __ATOMIC_ACQUIRE) >= ur->entries) {
+      return NULL;
+   }
+   index = tail & *ur->sqmask;
+   sqe = &ur->sqes[index];
+   memset(sqe, 0, sizeof(*sqe));
+   ur->sqarray[index] = index;
+   __atomic_store_n(ur->sqtail, tail+1, __ATOMIC_RELEASE);
+   ++ur->queued;
+   return sqe;
+}
+
+/* submits the prepared requests and waits until at least waitnr requests
+   have completed.
+   returns the number of submitted requests, or -1 if an error occurred
+   (errno is EINTR when a signal arrived) */
+int xiouring_enter(struct xiouring *ur, unsigned int waitnr) {
+   int result;
+
+   ++ur->enters;
+   result = Io_uring_enter(ur->fd, ur->queued, waitnr,
+			   waitnr ? IORING_ENTER_GETEVENTS : 0);
+   if (result < 0) {
+      return -1;
+   }
+   ur->queued -= result;
+   ur->submitted += result;
+   return result;
+}
+
+/* returns the next completion queue entry or NULL when there is none.
+   xiouring_cqeseen() releases it */
+struct io_uring_cqe *xiouring_peekcqe(struct xiouring *ur) {
+   unsigned int head = *ur->cqhead;
+
+   if (head == __atomic_load_n(ur->cqtail, __ATOMIC_ACQUIRE)) {
+      return NULL;
+   }
+   return &ur->cqes[head & *ur->cqmask];
+}
+
+void xiouring_cqeseen(struct xiouring *ur) {
+   __atomic_store_n(ur->cqhead, *ur->cqhead+1, __ATOMIC_RELEASE);
+}
+
+/* unmaps the rings and closes the instance; the kernel cancels requests that
+   are still pending */
+void xiouring_close(struct xiouring *ur) {
+   if (ur->sqes != NULL)  Munmap(ur->sqes, ur->sqessz);
+   if (ur->cqring != NULL && ur->cqring != ur->sqring)
+      Munmap(ur->cqring, ur->cqringsz);
+   if (ur->sqring != NULL)  Munmap(ur->sqring, ur->sqringsz);
+   ur->sqes = NULL;  ur->sqring = ur->cqring = NULL;
+   if (ur->fd >= 0) {
+      Close(ur->fd);
+      ur->fd = -1;
+   }
+}
+#endif /* WITH_IO_URING */
    
 
 #if WITH_TCP || WITH_UDP
@@ -669,9 +1011,11 @@ int ifindex(const char *ifname, unsigned int *ifindex, int anysock) {
 int _xiosetenv(const char *envname, const char *value, int overwrite, const char *sep) {
    char *oldval;
    char *newval;
+   xiolockstate();
    if (overwrite >= 2 && (oldval = getenv(envname)) != NULL) {
       size_t newlen = strlen(oldval)+strlen(sep)+strlen(value)+1;
       if ((newval = Malloc(newlen+1)) == NULL) {
+	 xiounlockstate();
 	 return -1;
       }
       snprintf(newval, newlen+1, "%s%s%s", oldval, sep, value);
@@ -684,8 +1028,10 @@ int _xiosetenv(const char *envname, const char *value, int overwrite, const char
 #if HAVE_UNSETENV
       Unsetenv(envname);      /* dont want to have a wrong value */
 #endif
+      xiounlockstate();
       return -1;
    }
+   xiounlockstate();
    return 0;
 }
 
@@ -40,7 +40,19 @@ struct xiorange {
 } ;
 #endif /* _WITH_SOCKET */
 
+#if WITH_THREADS
+/* serializes the changes of sock[] and of the environment by the threads of
+   option multi */
+extern pthread_mutex_t xio_mutex;
+#define xiolockstate()   pthread_mutex_lock(&xio_mutex)
+#define xiounlockstate() pthread_mutex_unlock(&xio_mutex)
+#else
+#define xiolockstate()
+#define xiounlockstate()
+#endif /* !WITH_THREADS */
+
 extern ssize_t writefull(int fd, const void *buff, size_t bytes);
+extern ssize_t writeavail(int fd, const void *buff, size_t bytes);
 
 #if _WITH_SOCKET
 extern socklen_t socket_init(int af, union sockaddr_union *sa);
@@ -83,6 +95,54 @@ extern const char *hstrerror(int err);
 
 extern int xiopoll(struct pollfd fds[], unsigned long nfds, struct timeval *timeout);
 
+/* event backends of the data transfer loop */
+#define XIOPOLL_SELECT	1	/* xiopoll(): select(), or poll() for high FDs */
+#define XIOPOLL_EPOLL	2	/* xioepoll(): Linux epoll */
+#define XIOPOLL_IO_URING 3	/* Linux io_uring transfer engine */
+
+#if WITH_EPOLL
+#define XIOEPOLL_MAXFDS 4
+/* an epoll instance that keeps the FD registrations between calls, so only
+   changes of the wanted events cost a system call */
+struct xioepoll {
+   int epfd;		/* -1: not available, xioepoll() uses xiopoll() */
+   unsigned int nreg;	/* number of valid entries in reg */
+   struct {
+      int fd;
+      uint32_t events;	/* EPOLLIN, EPOLLOUT */
+   } reg[XIOEPOLL_MAXFDS];
+} ;
+extern int xioepoll_init(struct xioepoll *ep);
+extern int xioepoll(struct xioepoll *ep, struct pollfd fds[],
+		    unsigned long nfds, struct timeval *timeout);
+extern void xioepoll_close(struct xioepoll *ep);
+#endif /* WITH_EPOLL */
+
+#if WITH_IO_URING
+/* a minimal io_uring instance: the submission and completion rings mapped
+   into user space */
+struct xiouring {
+   int fd;		/* -1: not available */
+   unsigned int *sqhead, *sqtail, *sqmask, *sqarray;
+   struct io_uring_sqe *sqes;
+   unsigned int *cqhead, *cqtail, *cqmask;
+   struct io_uring_cqe *cqes;
+   void *sqring, *cqring;	/* cqring == sqring with single mmap */
+   size_t sqringsz, cqringsz, sqessz;
+   unsigned int entries;
+   unsigned int queued;		/* SQEs prepared but not yet submitted */
+   unsigned long enters;	/* io_uring_enter() calls, for statistics */
+   unsigned long submitted;	/* requests submitted, for statistics */
+} ;
+extern int xiouring_init(struct xiouring *ur, unsigned int entries,
+			 const int *ops, int nops);
+extern struct io_uring_sqe *xiouring_getsqe(struct xiouring *ur);
+extern int xiouring_enter(struct xiouring *ur, unsigned int waitnr);
+extern struct io_uring_cqe *xiouring_peekcqe(struct xiouring *ur);
+extern void xiouring_cqeseen(struct xiouring *ur);
+extern void xiouring_close(struct xiouring *ur);
+#endif /* WITH_IO_URING */
+
 extern int parseport(const char *portname, int proto);
 
 extern int ifindexbyname(const char *ifname, int anysock);
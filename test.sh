@@ -12296,6 +12296,1641 @@ esac
 N=$((N+1))
 
 
+# socat transfers data between two TCP sockets with splice() on Linux; check
+# that the data arrives unmodified and that splice() is actually used
+NAME=SPLICE_TCP
+case "$TESTS" in
+*%$N%*|*%functions%*|*%socket%*|*%tcp%*|*%tcp4%*|*%$NAME%*)
+TEST="$NAME: zero copy transfer between TCP sockets"
+if ! eval $NUMCOND; then :;
+elif [ "$UNAME" != Linux ]; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}only on Linux${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+elif echo " $opts " |grep -q -- "-P io_uring"; then
+    # the io_uring engine transfers the data itself
+    $PRINTF "test $F_n $TEST... ${YELLOW}not with -P io_uring${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tdiff="$td/test$N.diff"
+da="test$N $(date) $RANDOM"
+CMD0="$TRACE $SOCAT $opts -d -d -d TCP4-LISTEN:$PORT,reuseaddr PIPE"
+CMD1="$TRACE $SOCAT $opts - TCP4:$LOCALHOST:$PORT"
+printf "test $F_n $TEST... " $N
+$CMD0 >/dev/null 2>"${te}0" &
+pid0=$!
+waittcp4port $PORT 1
+echo "$da" |$CMD1 >"${tf}1" 2>"${te}1"
+rc1=$?
+kill $pid0 2>/dev/null; wait
+if [ $rc1 -ne 0 ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1"
+    cat "${te}0"
+    cat "${te}1"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+elif ! echo "$da" |diff - "${tf}1" >"$tdiff"; then
+    $PRINTF "$FAILED\n"
+    cat "$tdiff"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+elif ! grep -q "using splice()" "${te}0"; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "splice() was not used"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+
+# with nonblocking output socat must not busy loop or sleep when the peer does
+# not accept all data; it keeps the rest and writes it when poll() reports the
+# FD writeable. check that all data arrives unmodified
+NAME=NONBLOCK_SLOWREADER
+case "$TESTS" in
+*%$N%*|*%functions%*|*%socket%*|*%tcp%*|*%tcp4%*|*%$NAME%*)
+TEST="$NAME: nonblocking transfer to slow reader"
+if ! eval $NUMCOND; then :;
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tdiff="$td/test$N.diff"
+ti="$td/test$N.input"
+i=0; while [ $i -lt 4000 ]; do echo "test$N $i $(date) $RANDOM"; i=$((i+1)); done >"$ti"
+CMD0="$TRACE $SOCAT $opts -u TCP4-LISTEN:$PORT,reuseaddr,rcvbuf=4096 SYSTEM:\"sleep 1; cat\""
+CMD1="$TRACE $SOCAT $opts -d -d -d -b 65536 -u FILE:$ti TCP4:$LOCALHOST:$PORT,nonblock,sndbuf=4096"
+printf "test $F_n $TEST... " $N
+eval "$CMD0" >"$tf" 2>"${te}0" &
+pid0=$!
+waittcp4port $PORT 1
+$CMD1 2>"${te}1"
+rc1=$?
+wait $pid0
+if [ $rc1 -ne 0 ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1"
+    cat "${te}0"
+    cat "${te}1"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+elif ! diff "$ti" "$tf" >"$tdiff"; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1"
+    cat "$tdiff" |head -n 10
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+
+# the transfer loop with the epoll event method (-P epoll) must transfer data
+# like the default method
+NAME=EPOLL_TCP
+case "$TESTS" in
+*%$N%*|*%functions%*|*%socket%*|*%tcp%*|*%tcp4%*|*%$NAME%*)
+TEST="$NAME: transfer loop with epoll"
+if ! eval $NUMCOND; then :;
+elif ! $SOCAT -V |grep -q "#define WITH_EPOLL"; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}EPOLL not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tdiff="$td/test$N.diff"
+da="test$N $(date) $RANDOM"
+CMD0="$TRACE $SOCAT $opts -d -d -d -d -P epoll TCP4-LISTEN:$PORT,reuseaddr PIPE"
+CMD1="$TRACE $SOCAT $opts -P epoll - TCP4:$LOCALHOST:$PORT"
+printf "test $F_n $TEST... " $N
+$CMD0 >/dev/null 2>"${te}0" &
+pid0=$!
+waittcp4port $PORT 1
+echo "$da" |$CMD1 >"${tf}1" 2>"${te}1"
+rc1=$?
+kill $pid0 2>/dev/null; wait
+if [ $rc1 -ne 0 ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1"
+    cat "${te}0"
+    cat "${te}1"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+elif ! echo "$da" |diff - "${tf}1" >"$tdiff"; then
+    $PRINTF "$FAILED\n"
+    cat "$tdiff"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+elif ! grep -q "epoll_wait(" "${te}0"; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "epoll was not used"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+
+# the io_uring transfer engine (-P io_uring) must transfer data like the
+# default method
+NAME=IO_URING_TCP
+case "$TESTS" in
+*%$N%*|*%functions%*|*%socket%*|*%tcp%*|*%tcp4%*|*%$NAME%*)
+TEST="$NAME: transfer loop with io_uring"
+if ! eval $NUMCOND; then :;
+elif ! $SOCAT -V |grep -q "#define WITH_IO_URING"; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}IO_URING not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tdiff="$td/test$N.diff"
+da="test$N $(date) $RANDOM"
+CMD0="$TRACE $SOCAT $opts -d -d -P io_uring TCP4-LISTEN:$PORT,reuseaddr PIPE"
+CMD1="$TRACE $SOCAT $opts -P io_uring - TCP4:$LOCALHOST:$PORT"
+printf "test $F_n $TEST... " $N
+$CMD0 >/dev/null 2>"${te}0" &
+pid0=$!
+waittcp4port $PORT 1
+echo "$da" |$CMD1 >"${tf}1" 2>"${te}1"
+rc1=$?
+kill $pid0 2>/dev/null; wait
+if grep -q "io_uring not available" "${te}0"; then
+    $PRINTF "${YELLOW}io_uring refused by kernel${NORMAL}\n"
+    numCANT=$((numCANT+1))
+elif [ $rc1 -ne 0 ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1"
+    cat "${te}0"
+    cat "${te}1"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+elif ! echo "$da" |diff - "${tf}1" >"$tdiff"; then
+    $PRINTF "$FAILED\n"
+    cat "$tdiff"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+elif ! grep -q "starting io_uring transfer loop" "${te}0"; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "io_uring was not used"
+    cat "${te}0"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+
+# with -b auto socat increases the read size while reads fill the buffer, up
+# to the given maximum, and reports the sizes; the data must arrive unmodified.
+# option escape keeps the data in user space (no splice())
+NAME=BUFSIZE_AUTO
+case "$TESTS" in
+*%$N%*|*%functions%*|*%file%*|*%$NAME%*)
+TEST="$NAME: adaptive buffer size"
+if ! eval $NUMCOND; then :;
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tdiff="$td/test$N.diff"
+ti="$td/test$N.input"
+i=0; while [ $i -lt 4000 ]; do echo "test$N $i $(date) $RANDOM"; i=$((i+1)); done >"$ti"
+CMD="$TRACE $SOCAT $opts -d -d -d -b auto:512:8192 -u FILE:$ti,escape=0x1d -"
+printf "test $F_n $TEST... " $N
+$CMD >"$tf" 2>"$te"
+rc=$?
+if [ $rc -ne 0 ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD"
+    cat "$te"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+elif ! diff "$ti" "$tf" >"$tdiff"; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD"
+    cat "$tdiff" |head -n 10
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+elif ! grep -q "read buffer size increased to 8192 bytes" "$te"; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD"
+    grep "buffer size" "$te"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+N=$((N+1))
+
+
+# the line termination conversions of options cr and crnl must convert each
+# line end, also across block boundaries (-b 3)
+NAME=NEWLINE_CONVERSION
+case "$TESTS" in
+*%$N%*|*%functions%*|*%stdio%*|*%$NAME%*)
+TEST="$NAME: line termination conversions"
+if ! eval $NUMCOND; then :;
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+printf "test $F_n $TEST... " $N
+ok=1
+for conv in "raw crnl" "crnl raw" "raw cr" "cr raw" "crnl cr"; do
+    set -- $conv
+    case "$conv" in
+	"raw crnl") in="a\nbc\n\nd";       exp="a\r\nbc\r\n\r\nd" ;;
+	"crnl raw") in="a\r\nbc\r\n\r\nd"; exp="a\nbc\n\nd" ;;
+	"raw cr")   in="a\nbc\n\nd";       exp="a\rbc\r\rd" ;;
+	"cr raw")   in="a\rbc\r\rd";       exp="a\nbc\n\nd" ;;
+	"crnl cr")  in="a\r\nbc\r\n\r\nd"; exp="a\rbc\r\rd" ;;
+    esac
+    o1=; o2=
+    [ "$1" != raw ] && o1=",$1"
+    [ "$2" != raw ] && o2=",$2"
+    CMD="$TRACE $SOCAT $opts -b 3 -u -$o1 -$o2"
+    printf "$in" |$CMD >"$tf" 2>"$te"
+    if [ $? -ne 0 ] || [ "$(od -c <"$tf")" != "$(printf "$exp" |od -c)" ]; then
+	$PRINTF "$FAILED\n"
+	echo "$CMD: $conv"
+	od -c "$tf"
+	cat "$te"
+	ok=
+	break
+    fi
+done
+if [ "$ok" ]; then
+    $PRINTF "$OK\n"
+    numOK=$((numOK+1))
+else
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+fi
+fi # NUMCOND
+ ;;
+esac
+N=$((N+1))
+
+
+# the data dumps of options -x and -v -x must keep their format
+NAME=DUMP_FORMAT
+case "$TESTS" in
+*%$N%*|*%functions%*|*%stdio%*|*%$NAME%*)
+TEST="$NAME: format of -x and -v -x data dumps"
+if ! eval $NUMCOND; then :;
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tdiff="$td/test$N.diff"
+printf "test $F_n $TEST... " $N
+fill="                                         "
+ok=1
+for o in "-x" "-v -x"; do
+    CMD="$TRACE $SOCAT $opts $o -u - -"
+    printf "ab\ncd\001" |$CMD >"$tf" 2>"$te"
+    case "$o" in
+	"-x") exp=" 61 62 0a 63 64 01" ;;
+	*) exp=" 61 62 0a$fill""ab.
+ 63 64 01$fill""cd.
+--" ;;
+    esac
+    echo "$exp" >"$td/test$N.expected"
+    if ! grep -q "^> .* length=6 from=0 to=5\$" "$te" ||
+	! grep -v "length=" "$te" |diff - "$td/test$N.expected" >"$tdiff"; then
+	$PRINTF "$FAILED\n"
+	echo "$CMD"
+	cat "$te"
+	cat "$tdiff"
+	ok=
+	break
+    fi
+done
+if [ "$ok" ]; then
+    $PRINTF "$OK\n"
+    numOK=$((numOK+1))
+else
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+fi
+fi # NUMCOND
+ ;;
+esac
+N=$((N+1))
+
+
+NAME=PCAPNG_CAPTURE
+case "$TESTS" in
+*%$N%*|*%functions%*|*%stdio%*|*%$NAME%*)
+TEST="$NAME: capture of data to pcapng file, with rotation"
+# capture a line twice to the same file with option -cs; the second run must
+# rename the first capture to <file>.1. Both files must start with a pcapng
+# section header block and contain the data
+if ! eval $NUMCOND; then :;
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tc="$td/test$N.pcapng"
+da="test$N $(date) $RANDOM"
+CMD="$TRACE $SOCAT $opts -cf $tc -cs 1 -u - -"
+printf "test $F_n $TEST... " $N
+echo "$da" |$CMD >"$tf" 2>"$te" &&
+echo "$da" |$CMD >>"$tf" 2>>"$te"
+rc=$?
+if [ $rc -ne 0 ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD"
+    cat "$te"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+elif [ "$(od -A n -t x1 -N 4 "$tc" 2>/dev/null)" != " 0a 0d 0d 0a" ] ||
+    [ "$(od -A n -t x1 -N 4 "$tc.1" 2>/dev/null)" != " 0a 0d 0d 0a" ] ||
+    ! grep -q "$da" "$tc" || ! grep -q "$da" "$tc.1" ||
+    ! grep -q "socket 1" "$tc"; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD"
+    cat "$te"
+    ls -l "$tc"*
+    od -c "$tc" |head -n 8
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ -n "$debug" ]; then cat "$te"; fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+N=$((N+1))
+
+
+NAME=PREFORK_TCP
+case "$TESTS" in
+*%$N%*|*%functions%*|*%tcp%*|*%tcp4%*|*%listen%*|*%fork%*|*%$NAME%*)
+TEST="$NAME: TCP-LISTEN with pre-forked worker processes"
+# start a listener with fork,prefork=2 that echoes the data; three clients in
+# sequence must get their data back, and the parent must have forked the
+# workers and a replacement for each accepted connection
+if ! eval $NUMCOND; then :; else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tdiff="$td/test$N.diff"
+da="test$N $(date) $RANDOM"
+CMD0="$TRACE $SOCAT $opts -d -d -d TCP4-L:$PORT,reuseaddr,fork,prefork=2 PIPE"
+CMD1="$TRACE $SOCAT $opts - TCP4:$LOCALHOST:$PORT"
+printf "test $F_n $TEST... " $N
+$CMD0 >/dev/null 2>"${te}0" &
+pid0=$!
+waittcp4port $PORT 1
+ok=1
+for i in 1 2 3; do
+    echo "$da $i" |$CMD1 >"$tf" 2>"${te}1"
+    if ! echo "$da $i" |diff - "$tf" >"$tdiff"; then ok=; break; fi
+done
+sleep 1
+kill $pid0 2>/dev/null; wait
+if [ -z "$ok" ] ||
+    ! grep -q "pre-forking 2 worker processes" "${te}0" ||
+    [ "$(grep -c "accepted a connection" "${te}0")" -ne 3 ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "echo \"$da\" |$CMD1"
+    cat "${te}0"
+    cat "${te}1"
+    cat "$tdiff"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ -n "$debug" ]; then cat "${te}0"; fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+
+NAME=MULTI_TCP
+case "$TESTS" in
+*%$N%*|*%functions%*|*%tcp%*|*%tcp4%*|*%listen%*|*%$NAME%*)
+TEST="$NAME: TCP-LISTEN serving concurrent connections in one process"
+# start a listener with option multi that echoes the data; three concurrent
+# clients and one more after them must get their data back, and all
+# connections must be accepted by the socat process itself
+if ! eval $NUMCOND; then :;
+elif ! $SOCAT -V |grep -q "#define WITH_EPOLL"; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}EPOLL not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tdiff="$td/test$N.diff"
+da="test$N $(date) $RANDOM"
+CMD0="$TRACE $SOCAT $opts -d -d TCP4-L:$PORT,reuseaddr,multi PIPE"
+CMD1="$TRACE $SOCAT $opts -t 2 - TCP4:$LOCALHOST:$PORT"
+printf "test $F_n $TEST... " $N
+$CMD0 >/dev/null 2>"${te}0" &
+pid0=$!
+waittcp4port $PORT 1
+pids=
+for i in 1 2 3; do
+    (echo "$da $i"; sleep 1) |$CMD1 >"$tf$i" 2>"${te}$i" &
+    pids="$pids $!"
+done
+wait $pids
+echo "$da 4" |$CMD1 >"${tf}4" 2>"${te}4"
+sleep 0.5
+ok=1
+for i in 1 2 3 4; do
+    if ! echo "$da $i" |diff - "$tf$i" >>"$tdiff"; then ok=; fi
+done
+kill $pid0 2>/dev/null; wait
+if [ -z "$ok" ] ||
+    [ "$(grep -c "socat\[$pid0\] N accepting connection" "${te}0")" -ne 4 ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "echo \"$da\" |$CMD1"
+    cat "${te}0"
+    cat "${te}1"
+    cat "$tdiff"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ -n "$debug" ]; then cat "${te}0"; fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+
+NAME=MULTI_THREADS
+case "$TESTS" in
+*%$N%*|*%functions%*|*%tcp%*|*%tcp4%*|*%listen%*|*%$NAME%*)
+TEST="$NAME: option multi with transfer threads"
+# start a listener with multi,threads=3 that echoes the data; four concurrent
+# clients must get their data back
+if ! eval $NUMCOND; then :;
+elif ! $SOCAT -V |grep -q "#define WITH_THREADS"; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}THREADS not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tdiff="$td/test$N.diff"
+da="test$N $(date) $RANDOM"
+CMD0="$TRACE $SOCAT $opts -d -d -d TCP4-L:$PORT,reuseaddr,multi,threads=3 PIPE"
+CMD1="$TRACE $SOCAT $opts -t 2 - TCP4:$LOCALHOST:$PORT"
+printf "test $F_n $TEST... " $N
+$CMD0 >/dev/null 2>"${te}0" &
+pid0=$!
+waittcp4port $PORT 1
+pids=
+for i in 1 2 3 4; do
+    (echo "$da $i"; sleep 1) |$CMD1 >"$tf$i" 2>"${te}$i" &
+    pids="$pids $!"
+done
+wait $pids
+ok=1
+for i in 1 2 3 4; do
+    if ! echo "$da $i" |diff - "$tf$i" >>"$tdiff"; then ok=; fi
+done
+kill $pid0 2>/dev/null; wait
+if [ -z "$ok" ] ||
+    ! grep -q "serving connections with 3 threads" "${te}0"; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "echo \"$da\" |$CMD1"
+    cat "${te}0"
+    cat "${te}1"
+    cat "$tdiff"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ -n "$debug" ]; then cat "${te}0"; fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+
+NAME=MULTI_HALFCLOSE
+case "$TESTS" in
+*%$N%*|*%functions%*|*%tcp%*|*%tcp4%*|*%listen%*|*%$NAME%*)
+TEST="$NAME: option multi keeps a half closed connection while data flows"
+# the client closes its direction at once; the second address prints five
+# lines in one second, longer than the close wait of 0.5s, and all of them
+# must arrive because each one restarts the close wait
+if ! eval $NUMCOND; then :;
+elif ! $SOCAT -V |grep -q "#define WITH_EPOLL"; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}EPOLL not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tdiff="$td/test$N.diff"
+CMD0="$TRACE $SOCAT $opts -d -d -t 0.5 TCP4-L:$PORT,reuseaddr,multi SYSTEM:'for i in 1 2 3 4 5; do echo \$i; sleep 0.2; done'"
+CMD1="$TRACE $SOCAT $opts -t 2 - TCP4:$LOCALHOST:$PORT"
+printf "test $F_n $TEST... " $N
+eval "$CMD0 >/dev/null 2>\"${te}0\" &"
+pid0=$!
+waittcp4port $PORT 1
+echo x |$CMD1 >"$tf" 2>"${te}1"
+kill $pid0 2>/dev/null; wait
+if ! printf "1\n2\n3\n4\n5\n" |diff - "$tf" >"$tdiff"; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "echo x |$CMD1"
+    cat "${te}0"
+    cat "${te}1"
+    cat "$tdiff"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ -n "$debug" ]; then cat "${te}0"; fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+
+NAME=MULTI_SLOWOPEN
+case "$TESTS" in
+*%$N%*|*%functions%*|*%tcp%*|*%tcp4%*|*%listen%*|*%$NAME%*)
+TEST="$NAME: option multi serves connections while a connect hangs"
+# a listener with option multi connects each client to an echo server. The
+# first client gets its first line back; then the echo server is stopped with
+# a full backlog, so the connect for a second client hangs. The first client
+# must still get its second line back, with its data logged by -v
+if ! eval $NUMCOND; then :;
+elif ! $SOCAT -V |grep -q "#define WITH_EPOLL"; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}EPOLL not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+elif ! $SOCAT -V |grep -q "#define WITH_THREADS"; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}THREADS not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tdiff="$td/test$N.diff"
+da="test$N $(date) $RANDOM"
+PORT2=$((PORT+1))
+CMD0="$TRACE $SOCAT $opts TCP4-L:$PORT2,reuseaddr,fork,backlog=1 PIPE"
+CMD1="$TRACE $SOCAT $opts -d -d -v TCP4-L:$PORT,reuseaddr,multi,threads=2 TCP4:$LOCALHOST:$PORT2"
+CMD2="$TRACE $SOCAT $opts -t 2 - TCP4:$LOCALHOST:$PORT"
+CMD3="$TRACE $SOCAT $opts /dev/null TCP4:$LOCALHOST:$PORT2,connect-timeout=4"
+CMD4="$TRACE $SOCAT $opts -T 3 - TCP4:$LOCALHOST:$PORT"
+printf "test $F_n $TEST... " $N
+$CMD0 >/dev/null 2>"${te}0" &
+pid0=$!
+waittcp4port $PORT2 1
+$CMD1 >/dev/null 2>"${te}1" &
+pid1=$!
+waittcp4port $PORT 1
+(echo "$da 1"; sleep 2; echo "$da 2"; sleep 1) |$CMD2 >"$tf" 2>"${te}2" &
+pid2=$!
+sleep 0.5
+kill -STOP $pid0
+for i in 1 2 3 4; do $CMD3 2>/dev/null & done
+sleep 0.3
+$CMD4 </dev/null >/dev/null 2>"${te}4" &
+wait $pid2
+kill -CONT $pid0
+kill $pid0 $pid1 2>/dev/null; wait
+if ! printf "$da 1\n$da 2\n" |diff - "$tf" >"$tdiff"; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1 &"
+    echo "(echo \"$da 1\"; sleep 2; echo \"$da 2\") |$CMD2"
+    echo "kill -STOP $pid0; $CMD3 (4 times)"
+    echo "$CMD4"
+    cat "${te}1"
+    cat "${te}2"
+    cat "$tdiff"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ -n "$debug" ]; then cat "${te}1"; fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+PORT=$((PORT+2))
+N=$((N+1))
+
+
+NAME=MULTI_NOLEAK
+case "$TESTS" in
+*%$N%*|*%functions%*|*%unix%*|*%listen%*|*%$NAME%*)
+TEST="$NAME: option multi does not grow with the number of connections"
+# a listener with option multi connects each client to an echo server. After
+# 500 connections that settle the heap, 3000 more must not let the resident
+# memory of the listener grow by 256kB. UNIX sockets keep the connections
+# from using up TCP ports, and the long name of the echo server makes the
+# parameters that xioopen() copies large; one malloc arena keeps the memory
+# from depending on the opener threads
+if ! eval $NUMCOND; then :;
+elif [ "$UNAME" != Linux ]; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}only on Linux$NORMAL\n" $N
+    numCANT=$((numCANT+1))
+elif ! $SOCAT -V |grep -q "#define WITH_EPOLL"; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}EPOLL not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+else
+te="$td/test$N.stderr"
+ts="$td/test$N.sock"
+pad=; while [ $((${#td}+${#pad}+16)) -lt 100 ]; do pad="$pad./"; done
+ts2="$td/${pad}test$N.echo"
+CMD0="$TRACE $SOCAT $opts UNIX-LISTEN:$ts2,multi PIPE"
+CMD1="$TRACE $SOCAT $opts UNIX-LISTEN:$ts,multi UNIX-CONNECT:$ts2"
+CMD2="$TRACE $SOCAT $opts -u /dev/null UNIX-CONNECT:$ts"
+printf "test $F_n $TEST... " $N
+$CMD0 >/dev/null 2>"${te}0" &
+pid0=$!
+waitunixport $ts2 1
+MALLOC_ARENA_MAX=1 $CMD1 >/dev/null 2>"${te}1" &
+pid1=$!
+waitunixport $ts 1
+connect () {
+    local i
+    for ((i=0; i<$1; ++i)); do
+	$CMD2 2>>"${te}2"
+    done
+}
+connect 500; sleep 0.5
+rss0=$(awk '/^VmRSS:/ { print $2; }' /proc/$pid1/status)
+connect 3000; sleep 0.5
+rss1=$(awk '/^VmRSS:/ { print $2; }' /proc/$pid1/status)
+kill $pid0 $pid1 2>/dev/null; wait
+if [ -z "$rss0" ] || [ -z "$rss1" ] || [ $((rss1-rss0)) -ge 256 ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "MALLOC_ARENA_MAX=1 $CMD1 &"
+    echo "$CMD2 (3500 times)"
+    echo "VmRSS after 500 connections: ${rss0}kB, after 3500: ${rss1}kB"
+    cat "${te}0"
+    cat "${te}1"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ -n "$debug" ]; then
+	echo "VmRSS after 500 connections: ${rss0}kB, after 3500: ${rss1}kB"
+    fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+N=$((N+1))
+
+
+NAME=FORK_ACCEPTDRAIN
+case "$TESTS" in
+*%$N%*|*%functions%*|*%tcp%*|*%tcp4%*|*%listen%*|*%fork%*|*%$NAME%*)
+TEST="$NAME: TCP-LISTEN with fork accepts all pending connections"
+# stop a listener with fork that echoes the data, let five clients connect to
+# the backlog, and continue it; all clients must get their data back. When
+# socat uses accept4(), it must accept the pending connections without
+# listening again in between
+if ! eval $NUMCOND; then :; else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tdiff="$td/test$N.diff"
+da="test$N $(date) $RANDOM"
+CMD0="$TRACE $SOCAT $opts -d -d -d -d TCP4-L:$PORT,reuseaddr,fork PIPE"
+CMD1="$TRACE $SOCAT $opts -t 5 - TCP4:$LOCALHOST:$PORT"
+printf "test $F_n $TEST... " $N
+$CMD0 >/dev/null 2>"${te}0" &
+pid0=$!
+waittcp4port $PORT 1
+kill -STOP $pid0
+pids=
+for i in 1 2 3 4 5; do
+    echo "$da $i" |$CMD1 >"$tf$i" 2>"${te}$i" &
+    pids="$pids $!"
+done
+sleep 1
+kill -CONT $pid0
+wait $pids
+kill $pid0 2>/dev/null; wait
+ok=1
+for i in 1 2 3 4 5; do
+    if ! echo "$da $i" |diff - "$tf$i" >>"$tdiff"; then ok=; fi
+done
+if [ -z "$ok" ] ||
+    { grep -q " accept4(" "${te}0" &&
+      [ "$(awk '/accepting connection/ { if (++a == 5) exit }
+		/listening on/ { if (a) ++l }
+		END { print l+0 }' "${te}0")" -ne 0 ]; }; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "echo \"$da\" |$CMD1"
+    cat "${te}0"
+    cat "$tdiff"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ -n "$debug" ]; then cat "${te}0"; fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+
+NAME=FORK_REAPCHILDREN
+case "$TESTS" in
+*%$N%*|*%functions%*|*%tcp%*|*%tcp4%*|*%listen%*|*%fork%*|*%$NAME%*)
+TEST="$NAME: TCP-LISTEN with fork reaps its children through signalfd"
+# start a listener with fork and max-children=1 that echoes the data; three
+# clients in sequence must get their data back, and the parent must have
+# reaped all children synchronously and left no zombie
+if ! eval $NUMCOND; then :; else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tdiff="$td/test$N.diff"
+da="test$N $(date) $RANDOM"
+CMD0="$TRACE $SOCAT $opts -d -d -d TCP4-L:$PORT,reuseaddr,fork,max-children=1 PIPE"
+CMD1="$TRACE $SOCAT $opts - TCP4:$LOCALHOST:$PORT"
+printf "test $F_n $TEST... " $N
+$CMD0 >/dev/null 2>"${te}0" &
+pid0=$!
+waittcp4port $PORT 1
+ok=1
+for i in 1 2 3; do
+    echo "$da $i" |$CMD1 >"$tf" 2>"${te}1"
+    if ! echo "$da $i" |diff - "$tf" >"$tdiff"; then ok=; break; fi
+done
+sleep 1
+zombies=$(ps -o stat= --ppid $pid0 2>/dev/null |grep -c Z)
+kill $pid0 2>/dev/null; wait
+if ! grep -q "reaping child processes through signalfd" "${te}0"; then
+    $PRINTF "${YELLOW}signalfd not available${NORMAL}\n"
+    numCANT=$((numCANT+1))
+elif [ -z "$ok" ] || [ "$zombies" != 0 ] ||
+    [ "$(grep "socat\[$pid0\]" "${te}0" |grep -c "exited with status 0")" -ne 3 ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "echo \"$da\" |$CMD1"
+    cat "${te}0"
+    cat "${te}1"
+    cat "$tdiff"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ -n "$debug" ]; then cat "${te}0"; fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+
+NAME=SHARDS_TCP
+case "$TESTS" in
+*%$N%*|*%functions%*|*%tcp%*|*%tcp4%*|*%listen%*|*%fork%*|*%$NAME%*)
+TEST="$NAME: TCP-LISTEN with two SO_REUSEPORT shards"
+# start a listener with fork,shards=2 whose children print the number of
+# their shard; of 16 clients in sequence (connecting from different ports)
+# both shards must have served some
+if ! eval $NUMCOND; then :;
+elif ! $SOCAT -hh |grep -q "[[:space:]]shards[[:space:]]"; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}option shards not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+CMD0="$TRACE $SOCAT $opts -d -d TCP4-L:$PORT,reuseaddr,fork,shards=2 SYSTEM:'echo shard \$SOCAT_SHARD'"
+CMD1="$TRACE $SOCAT $opts -u TCP4:$LOCALHOST:$PORT -"
+printf "test $F_n $TEST... " $N
+eval "$CMD0 >/dev/null 2>\"${te}0\" &"
+pid0=$!
+waittcp4port $PORT 1
+for i in $(seq 16); do
+    $CMD1 >>"$tf" 2>"${te}1"
+done
+kill $pid0 2>/dev/null; wait
+if ! grep -q "shard 0" "$tf" || ! grep -q "shard 1" "$tf" ||
+    [ "$(wc -l <"$tf")" -ne 16 ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1"
+    cat "${te}0"
+    cat "${te}1"
+    cat "$tf"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ -n "$debug" ]; then cat "${te}0"; fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+
+NAME=TCP_FASTOPEN
+case "$TESTS" in
+*%$N%*|*%functions%*|*%tcp%*|*%tcp4%*|*%listen%*|*%$NAME%*)
+TEST="$NAME: TCP Fast Open and defer-accept"
+# start a listener with fastopen and defer-accept, and a client with
+# fastopen-connect and notsent-lowat; the data must be echoed, and the
+# options must have been set on the listening socket
+if ! eval $NUMCOND; then :;
+elif ! $SOCAT -hh |grep -q "[[:space:]]fastopen-connect[[:space:]]"; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}option fastopen-connect not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tdiff="$td/test$N.diff"
+da="test$N $(date) $RANDOM"
+CMD0="$TRACE $SOCAT $opts -d -d -d -d TCP4-L:$PORT,reuseaddr,fastopen=16,defer-accept=2 PIPE"
+CMD1="$TRACE $SOCAT $opts - TCP4:$LOCALHOST:$PORT,fastopen-connect,notsent-lowat=16384"
+printf "test $F_n $TEST... " $N
+$CMD0 >/dev/null 2>"${te}0" &
+pid0=$!
+waittcp4port $PORT 1
+echo "$da" |$CMD1 >"$tf" 2>"${te}1"
+rc1=$?
+kill $pid0 2>/dev/null; wait
+# the listen() call must follow both setsockopt() calls
+if [ "$rc1" -ne 0 ] || ! echo "$da" |diff - "$tf" >"$tdiff" ||
+    [ "$(sed -n '/setsockopt(.*, 6, \(9\|23\), /p; / listen(/q' "${te}0" |wc -l)" -ne 2 ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1"
+    cat "${te}0"
+    cat "${te}1"
+    cat "$tdiff"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ -n "$debug" ]; then cat "${te}0"; fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+
+NAME=POOL_TCP
+case "$TESTS" in
+*%$N%*|*%functions%*|*%tcp%*|*%tcp4%*|*%listen%*|*%fork%*|*%$NAME%*)
+TEST="$NAME: TCP-LISTEN fork with pool of backend connections"
+# start an echo backend, and a forking proxy with pool=2 in front of it; three
+# clients in sequence must get their data echoed, and the proxy must have
+# handed pooled connections to its children
+if ! eval $NUMCOND; then :;
+elif ! $SOCAT -hh |grep -q "[[:space:]]pool[[:space:]]"; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}option pool not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tdiff="$td/test$N.diff"
+da="test$N $(date) $RANDOM"
+tsb=$PORT
+PORT=$((PORT+1))
+CMD0="$TRACE $SOCAT $opts TCP4-L:$tsb,reuseaddr,fork PIPE"
+CMD1="$TRACE $SOCAT $opts -d -d -d TCP4-L:$PORT,reuseaddr,fork,pool=2 TCP4:$LOCALHOST:$tsb"
+CMD2="$TRACE $SOCAT $opts - TCP4:$LOCALHOST:$PORT"
+printf "test $F_n $TEST... " $N
+$CMD0 >/dev/null 2>"${te}0" &
+pid0=$!
+waittcp4port $tsb 1
+$CMD1 >/dev/null 2>"${te}1" &
+pid1=$!
+waittcp4port $PORT 1
+for i in 1 2 3; do
+    echo "$da $i" |$CMD2 >>"$tf" 2>>"${te}2"
+done
+kill $pid1 $pid0 2>/dev/null; wait
+if ! printf "$da 1\n$da 2\n$da 3\n" |diff - "$tf" >"$tdiff" ||
+    [ "$(grep -c "pool: handing connection" "${te}1")" -lt 2 ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1 &"
+    echo "$CMD2"
+    cat "${te}0"
+    cat "${te}1"
+    cat "${te}2"
+    cat "$tdiff"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ -n "$debug" ]; then cat "${te}1"; fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+
+NAME=POOL_SLOWBACKEND
+case "$TESTS" in
+*%$N%*|*%functions%*|*%tcp%*|*%tcp4%*|*%listen%*|*%fork%*|*%$NAME%*)
+TEST="$NAME: option pool accepts while its connects hang"
+# stop an echo backend with a full backlog, so connects to it hang, and start
+# a forking proxy with pool=2 in front of it. The proxy must still accept a
+# client
+if ! eval $NUMCOND; then :;
+elif ! $SOCAT -hh |grep -q "[[:space:]]pool[[:space:]]"; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}option pool not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tdiff="$td/test$N.diff"
+tsb=$PORT
+PORT=$((PORT+1))
+CMD0="$TRACE $SOCAT $opts TCP4-L:$tsb,reuseaddr,fork,backlog=1 PIPE"
+CMD1="$TRACE $SOCAT $opts -d -d -d TCP4-L:$PORT,reuseaddr,fork,pool=2 TCP4:$LOCALHOST:$tsb"
+CMD2="$TRACE $SOCAT $opts -T 1 - TCP4:$LOCALHOST:$PORT"
+CMD3="$TRACE $SOCAT $opts /dev/null TCP4:$LOCALHOST:$tsb,connect-timeout=3"
+printf "test $F_n $TEST... " $N
+$CMD0 >/dev/null 2>"${te}0" &
+pid0=$!
+waittcp4port $tsb 1
+kill -STOP $pid0
+for i in 1 2 3 4; do $CMD3 2>/dev/null & done
+sleep 0.3
+$CMD1 >/dev/null 2>"${te}1" &
+pid1=$!
+waittcp4port $PORT 1
+echo x |$CMD2 >"$tf" 2>"${te}2"
+kill $pid1 2>/dev/null
+kill -CONT $pid0
+kill $pid0 2>/dev/null; wait
+if ! grep -q "pool: connecting on fd" "${te}1" ||
+    ! grep -q "accepting connection" "${te}1"; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "kill -STOP $pid0; $CMD3 (4 times)"
+    echo "$CMD1 &"
+    echo "echo x |$CMD2"
+    cat "${te}1"
+    cat "${te}2"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ -n "$debug" ]; then cat "${te}1"; fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+
+NAME=LB_TCP
+case "$TESTS" in
+*%$N%*|*%functions%*|*%tcp%*|*%tcp4%*|*%listen%*|*%fork%*|*%$NAME%*)
+TEST="$NAME: TCP connect with option target, failing over a dead target"
+# start two backends that identify themselves, and a forking proxy that
+# balances over them and a third target where nothing listens; all four
+# clients must get an answer, from both backends
+if ! eval $NUMCOND; then :;
+elif ! $SOCAT -hh |grep -q "[[:space:]]target[[:space:]]"; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}option target not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+echo A >"$td/test$N.a"
+echo B >"$td/test$N.b"
+tsa=$PORT; PORT=$((PORT+1))
+tsb=$PORT; PORT=$((PORT+1))
+tsdead=$PORT; PORT=$((PORT+1))
+CMD0="$TRACE $SOCAT $opts -U TCP4-L:$tsa,reuseaddr,fork OPEN:$td/test$N.a"
+CMD1="$TRACE $SOCAT $opts -U TCP4-L:$tsb,reuseaddr,fork OPEN:$td/test$N.b"
+CMD2="$TRACE $SOCAT $opts TCP4-L:$PORT,reuseaddr,fork TCP4:$LOCALHOST:$tsa,target=$LOCALHOST:$tsdead,target=$LOCALHOST:$tsb,lb=roundrobin"
+CMD3="$TRACE $SOCAT $opts -u TCP4:$LOCALHOST:$PORT -"
+printf "test $F_n $TEST... " $N
+$CMD0 >/dev/null 2>"${te}0" &
+pid0=$!
+$CMD1 >/dev/null 2>"${te}1" &
+pid1=$!
+waittcp4port $tsa 1
+waittcp4port $tsb 1
+$CMD2 >/dev/null 2>"${te}2" &
+pid2=$!
+waittcp4port $PORT 1
+for i in 1 2 3 4; do
+    $CMD3 >>"$tf" 2>>"${te}3"
+done
+kill $pid2 $pid1 $pid0 2>/dev/null; wait
+if [ "$(wc -l <"$tf")" -ne 4 ] ||
+    [ "$(sort -u "$tf" |tr -d '\n')" != "AB" ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1 &"
+    echo "$CMD2 &"
+    echo "$CMD3"
+    cat "${te}0"
+    cat "${te}1"
+    cat "${te}2"
+    cat "${te}3"
+    cat "$tf"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ -n "$debug" ]; then cat "${te}2"; fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+
+NAME=LB_LEASTCONN_MULTI
+case "$TESTS" in
+*%$N%*|*%functions%*|*%tcp%*|*%tcp4%*|*%listen%*|*%$NAME%*)
+TEST="$NAME: option lb=leastconn counts the connections of option multi"
+# a listener with option multi balances over two backends; a first client
+# keeps its connection to backend A open, so the following clients, one
+# after the other, must all go to backend B
+if ! eval $NUMCOND; then :;
+elif ! $SOCAT -hh |grep -q "[[:space:]]target[[:space:]]"; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}option target not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+elif ! $SOCAT -V |grep -q "#define WITH_EPOLL"; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}EPOLL not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+echo B >"$td/test$N.b"
+tsa=$PORT; PORT=$((PORT+1))
+tsb=$PORT; PORT=$((PORT+1))
+CMD0="$TRACE $SOCAT $opts -U TCP4-L:$tsa,reuseaddr,fork SYSTEM:'echo A; sleep 10'"
+CMD1="$TRACE $SOCAT $opts -U TCP4-L:$tsb,reuseaddr,fork OPEN:$td/test$N.b"
+CMD2="$TRACE $SOCAT $opts TCP4-L:$PORT,reuseaddr,multi TCP4:$LOCALHOST:$tsa,target=$LOCALHOST:$tsb,lb=leastconn"
+CMD3="$TRACE $SOCAT $opts -u TCP4:$LOCALHOST:$PORT -"
+CMD4="$TRACE $SOCAT $opts -T 1 -u TCP4:$LOCALHOST:$PORT -"
+printf "test $F_n $TEST... " $N
+eval "$CMD0 >/dev/null 2>\"${te}0\" &"
+pid0=$!
+$CMD1 >/dev/null 2>"${te}1" &
+pid1=$!
+waittcp4port $tsa 1
+waittcp4port $tsb 1
+$CMD2 >/dev/null 2>"${te}2" &
+pid2=$!
+waittcp4port $PORT 1
+$CMD3 >"${tf}3" 2>"${te}3" &
+pid3=$!
+sleep 0.5
+for i in 1 2 3; do
+    $CMD4 >>"$tf" 2>>"${te}4"
+    sleep 0.5
+done
+kill $pid3 $pid2 $pid1 $pid0 2>/dev/null; wait
+if [ "$(cat "${tf}3")" != "A" ] ||
+    [ "$(tr -d '\n' <"$tf")" != "BBB" ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1 &"
+    echo "$CMD2 &"
+    echo "$CMD3 &"
+    echo "$CMD4"
+    cat "${te}0"
+    cat "${te}1"
+    cat "${te}2"
+    cat "${te}3"
+    cat "${te}4"
+    cat "${tf}3" "$tf"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ -n "$debug" ]; then cat "${te}2"; fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+
+NAME=HAPPY_EYEBALLS
+case "$TESTS" in
+*%$N%*|*%functions%*|*%tcp%*|*%tcp4%*|*%tcp6%*|*%ip4%*|*%ip6%*|*%$NAME%*)
+TEST="$NAME: TCP connect falls back from IPv6 to IPv4 address of a name"
+# listen on IPv4 only and connect to localhost preferring IPv6; the attempt
+# to ::1 fails, the attempt to 127.0.0.1 must carry the data
+if ! eval $NUMCOND; then :;
+elif ! runsip6 >/dev/null 2>&1; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}IP6 not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+elif ! getent ahosts localhost 2>/dev/null |grep -q "^::1 " ||
+     ! getent ahosts localhost 2>/dev/null |grep -q "^127\.0\.0\.1 "; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}localhost does not resolve to ::1 and 127.0.0.1${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tdiff="$td/test$N.diff"
+da="test$N $(date) $RANDOM"
+CMD0="$TRACE $SOCAT $opts TCP4-L:$PORT,reuseaddr PIPE"
+CMD1="$TRACE $SOCAT $opts -6 -d -d -d -d - TCP:localhost:$PORT"
+printf "test $F_n $TEST... " $N
+$CMD0 >/dev/null 2>"${te}0" &
+pid0=$!
+waittcp4port $PORT 1
+echo "$da" |$CMD1 >"$tf" 2>"${te}1"
+kill $pid0 2>/dev/null; wait
+if ! echo "$da" |diff - "$tf" >"$tdiff" ||
+    ! grep -q "connect attempt to AF=2 127.0.0.1:$PORT succeeded" "${te}1"; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1"
+    cat "${te}0"
+    cat "${te}1"
+    cat "$tdiff"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ -n "$debug" ]; then cat "${te}1"; fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+NAME=UDP_BATCH
+case "$TESTS" in
+*%$N%*|*%functions%*|*%engine%*|*%ip4%*|*%dgram%*|*%udp%*|*%udp4%*|*%recv%*|*%$NAME%*)
+TEST="$NAME: UDP relay with recvmmsg()/sendmmsg() keeps packet boundaries"
+# ten packets of ten bytes each pass a relay with -B; the receiver behind it
+# must see ten packets of ten bytes
+if ! eval $NUMCOND; then :;
+elif ! $SOCAT -h |grep -q -- " -B<count> "; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}recvmmsg() not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+elif echo " $opts " |grep -q -- "-P io_uring"; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}not with -P io_uring${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tdiff="$td/test$N.diff"
+tin="$td/test$N.in"
+ts1p=$PORT; PORT=$((PORT+1))
+ts2p=$PORT; PORT=$((PORT+1))
+for i in 0 1 2 3 4 5 6 7 8 9; do printf "%d%08d\n" $i $RANDOM; done >"$tin"
+CMD0="$TRACE $SOCAT $opts -d -d -u UDP4-RECV:$ts2p,reuseaddr -"
+CMD1="$TRACE $SOCAT $opts -d -d -d -u -B 16 UDP4-RECV:$ts1p,reuseaddr UDP4-SENDTO:$LOCALHOST:$ts2p"
+CMD2="$TRACE $SOCAT $opts -u -b 10 OPEN:$tin UDP4-SENDTO:$LOCALHOST:$ts1p"
+printf "test $F_n $TEST... " $N
+$CMD0 >"$tf" 2>"${te}0" &
+pid0=$!
+$CMD1 2>"${te}1" &
+pid1=$!
+waitudp4port $ts2p 1
+waitudp4port $ts1p 1
+$CMD2 2>"${te}2"
+rc2=$?
+i=0; while [ "$(wc -c <"$tf")" -lt 100 -a "$i" -lt 10 ]; do usleep 100000; i=$((i+1)); done
+kill $pid0 $pid1 2>/dev/null; wait
+if [ $rc2 -ne 0 ] || ! diff "$tin" "$tf" >"$tdiff" ||
+    [ "$(grep -c "received packet with 10 bytes" "${te}0")" -ne 10 ] ||
+    ! grep -q "using recvmmsg() and sendmmsg()" "${te}1"; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1 &"
+    echo "$CMD2"
+    cat "${te}0"
+    cat "${te}1"
+    cat "${te}2"
+    cat "$tdiff"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ -n "$debug" ]; then cat "${te}1"; fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+N=$((N+1))
+
+
+NAME=UDP_SENDTO_STATS
+case "$TESTS" in
+*%$N%*|*%functions%*|*%ip4%*|*%dgram%*|*%udp%*|*%udp4%*|*%$NAME%*)
+TEST="$NAME: UDP sendto logs the local address once and a packet summary"
+# ten packets of ten bytes are sent with -d -d; the log must show the local
+# address once, and the summary on close must count ten packets, 100 bytes
+if ! eval $NUMCOND; then :; else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tdiff="$td/test$N.diff"
+tin="$td/test$N.in"
+tsp=$PORT; PORT=$((PORT+1))
+for i in 0 1 2 3 4 5 6 7 8 9; do printf "%d%08d\n" $i $RANDOM; done >"$tin"
+CMD0="$TRACE $SOCAT $opts -u UDP4-RECV:$tsp,reuseaddr -"
+CMD1="$TRACE $SOCAT $opts -d -d -u -b 10 OPEN:$tin UDP4-SENDTO:$LOCALHOST:$tsp"
+printf "test $F_n $TEST... " $N
+$CMD0 >"$tf" 2>"${te}0" &
+pid0=$!
+waitudp4port $tsp 1
+$CMD1 2>"${te}1"
+rc1=$?
+i=0; while [ "$(wc -c <"$tf")" -lt 100 -a "$i" -lt 10 ]; do usleep 100000; i=$((i+1)); done
+kill $pid0 2>/dev/null; wait
+if [ $rc1 -ne 0 ] || ! diff "$tin" "$tf" >"$tdiff" ||
+    [ "$(grep -c "local address:" "${te}1")" -ne 1 ] ||
+    ! grep -q "sent 10 packets with 100 bytes" "${te}1"; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1"
+    cat "${te}0"
+    cat "${te}1"
+    cat "$tdiff"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ -n "$debug" ]; then cat "${te}1"; fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+N=$((N+1))
+
+
+NAME=UDP_MULTI
+case "$TESTS" in
+*%$N%*|*%functions%*|*%ip4%*|*%dgram%*|*%udp%*|*%udp4%*|*%recv%*|*%$NAME%*)
+TEST="$NAME: UDP-RECVFROM keeping one session per peer in one process"
+# a receiver with option multi runs a program per peer that prefixes each
+# line with its process id; two clients send two packets each: both packets
+# of a client must reach the same program, the clients different programs,
+# and with -T 1 an idle session must end
+if ! eval $NUMCOND; then :;
+elif ! $SOCAT -V |grep -q "#define WITH_EPOLL"; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}EPOLL not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tsp=$PORT; PORT=$((PORT+1))
+tcp1=$PORT; PORT=$((PORT+1))
+tcp2=$PORT; PORT=$((PORT+1))
+CMD0="$TRACE $SOCAT $opts -d -d -d -T 1 UDP4-RECVFROM:$tsp,reuseaddr,multi SYSTEM:'while read l; do echo \$\$ \$l; done'"
+CMD1="$TRACE $SOCAT $opts -t 1 - UDP4-SENDTO:$LOCALHOST:$tsp"
+printf "test $F_n $TEST... " $N
+eval "$CMD0 >/dev/null 2>\"${te}0\" &"
+pid0=$!
+waitudp4port $tsp 1
+(echo a1; usleep 200000; echo a2) |$CMD1,bind=:$tcp1 >"${tf}1" 2>"${te}1" &
+pid1=$!
+(echo b1; usleep 200000; echo b2) |$CMD1,bind=:$tcp2 >"${tf}2" 2>"${te}2"
+wait $pid1
+sleep 2
+kill $pid0 2>/dev/null; wait
+a1="$(sed -n 's/ a1$//p' "${tf}1")"; a2="$(sed -n 's/ a2$//p' "${tf}1")"
+b1="$(sed -n 's/ b1$//p' "${tf}2")"; b2="$(sed -n 's/ b2$//p' "${tf}2")"
+if [ -z "$a1" -o "$a1" != "$a2" -o -z "$b1" -o "$b1" != "$b2" -o "$a1" = "$b1" ] ||
+    [ "$(grep -c "new session of" "${te}0")" -ne 2 ] ||
+    ! grep -q "session of FD .* is idle" "${te}0"; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1,bind=:$tcp1"
+    echo "$CMD1,bind=:$tcp2"
+    cat "${te}0"
+    cat "${tf}1" "${tf}2"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ -n "$debug" ]; then cat "${te}0"; fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+N=$((N+1))
+
+NAME=UDP_MULTI_SLOWOPEN
+case "$TESTS" in
+*%$N%*|*%functions%*|*%ip4%*|*%dgram%*|*%udp%*|*%udp4%*|*%recv%*|*%$NAME%*)
+TEST="$NAME: UDP-RECVFROM with option multi serves sessions while one opens"
+# a receiver with option multi connects each peer to an echo server. The
+# first client gets its first packet back; then the echo server is stopped
+# with a full backlog, so the connect for a second client hangs. The first
+# client must still get its second packet back, and the second client its
+# packet when the echo server continues
+if ! eval $NUMCOND; then :;
+elif ! $SOCAT -V |grep -q "#define WITH_EPOLL"; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}EPOLL not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+elif ! $SOCAT -V |grep -q "#define WITH_THREADS"; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}THREADS not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+da="test$N $(date) $RANDOM"
+tsp=$PORT; PORT=$((PORT+1))
+tcp1=$PORT; PORT=$((PORT+1))
+tcp2=$PORT; PORT=$((PORT+1))
+CMD0="$TRACE $SOCAT $opts TCP4-L:$PORT,reuseaddr,fork,backlog=1 PIPE"
+CMD1="$TRACE $SOCAT $opts -d -d UDP4-RECVFROM:$tsp,reuseaddr,multi TCP4:$LOCALHOST:$PORT"
+CMD2="$TRACE $SOCAT $opts -t 1 - UDP4-SENDTO:$LOCALHOST:$tsp,bind=:$tcp1"
+CMD3="$TRACE $SOCAT $opts /dev/null TCP4:$LOCALHOST:$PORT,connect-timeout=4"
+CMD4="$TRACE $SOCAT $opts -t 6 - UDP4-SENDTO:$LOCALHOST:$tsp,bind=:$tcp2"
+printf "test $F_n $TEST... " $N
+$CMD0 >/dev/null 2>"${te}0" &
+pid0=$!
+waittcp4port $PORT 1
+$CMD1 >/dev/null 2>"${te}1" &
+pid1=$!
+waitudp4port $tsp 1
+(echo "$da a1"; sleep 2; echo "$da a2") |$CMD2 >"${tf}2" 2>"${te}2" &
+pid2=$!
+sleep 0.5
+kill -STOP $pid0
+for i in 1 2 3 4; do $CMD3 2>/dev/null & done
+sleep 0.3
+echo "$da b1" |$CMD4 >"${tf}4" 2>"${te}4" &
+pid4=$!
+wait $pid2
+kill -CONT $pid0
+wait $pid4
+kill $pid0 $pid1 2>/dev/null; wait
+if [ "$(cat "${tf}2")" != "$(printf "$da a1\n$da a2")" ] ||
+    [ "$(cat "${tf}4")" != "$da b1" ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1 &"
+    echo "(echo \"$da a1\"; sleep 2; echo \"$da a2\") |$CMD2"
+    echo "kill -STOP $pid0; $CMD3 (4 times)"
+    echo "echo \"$da b1\" |$CMD4"
+    cat "${te}1"
+    cat "${te}2"
+    cat "${te}4"
+    cat "${tf}2" "${tf}4"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ -n "$debug" ]; then cat "${te}1"; fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+PORT=$((PORT+1))
+N=$((N+1))
+
+NAME=UDP_MULTI_LIMIT
+case "$TESTS" in
+*%$N%*|*%functions%*|*%ip4%*|*%dgram%*|*%udp%*|*%udp4%*|*%recv%*|*%$NAME%*)
+TEST="$NAME: UDP-RECVFROM with options multi and max-children limits sessions"
+# a receiver with option multi and max-children=1 runs a program per peer
+# that prefixes each line with its process id. While the session of the
+# first client exists, the packet of a second client must be dropped; after
+# the first session became idle, the next packet of the second client must
+# open a session
+if ! eval $NUMCOND; then :;
+elif ! $SOCAT -V |grep -q "#define WITH_EPOLL"; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}EPOLL not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tsp=$PORT; PORT=$((PORT+1))
+tcp1=$PORT; PORT=$((PORT+1))
+tcp2=$PORT; PORT=$((PORT+1))
+CMD0="$TRACE $SOCAT $opts -d -d -T 1 UDP4-RECVFROM:$tsp,reuseaddr,multi,max-children=1 SYSTEM:'while read l; do echo \$\$ \$l; done'"
+CMD1="$TRACE $SOCAT $opts -t 0.5 - UDP4-SENDTO:$LOCALHOST:$tsp"
+printf "test $F_n $TEST... " $N
+eval "$CMD0 >/dev/null 2>\"${te}0\" &"
+pid0=$!
+waitudp4port $tsp 1
+(echo a1; usleep 300000; echo a2) |$CMD1,bind=:$tcp1 >"${tf}1" 2>"${te}1" &
+pid1=$!
+(usleep 100000; echo b1; sleep 2; echo b2) |$CMD1,bind=:$tcp2 >"${tf}2" 2>"${te}2"
+wait $pid1
+kill $pid0 2>/dev/null; wait
+a1="$(sed -n 's/ a1$//p' "${tf}1")"; a2="$(sed -n 's/ a2$//p' "${tf}1")"
+if [ -z "$a1" -o "$a1" != "$a2" ] ||
+    grep -q " b1$" "${tf}2" || ! grep -q " b2$" "${tf}2"; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "(echo a1; usleep 300000; echo a2) |$CMD1,bind=:$tcp1"
+    echo "(usleep 100000; echo b1; sleep 2; echo b2) |$CMD1,bind=:$tcp2"
+    cat "${te}0"
+    cat "${tf}1" "${tf}2"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ -n "$debug" ]; then cat "${te}0"; fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+N=$((N+1))
+
+NAME=UDP_MULTI_NOLEAK
+case "$TESTS" in
+*%$N%*|*%functions%*|*%ip4%*|*%dgram%*|*%udp%*|*%udp4%*|*%recv%*|*%$NAME%*)
+TEST="$NAME: UDP-RECVFROM with option multi does not grow with the sessions"
+# a receiver with option multi and -T 0.2 forwards each peer to a sink. Each
+# round, 1000 new peers send a packet and their sessions become idle. After
+# two rounds that settle the heap, ten more must not let the resident memory
+# of the receiver grow by 400kB
+if ! eval $NUMCOND; then :;
+elif [ "$UNAME" != Linux ]; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}only on Linux$NORMAL\n" $N
+    numCANT=$((numCANT+1))
+elif ! $SOCAT -V |grep -q "#define WITH_EPOLL"; then
+    $PRINTF "test $F_n $TEST... ${YELLOW}EPOLL not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+else
+te="$td/test$N.stderr"
+tsp=$PORT; PORT=$((PORT+1))
+tsink=$PORT; PORT=$((PORT+1))
+CMD0="$TRACE $SOCAT $opts -u UDP4-RECV:$tsink,reuseaddr /dev/null"
+CMD1="$TRACE $SOCAT $opts -T 0.2 UDP4-RECVFROM:$tsp,reuseaddr,multi UDP4:$LOCALHOST:$tsink"
+printf "test $F_n $TEST... " $N
+$CMD0 >/dev/null 2>"${te}0" &
+pid0=$!
+waitudp4port $tsink 1
+MALLOC_ARENA_MAX=1 $CMD1 >/dev/null 2>"${te}1" &
+pid1=$!
+waitudp4port $tsp 1
+sessions () {
+    local i j
+    for ((j=0; j<$1; ++j)); do
+	for ((i=0; i<1000; ++i)); do
+	    echo x >/dev/udp/$LOCALHOST/$tsp
+	done
+	sleep 0.5
+    done
+}
+sessions 2
+rss0=$(awk '/^VmRSS:/ { print $2; }' /proc/$pid1/status)
+sessions 10
+rss1=$(awk '/^VmRSS:/ { print $2; }' /proc/$pid1/status)
+kill $pid0 $pid1 2>/dev/null; wait
+if [ -z "$rss0" ] || [ -z "$rss1" ] || [ $((rss1-rss0)) -ge 400 ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "MALLOC_ARENA_MAX=1 $CMD1 &"
+    echo "VmRSS after 2000 sessions: ${rss0}kB, after 12000: ${rss1}kB"
+    cat "${te}0"
+    cat "${te}1"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ -n "$debug" ]; then
+	echo "VmRSS after 2000 sessions: ${rss0}kB, after 12000: ${rss1}kB"
+    fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+N=$((N+1))
+
+NAME=UDP_GRO_GSO
+case "$TESTS" in
+*%$N%*|*%functions%*|*%ip4%*|*%dgram%*|*%udp%*|*%udp4%*|*%recv%*|*%$NAME%*)
+TEST="$NAME: UDP relay with options udp-gro and udp-segment keeps the packets"
+# a sender with udp-segment=1000 passes 5000 bytes as five packets; a relay
+# with udp-gro may receive them as one coalesced packet and passes it on with
+# udp-segment; the receiver must get five packets of 1000 bytes
+if ! eval $NUMCOND; then :;
+elif ! feat=$(testoptions udp-gro udp-segment); then
+    $PRINTF "test $F_n $TEST... ${YELLOW}$feat not available${NORMAL}\n" $N
+    numCANT=$((numCANT+1))
+else
+tf="$td/test$N.stdout"
+te="$td/test$N.stderr"
+tdiff="$td/test$N.diff"
+tp1=$PORT; PORT=$((PORT+1))
+tp2=$PORT; PORT=$((PORT+1))
+da="$td/test$N.data"
+dd if=/dev/urandom of="$da" bs=1000 count=5 2>/dev/null
+CMD0="$TRACE $SOCAT $opts -d -d -u UDP4-RECV:$tp2 $tf"
+CMD1="$TRACE $SOCAT $opts -b 65535 -u UDP4-RECV:$tp1,udp-gro UDP4-SENDTO:$LOCALHOST:$tp2,udp-segment=0"
+CMD2="$TRACE $SOCAT $opts -b 65535 -u OPEN:$da UDP4-SENDTO:$LOCALHOST:$tp1,udp-segment=1000"
+printf "test $F_n $TEST... " $N
+$CMD0 2>"${te}0" &
+pid0=$!
+$CMD1 2>"${te}1" &
+pid1=$!
+waitudp4port $tp2 1
+waitudp4port $tp1 1
+$CMD2 2>"${te}2"
+rc2=$?
+sleep 1
+kill $pid0 $pid1 2>/dev/null; wait
+if [ $rc2 -ne 0 ] || ! cmp -s "$da" "$tf" ||
+    [ "$(grep -c "received packet with 1000 bytes" "${te}0")" -ne 5 ]; then
+    $PRINTF "$FAILED\n"
+    echo "$CMD0 &"
+    echo "$CMD1 &"
+    echo "$CMD2"
+    cat "${te}0" "${te}1" "${te}2"
+    numFAIL=$((numFAIL+1))
+    listFAIL="$listFAIL $N"
+else
+    $PRINTF "$OK\n"
+    if [ -n "$debug" ]; then cat "${te}1"; fi
+    numOK=$((numOK+1))
+fi
+fi # NUMCOND
+ ;;
+esac
+N=$((N+1))
+
+
 echo "summary: $((N-1)) tests, $((numOK+numFAIL+numCANT)) selected; $numOK ok, $numFAIL failed, $numCANT could not be performed"
 
 if [ "$numFAIL" -gt 0 ]; then
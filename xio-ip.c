@@ -122,6 +122,54 @@ int xiogetaddrinfo(const char *node, const char *service,
 		   int family, int socktype, int protocol,
 		   union sockaddr_union *sau, socklen_t *socklen,
 		   unsigned long res_opts0, unsigned long res_opts1) {
+   return xiogetaddrlist(node, service, family, socktype, protocol,
+			 sau, socklen, NULL, res_opts0, res_opts1);
+}
+
+#if HAVE_GETADDRINFO
+/* fills list with the address first, followed by the other addresses of
+   res, alternating between the address families like RFC 8305 recommends */
+static void xioaddrlist_fill(struct xioaddrlist *list, struct addrinfo *res,
+			     struct addrinfo *first) {
+   struct addrinfo *next[2];	/* [0]: family of first, [1]: the other */
+   struct addrinfo *record;
+   int turn = 1, k, i;
+
+   list->num = 0;
+   record = first;
+   next[0] = next[1] = res;
+   while (record != NULL && list->num < XIO_MAXADDRS) {
+      if (record->ai_addrlen <= sizeof(list->sa[0])) {
+	 memcpy(&list->sa[list->num], record->ai_addr, record->ai_addrlen);
+	 list->salen[list->num] = record->ai_addrlen;
+	 ++list->num;
+      }
+      record = NULL;
+      for (i = 0; i < 2 && record == NULL; ++i) {
+	 k = (turn + i) % 2;
+	 while (next[k] != NULL) {
+	    struct addrinfo *r = next[k];
+	    next[k] = r->ai_next;
+	    if (r == first)  continue;
+	    if ((k == 0) == (r->ai_family == first->ai_family) &&
+		(r->ai_family == PF_INET || r->ai_family == PF_INET6)) {
+	       record = r;  turn = 1 - k;
+	       break;
+	    }
+	 }
+      }
+   }
+}
+#endif /* HAVE_GETADDRINFO */
+
+/* like xiogetaddrinfo(), but with list != NULL also returns up to
+   XIO_MAXADDRS addresses that node resolved to, starting with the one in
+   sau */
+int xiogetaddrlist(const char *node, const char *service,
+		   int family, int socktype, int protocol,
+		   union sockaddr_union *sau, socklen_t *socklen,
+		   struct xioaddrlist *list,
+		   unsigned long res_opts0, unsigned long res_opts1) {
    int port = -1;	/* port number in network byte order */
    char *numnode = NULL;
    size_t nodelen;
@@ -148,6 +196,7 @@ int xiogetaddrinfo(const char *node, const char *service,
 #endif /* HAVE_RESOLV_H */
    memset(sau, 0, *socklen);
    sau->soa.sa_family = family;
+   if (list != NULL)  list->num = 0;
 
    if (service && service[0]=='\0') {
       Error("empty port/service");
@@ -305,6 +354,7 @@ int xiogetaddrinfo(const char *node, const char *service,
 		record->ai_addr->sa_family);
 	 break;
       }
+      if (list != NULL)  xioaddrlist_fill(list, res, record);
       freeaddrinfo(res);
    } else {
       switch (family) {
@@ -432,8 +482,26 @@ int xiogetaddrinfo(const char *node, const char *service,
       case PF_INET6: sau->ip6.sin6_port = port; break;
 #endif /* WITH_IP6 */
       }
+      if (list != NULL) {
+	 int i;
+	 for (i = 0; i < list->num; ++i) {
+	    switch (list->sa[i].soa.sa_family) {
+#if WITH_IP4
+	    case PF_INET:  list->sa[i].ip4.sin_port  = port; break;
+#endif /* WITH_IP4 */
+#if WITH_IP6
+	    case PF_INET6: list->sa[i].ip6.sin6_port = port; break;
+#endif /* WITH_IP6 */
+	    }
+	 }
+      }
    }      
 #endif /* WITH_TCP || WITH_UDP */
+   if (list != NULL && list->num == 0) {
+      list->sa[0] = *sau;
+      list->salen[0] = *socklen;
+      list->num = 1;
+   }
 
    if (numnode)  free(numnode);
 
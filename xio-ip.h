@@ -37,10 +37,24 @@ extern const struct optdesc opt_res_defnames;
 extern const struct optdesc opt_res_stayopen;
 extern const struct optdesc opt_res_dnsrch;
 
+#define XIO_MAXADDRS 8	/* resolved addresses that a connect tries */
+
+/* the addresses that a name resolved to, in the order to try them */
+struct xioaddrlist {
+   int num;
+   union sockaddr_union sa[XIO_MAXADDRS];
+   socklen_t salen[XIO_MAXADDRS];
+} ;
+
 extern int xiogetaddrinfo(const char *node, const char *service,
 			  int family, int socktype, int protocol,
 			  union sockaddr_union *sa, socklen_t *socklen,
 			  unsigned long res_opts0, unsigned long res_opts1);
+extern int xiogetaddrlist(const char *node, const char *service,
+			  int family, int socktype, int protocol,
+			  union sockaddr_union *sa, socklen_t *socklen,
+			  struct xioaddrlist *list,
+			  unsigned long res_opts0, unsigned long res_opts1);
 extern
 int xiolog_ancillary_ip(struct cmsghdr *cmsg, int *num,
 			char *typbuff, int typlen,
@@ -14,17 +14,174 @@
 #include "xio-listen.h"
 #include "xio-ip6.h"
 #include "xio-ipapp.h"
+#include "xiobalance.h"
 
 const struct optdesc opt_sourceport = { "sourceport", "sp",       OPT_SOURCEPORT,  GROUP_IPAPP,     PH_LATE,TYPE_2BYTE,	OFUNC_SPEC };
 /*const struct optdesc opt_port = { "port",  NULL,    OPT_PORT,        GROUP_IPAPP, PH_BIND,    TYPE_USHORT,	OFUNC_SPEC };*/
 const struct optdesc opt_lowport = { "lowport", NULL, OPT_LOWPORT, GROUP_IPAPP, PH_LATE, TYPE_BOOL, OFUNC_SPEC };
+const struct optdesc opt_target   = { "target",   NULL, OPT_TARGET,   GROUP_IPAPP, PH_LATE, TYPE_STRING, OFUNC_SPEC };
+const struct optdesc opt_lb       = { "lb",       NULL, OPT_LB,       GROUP_IPAPP, PH_LATE, TYPE_STRING, OFUNC_SPEC };
+const struct optdesc opt_lb_eject = { "lb-eject", NULL, OPT_LB_EJECT, GROUP_IPAPP, PH_LATE, TYPE_INT,    OFUNC_SPEC };
+const struct optdesc opt_attempt_delay = { "attempt-delay", NULL, OPT_ATTEMPT_DELAY, GROUP_IPAPP, PH_LATE, TYPE_TIMESPEC, OFUNC_SPEC };
 
 #if WITH_IP4
-/* we expect the form "host:port" */
-int xioopen_ipapp_connect(int argc, const char *argv[], struct opt *opts,
-			   int xioflags, xiofile_t *xxfd,
-			   unsigned groups, int socktype, int ipproto,
-			   int pf) {
+/* the hosts and ports of a connect address: the address parameters and the
+   values of options target */
+struct xiotargets {
+   int num;
+   int policy;		/* XIOBALANCE_* */
+   int ejectsecs;
+   const char *host[XIOBALANCE_MAXTARGETS];
+   const char *port[XIOBALANCE_MAXTARGETS];
+} ;
+
+/* frees the hosts and ports that options target provided */
+static void xioipapp_freetargets(struct xiotargets *targets) {
+   int i;
+
+   for (i = 1; i < targets->num; ++i) {
+      free((char *)targets->host[i]);	/* the port follows in this string */
+   }
+   targets->num = 1;
+}
+
+/* retrieves options target, lb, and lb-eject.
+   returns 0 on success, or -1 on error */
+static int xioipapp_targets(struct opt *opts, const char *hostname,
+			    const char *portname, struct xiotargets *targets) {
+   char *target, *colon;
+   char *lbname = NULL;
+
+   targets->num = 1;
+   targets->host[0] = hostname;
+   targets->port[0] = portname;
+   targets->policy = XIOBALANCE_ROUNDROBIN;
+   targets->ejectsecs = 10;
+   while (retropt_string(opts, OPT_TARGET, &target) >= 0) {
+      /* the port follows the last colon, so IPv6 addresses may be given in
+	 brackets */
+      if ((colon = strrchr(target, ':')) == NULL || colon == target) {
+	 Error1("option target: \"%s\": expected <host>:<port>", target);
+	 free(target);
+	 xioipapp_freetargets(targets);
+	 return -1;
+      }
+      if (targets->num >= XIOBALANCE_MAXTARGETS) {
+	 Error1("option target: more than %d targets", XIOBALANCE_MAXTARGETS);
+	 free(target);
+	 xioipapp_freetargets(targets);
+	 return -1;
+      }
+      *colon = '\0';
+      targets->host[targets->num] = target;
+      targets->port[targets->num] = colon+1;
+      ++targets->num;
+   }
+   if (retropt_string(opts, OPT_LB, &lbname) >= 0) {
+      if (!strcasecmp(lbname, "roundrobin") || !strcasecmp(lbname, "rr")) {
+	 targets->policy = XIOBALANCE_ROUNDROBIN;
+      } else if (!strcasecmp(lbname, "random")) {
+	 targets->policy = XIOBALANCE_RANDOM;
+      } else if (!strcasecmp(lbname, "leastconn")) {
+	 targets->policy = XIOBALANCE_LEASTCONN;
+      } else if (!strcasecmp(lbname, "hash")) {
+	 targets->policy = XIOBALANCE_HASH;
+      } else {
+	 Error1("option lb: unknown policy \"%s\"", lbname);
+	 free(lbname);
+	 xioipapp_freetargets(targets);
+	 return -1;
+      }
+      free(lbname);
+   }
+   retropt_int(opts, OPT_LB_EJECT, &targets->ejectsecs);
+   return 0;
+}
+
+/* hashes the IP address of the peer of the first address, so option lb=hash
+   connects each client to the same target. With option multi the client is
+   given by xioclientpeer; an unconnected first address provides the peer of
+   its last packet.
+   returns 0 on success, or -1 when there is no such peer */
+static int xioipapp_clienthash(xiofile_t *xxfd, unsigned int *hash) {
+   union sockaddr_union sa;
+   socklen_t salen = sizeof(sa);
+   const unsigned char *addr;
+   size_t len, i;
+
+   if (xioclientpeerlen > 0) {
+      sa = xioclientpeer;
+   } else if (sock[0] == NULL || sock[0] == xxfd) {
+      return -1;
+   } else if (Getpeername(XIO_GETRDFD(sock[0]), &sa.soa, &salen) < 0) {
+      if (sock[0]->tag == XIO_TAG_DUAL || sock[0]->stream.salen == 0) {
+	 return -1;
+      }
+      sa = sock[0]->stream.peersa;
+   }
+   switch (sa.soa.sa_family) {
+#if WITH_IP4
+   case AF_INET:
+      addr = (unsigned char *)&sa.ip4.sin_addr; len = sizeof(sa.ip4.sin_addr);
+      break;
+#endif
+#if WITH_IP6
+   case AF_INET6:
+      addr = (unsigned char *)&sa.ip6.sin6_addr; len = sizeof(sa.ip6.sin6_addr);
+      break;
+#endif
+   default: return -1;
+   }
+   /* FNV-1a */
+   *hash = 2166136261U;
+   for (i = 0; i < len; ++i) {
+      *hash = (*hash ^ addr[i]) * 16777619U;
+   }
+   return 0;
+}
+
+/* selects the next target and resolves it into them and addrs. Targets
+   that fail to resolve are ejected.
+   returns the target number, or -1 when all targets have been tried */
+static int xioipapp_nexttarget(struct single *xfd,
+			       struct xiotargets *targets, unsigned int *tried,
+			       unsigned int hash, int pf, int socktype,
+			       int ipproto,
+			       union sockaddr_union *them, socklen_t *themlen,
+			       struct xioaddrlist *addrs) {
+   char infobuff[256];
+   int exitlevel;
+   int target, result;
+
+   while ((target = xiobalance_choose(targets->policy, targets->num, *tried,
+				      hash)) >= 0) {
+      *tried |= (1U<<target);
+      *themlen = sizeof(*them);
+      exitlevel = diag_get_int('e');	/* save current exit level */
+      diag_set_int('e', E_FATAL);	/* other targets may resolve */
+      result = xiogetaddrlist(targets->host[target], targets->port[target],
+			      pf, socktype, ipproto, them, themlen, addrs,
+			      xfd->para.socket.ip.res_opts[1],
+			      xfd->para.socket.ip.res_opts[0]);
+      diag_set_int('e', exitlevel);	/* restore old exit level */
+      if (result == STAT_OK) {
+	 Notice1("opening connection to %s",
+		 sockaddr_info((struct sockaddr *)them, *themlen,
+			       infobuff, sizeof(infobuff)));
+	 return target;
+      }
+      xiobalance_release(target);
+      xiobalance_eject(target, targets->ejectsecs);
+   }
+   return -1;
+}
+
+/* opens the connection of xioopen_ipapp_connect(); the hosts and ports of
+   option target are left in targets for the caller to free */
+static int xioipapp_connect(int argc, const char *argv[], struct opt *opts,
+			    int xioflags, xiofile_t *xxfd,
+			    int socktype, int ipproto, int pf,
+			    struct xiotargets *targets) {
    struct single *xfd = &xxfd->stream;
    struct opt *opts0 = NULL;
    const char *hostname = argv[1], *portname = argv[2];
@@ -33,8 +190,16 @@ int xioopen_ipapp_connect(int argc, const char *argv[], struct opt *opts,
    union sockaddr_union them_sa, *them = &them_sa;
    socklen_t uslen = sizeof(us_sa);
    socklen_t themlen = sizeof(them_sa);
+   struct xioaddrlist addrs;
+   struct timespec attemptdelay = { 0, 250000000 };	/* RFC 8305 */
+   struct timeval delay;
+   int rpf;		/* protocol family for name resolution */
    bool needbind = false;
    bool lowport = false;
+   unsigned int tried = 0, alltried;	/* bit masks of targets */
+   unsigned int hash = 0;
+   int target = 0;
+   int exitlevel;
    int level;
    int result;
 
@@ -43,22 +208,59 @@ int xioopen_ipapp_connect(int argc, const char *argv[], struct opt *opts,
    }
 
    xfd->howtoend = END_SHUTDOWN;
+   if (xfd->opts == opts)  xfd->opts = NULL;	/* opts is freed here */
 
    if (applyopts_single(xfd, opts, PH_INIT) < 0)  return -1;
    applyopts(-1, opts, PH_INIT);
 
    retropt_bool(opts, OPT_FORK, &dofork);
 
-   if (_xioopen_ipapp_prepare(opts, &opts0, hostname, portname, &pf, ipproto,
-			      xfd->para.socket.ip.res_opts[1],
-			      xfd->para.socket.ip.res_opts[0],
-			      them, &themlen, us, &uslen, &needbind, &lowport,
-			      socktype) != STAT_OK) {
+   if (xioipapp_targets(opts, hostname, portname, targets) < 0) {
       return STAT_NORETRY;
    }
+   alltried = (targets->num >= 32 ? ~0U : (1U<<targets->num)-1);
+   if (targets->policy == XIOBALANCE_HASH &&
+       xioipapp_clienthash(xxfd, &hash) < 0) {
+      targets->policy = XIOBALANCE_ROUNDROBIN;
+   }
+   retropt_timespec(opts, OPT_ATTEMPT_DELAY, &attemptdelay);
+   delay.tv_sec  = attemptdelay.tv_sec;
+   delay.tv_usec = attemptdelay.tv_nsec/1000;
+   retropt_socket_pf(opts, &pf);
+   rpf = pf;
+
+   exitlevel = diag_get_int('e');
+   do {	/* loop over targets that cannot be resolved */
+      if (targets->num > 1) {
+	 if ((target = xiobalance_choose(targets->policy, targets->num, tried,
+					 hash)) < 0) {
+	    Error1("%s: none of the targets could be resolved", argv[0]);
+	    return STAT_NORETRY;
+	 }
+	 tried |= (1U<<target);
+	 diag_set_int('e', E_FATAL);	/* other targets may resolve */
+      }
+      result =
+	 _xioopen_ipapp_prepare(opts, &opts0,
+				targets->host[target], targets->port[target],
+				&pf, ipproto,
+				xfd->para.socket.ip.res_opts[1],
+				xfd->para.socket.ip.res_opts[0],
+				them, &themlen, &addrs, us, &uslen,
+				&needbind, &lowport, socktype);
+      diag_set_int('e', exitlevel);
+      if (result == STAT_OK)  break;
+      if (targets->num <= 1)  return STAT_NORETRY;
+      xiobalance_release(target);
+      xiobalance_eject(target, targets->ejectsecs);
+      themlen = sizeof(them_sa);
+   } while (true);
 
    if (dofork) {
       xiosetchilddied();	/* set SIGCHLD handler */
+   } else if (xioflags & XIO_MAYNBCONNECT) {
+      /* _xioopen_connect() may return with the connect in progress */
+      xfd->flags |= XIO_MAYNBCONNECT;
    }
 
    if (xioopts.logopt == 'm') {
@@ -76,12 +278,57 @@ int xioopen_ipapp_connect(int argc, const char *argv[], struct opt *opts,
       } else
 #endif /* WITH_RETRY */
 	 level = E_ERROR;
+      if (level > E_WARN && targets->num > 1 && tried != alltried) {
+	 level = E_WARN;	/* fail over to the next target */
+      }
 
-      result =
-	 _xioopen_connect(xfd,
-			  needbind?(struct sockaddr *)us:NULL, uslen,
-			  (struct sockaddr *)them, themlen,
-			  opts, pf, socktype, ipproto, lowport, level);
+      if (addrs.num > 1 && !needbind && !(xfd->flags & XIO_MAYNBCONNECT) &&
+	  (delay.tv_sec != 0 || delay.tv_usec != 0)) {
+	 /* race the addresses of the name */
+	 result =
+	    _xioopen_connect_race(xfd, addrs.sa, addrs.salen, addrs.num,
+				  &opts, socktype, ipproto, lowport, &delay,
+				  level);
+      } else {
+	 result =
+	    _xioopen_connect(xfd,
+			     needbind?(struct sockaddr *)us:NULL, uslen,
+			     (struct sockaddr *)them, themlen,
+			     opts, them->soa.sa_family, socktype, ipproto,
+			     lowport, level);
+      }
+      if ((result == STAT_RETRYLATER || result == STAT_RETRYNOW) &&
+	  targets->num > 1) {
+	 /* skip this target for a while in all processes that share the
+	    state of option lb */
+	 xiobalance_release(target);
+	 xiobalance_eject(target, targets->ejectsecs);
+	 if ((target =
+	      xioipapp_nexttarget(xfd, targets, &tried, hash,
+				  rpf, socktype, ipproto, them, &themlen,
+				  &addrs))
+	     >= 0) {
+	    dropopts(opts, PH_ALL); free(opts); opts = copyopts(opts0, GROUP_ALL);
+	    continue;
+	 }
+	 /* all targets failed; with retry, start over with all of them */
+	 tried = 0;
+	 if (!xfd->forever && !xfd->retry) {
+	    if (level < E_ERROR) {
+	       Error1("%s: connection failed to all targets", argv[0]);
+	    }
+	    free(opts0); free(opts);
+	    return STAT_NORETRY;
+	 }
+	 if ((target =
+	      xioipapp_nexttarget(xfd, targets, &tried, hash,
+				  rpf, socktype, ipproto, them, &themlen,
+				  &addrs))
+	     < 0) {
+	    Error1("%s: none of the targets could be resolved", argv[0]);
+	    return STAT_NORETRY;
+	 }
+      }
       switch (result) {
       case STAT_OK: break;
 #if WITH_RETRY
@@ -95,9 +342,11 @@ int xioopen_ipapp_connect(int argc, const char *argv[], struct opt *opts,
 	    dropopts(opts, PH_ALL); free(opts); opts = copyopts(opts0, GROUP_ALL);
 	    continue;
 	 }
+	 if (targets->num > 1)  xiobalance_release(target);
 	 return STAT_NORETRY;
 #endif /* WITH_RETRY */
       default:
+	 if (targets->num > 1)  xiobalance_release(target);
 	  free(opts0);free(opts);
 	 return result;
       }
@@ -125,8 +374,22 @@ int xioopen_ipapp_connect(int argc, const char *argv[], struct opt *opts,
 
 	 /* parent process */
 	 Close(xfd->fd);
+	 if (targets->num > 1)  xiobalance_release(target);	/* child has it */
 	 /* with and without retry */
 	 Nanosleep(&xfd->intervall, NULL);
+	 if (targets->num > 1) {
+	    /* balance the next connection */
+	    tried = 0;
+	    if ((target =
+		 xioipapp_nexttarget(xfd, targets, &tried, hash,
+				     rpf, socktype, ipproto, them, &themlen,
+				     &addrs))
+		< 0) {
+	       Error1("%s: none of the targets could be resolved", argv[0]);
+	       free(opts0);
+	       return STAT_NORETRY;
+	    }
+	 }
 	 dropopts(opts, PH_ALL); free(opts); opts = copyopts(opts0, GROUP_ALL);
 	 continue;	/* with next socket() bind() connect() */
       } else
@@ -136,8 +399,15 @@ int xioopen_ipapp_connect(int argc, const char *argv[], struct opt *opts,
       }
    } while (true);
    /* only "active" process breaks (master without fork, or child) */
+   if (targets->num > 1) {
+      xfd->lbtarget = target;	/* xioclose1() releases it */
+   }
 
    if ((result = _xio_openlate(xfd, opts)) < 0) {
+      if (xfd->lbtarget >= 0) {
+	 xiobalance_release(xfd->lbtarget);
+	 xfd->lbtarget = -1;
+      }
 	   free(opts0);free(opts);
       return result;
    }
@@ -145,6 +415,21 @@ int xioopen_ipapp_connect(int argc, const char *argv[], struct opt *opts,
    return 0;
 }
 
+/* we expect the form "host:port" */
+int xioopen_ipapp_connect(int argc, const char *argv[], struct opt *opts,
+			   int xioflags, xiofile_t *xxfd,
+			   unsigned groups, int socktype, int ipproto,
+			   int pf) {
+   struct xiotargets targets;
+   int result;
+
+   targets.num = 0;
+   result = xioipapp_connect(argc, argv, opts, xioflags, xxfd,
+			     socktype, ipproto, pf, &targets);
+   xioipapp_freetargets(&targets);
+   return result;
+}
+
 
 /* returns STAT_OK on success or some other value on failure
    applies and consumes the following options:
@@ -159,6 +444,7 @@ int
 			   int protocol,
 			   unsigned long res_opts0, unsigned long res_opts1,
 			   union sockaddr_union *them, socklen_t *themlen,
+			   struct xioaddrlist *addrs,
 			   union sockaddr_union *us, socklen_t *uslen,
 			   bool *needbind, bool *lowport,
 			   int socktype) {
@@ -169,9 +455,9 @@ int
    retropt_socket_pf(opts, pf);
 
    if ((result =
-	xiogetaddrinfo(hostname, portname,
+	xiogetaddrlist(hostname, portname,
 		       *pf, socktype, protocol,
-		       (union sockaddr_union *)them, themlen,
+		       (union sockaddr_union *)them, themlen, addrs,
 		       res_opts0, res_opts1
 		       ))
        != STAT_OK) {
@@ -5,6 +5,7 @@
 #ifndef __xio_ipapp_h_included
 #define __xio_ipapp_h_included 1
 
+struct xioaddrlist;	/* xio-ip.h */
 
 /* when selecting a low port, this is the lowest possible */
 #define XIO_IPPORT_LOWER 640
@@ -13,6 +14,10 @@
 extern const struct optdesc opt_sourceport;
 /*extern const struct optdesc opt_port;*/
 extern const struct optdesc opt_lowport;
+extern const struct optdesc opt_target;
+extern const struct optdesc opt_lb;
+extern const struct optdesc opt_lb_eject;
+extern const struct optdesc opt_attempt_delay;
 
 extern int xioopen_ipapp_connect(int argc, const char *argv[], struct opt *opts, int xioflags, xiofile_t *fd,
 			 unsigned groups, int socktype,
@@ -23,6 +28,7 @@ extern int
 			   const char *portname, int *pf, int protocol,
 			   unsigned long res_opts0, unsigned long res_opts1,
 			   union sockaddr_union *them, socklen_t *themlen,
+			   struct xioaddrlist *addrs,
 			   union sockaddr_union *us,  socklen_t *uslen,
 			   bool *needbind, bool *lowport,
 			   int socktype);
@@ -15,16 +15,52 @@
 #include "xio-ip4.h"
 #include "xio-listen.h"
 #include "xio-tcpwrap.h"
+#include "xiobalance.h"
 
 /***** LISTEN options *****/
 const struct optdesc opt_backlog = { "backlog",   NULL, OPT_BACKLOG,     GROUP_LISTEN, PH_LISTEN, TYPE_INT,    OFUNC_SPEC };
 const struct optdesc opt_fork    = { "fork",      NULL, OPT_FORK,        GROUP_CHILD,   PH_PASTACCEPT, TYPE_BOOL,  OFUNC_SPEC };
 const struct optdesc opt_max_children = { "max-children",      NULL, OPT_MAX_CHILDREN,        GROUP_CHILD,   PH_PASTACCEPT, TYPE_INT,  OFUNC_SPEC };
+const struct optdesc opt_multi   = { "multi",     NULL, OPT_MULTI,       GROUP_CHILD,   PH_PASTACCEPT, TYPE_BOOL,  OFUNC_SPEC };
+const struct optdesc opt_prefork = { "prefork",   NULL, OPT_PREFORK,     GROUP_CHILD,   PH_PASTACCEPT, TYPE_INT,  OFUNC_SPEC };
+const struct optdesc opt_pool    = { "pool",      NULL, OPT_POOL,        GROUP_CHILD,   PH_PASTACCEPT, TYPE_INT,  OFUNC_SPEC };
+const struct optdesc opt_threads = { "threads",   NULL, OPT_THREADS,     GROUP_CHILD,   PH_PASTACCEPT, TYPE_INT,  OFUNC_SPEC };
+#ifdef SO_REUSEPORT
+const struct optdesc opt_shards  = { "shards",    NULL, OPT_SHARDS,      GROUP_CHILD,   PH_PASTACCEPT, TYPE_INT,  OFUNC_SPEC };
+const struct optdesc opt_incoming_cpu = { "incoming-cpu", NULL, OPT_INCOMING_CPU, GROUP_CHILD, PH_PASTACCEPT, TYPE_BOOL, OFUNC_SPEC };
+#endif
 /**/
 #if (WITH_UDP || WITH_TCP)
 const struct optdesc opt_range   = { "range",     NULL, OPT_RANGE,       GROUP_RANGE,  PH_ACCEPT, TYPE_STRING, OFUNC_SPEC };
 #endif
 
+static int xioopen_prefork(struct single *xfd, int workers, int maxchildren,
+			   int level, int fds[2]);
+#ifdef SO_REUSEPORT
+static int xioopen_shards(int shards, int level, int *cpu);
+#endif
+
+#if HAVE_ACCEPT4
+/* option pool: connections of the other address that the listening process
+   opened in advance, for handing them to its children */
+struct xiopool {
+   int size;			/* value of option pool */
+   int num;			/* connections in conn[] */
+   bool paused;			/* do not open more before the next accept */
+   struct xiopoolconn {
+      xiofile_t *xfd;		/* para.socket.connecting while it connects */
+      bool watch;		/* poll for EOF; false when the peer talked */
+   } *conn;			/* oldest first */
+   struct pollfd *pfds;		/* listener, childfd, and watched conns */
+} ;
+
+static void xiopool_fill(struct xiopool *pool);
+static int xiopool_pollfds(struct xiopool *pool, struct pollfd *pfds);
+static void xiopool_check(struct xiopool *pool, struct pollfd *pfds, int n);
+static xiofile_t *xiopool_take(struct xiopool *pool);
+static void xiopool_close(struct xiopool *pool);
+#endif /* HAVE_ACCEPT4 */
+
 
 /*
    applies and consumes the following option:
@@ -104,12 +140,17 @@ int
  */
 int _xioopen_listen(struct single *xfd, int xioflags, struct sockaddr *us, socklen_t uslen,
 		 struct opt *opts, int pf, int socktype, int proto, int level) {
-   struct sockaddr sa;
-   socklen_t salen;
    int backlog = 5;	/* why? 1 seems to cause problems under some load */
    char *rangename;
    bool dofork = false;
+   bool domulti = false;
+   int threads = 0;
    int maxchildren = 0;
+   int prefork = 0;
+   int preforkfd[2] = { -1, -1 };	/* worker: report pipe, parent alive */
+   int shards = 0;
+   bool incomingcpu = false;
+   int shardcpu = -1;		/* shard: pinned to this CPU */
    char infobuff[256];
    char lisname[256];
    union sockaddr_union _peername;
@@ -118,6 +159,13 @@ int _xioopen_listen(struct single *xfd, int xioflags, struct sockaddr *us, sockl
    union sockaddr_union *la = &_sockname;	/* local address */
    socklen_t pas = sizeof(_peername);	/* peer address size */
    socklen_t las = sizeof(_sockname);	/* local address size */
+   bool lasknown = false;	/* la has been filled in */
+   bool draining = false;	/* fork: more connections may be pending */
+   int childfd = -1;		/* fork: signalfd for reaping the children */
+#if HAVE_ACCEPT4
+   struct xiopool pool = { 0 };	/* fork: pre-opened connections */
+   struct pollfd pfds0[2];
+#endif
    int result;
 
    retropt_bool(opts, OPT_FORK, &dofork);
@@ -130,6 +178,38 @@ int _xioopen_listen(struct single *xfd, int xioflags, struct sockaddr *us, sockl
       xfd->flags |= XIO_DOESFORK;
    }
 
+   retropt_bool(opts, OPT_MULTI, &domulti);
+
+   if (domulti) {
+      if (!(xioflags & XIO_MAYFORK)) {
+	 Error("option multi not allowed here");
+	 return STAT_NORETRY;
+      }
+      if (dofork) {
+	 Error("options fork and multi are mutually exclusive");
+	 return STAT_NORETRY;
+      }
+      xfd->flags |= XIO_DOESMULTI;
+   }
+
+   retropt_int(opts, OPT_THREADS, &threads);
+
+   if (! domulti && threads) {
+      Error("option threads not allowed without option multi");
+      return STAT_NORETRY;
+   }
+   if (threads < 0) {
+      Error1("option threads: invalid number of threads %d", threads);
+      return STAT_NORETRY;
+   }
+#if !WITH_THREADS
+   if (threads > 1) {
+      Error("option threads: no thread support compiled in");
+      return STAT_NORETRY;
+   }
+#endif
+   xfd->para.socket.threads = threads;
+
    retropt_int(opts, OPT_MAX_CHILDREN, &maxchildren);
 
    if (! dofork && maxchildren) {
@@ -137,16 +217,118 @@ int _xioopen_listen(struct single *xfd, int xioflags, struct sockaddr *us, sockl
        return STAT_NORETRY;
    }
 
+   retropt_int(opts, OPT_PREFORK, &prefork);
+
+   if (! dofork && prefork) {
+       Error("option prefork not allowed without option fork");
+       return STAT_NORETRY;
+   }
+   if (prefork < 0) {
+      Error1("option prefork: invalid number of workers %d", prefork);
+      return STAT_NORETRY;
+   }
+
+#if HAVE_ACCEPT4
+   retropt_int(opts, OPT_POOL, &pool.size);
+
+   if (pool.size && (! dofork || prefork)) {
+      Error("option pool requires option fork without option prefork");
+      return STAT_NORETRY;
+   }
+   if (pool.size < 0) {
+      Error1("option pool: invalid number of connections %d", pool.size);
+      return STAT_NORETRY;
+   }
+   if (pool.size && xiohook_poolopen == NULL) {
+      Error("option pool not allowed here");
+      return STAT_NORETRY;
+   }
+#else
+   {
+      int poolsize;
+      if (retropt_int(opts, OPT_POOL, &poolsize) >= 0) {
+	 Error("option pool is not supported on this platform");
+	 return STAT_NORETRY;
+      }
+   }
+#endif /* HAVE_ACCEPT4 */
+
+#ifdef SO_REUSEPORT
+   retropt_int(opts, OPT_SHARDS, &shards);
+   retropt_bool(opts, OPT_INCOMING_CPU, &incomingcpu);
+
+   if (shards && ! dofork && ! domulti) {
+      Error("option shards not allowed without option fork or multi");
+      return STAT_NORETRY;
+   }
+   if (shards < 0) {
+      Error1("option shards: invalid number of shards %d", shards);
+      return STAT_NORETRY;
+   }
+   if (incomingcpu && ! shards) {
+      Error("option incoming-cpu not allowed without option shards");
+      return STAT_NORETRY;
+   }
+   if (shards) {
+      /* each shard binds its own socket, so the port must be fixed */
+      if (!(us->sa_family == AF_INET &&
+	    ((struct sockaddr_in *)us)->sin_port != 0)
+#if WITH_IP6
+	  && !(us->sa_family == AF_INET6 &&
+	       ((struct sockaddr_in6 *)us)->sin6_port != 0)
+#endif
+	  ) {
+	 Error("option shards requires an IP address with a fixed port");
+	 return STAT_NORETRY;
+      }
+   }
+#endif /* SO_REUSEPORT */
+
    if (applyopts_single(xfd, opts, PH_INIT) < 0)  return -1;
 
    if (dofork) {
       xiosetchilddied();	/* set SIGCHLD handler */
    }
 
+#ifdef SO_REUSEPORT
+   if (shards > 0) {
+      /* the parent process stays in xioopen_shards() */
+      if ((result = xioopen_shards(shards, level, &shardcpu)) != 0) {
+	 return result;
+      }
+#if WITH_RETRY
+      level = E_ERROR;
+#endif /* WITH_RETRY */
+   }
+#endif /* SO_REUSEPORT */
+
    if ((xfd->fd = xiosocket(opts, us->sa_family, socktype, proto, level)) < 0) {
       return STAT_RETRYLATER;
    }
 
+#ifdef SO_REUSEPORT
+   if (shards > 0) {
+      int one = 1;
+      if (Setsockopt(xfd->fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one))
+	  < 0) {
+	 Msg2(level, "setsockopt(%d, SOL_SOCKET, SO_REUSEPORT, {1}, ...): %s",
+	      xfd->fd, strerror(errno));
+	 Close(xfd->fd);
+	 return STAT_RETRYLATER;
+      }
+#ifdef SO_INCOMING_CPU
+      /* prefer this socket for connections that the kernel processes on
+	 the CPU of the shard */
+      if (incomingcpu && shardcpu >= 0 &&
+	  Setsockopt(xfd->fd, SOL_SOCKET, SO_INCOMING_CPU,
+		     &shardcpu, sizeof(shardcpu)) < 0) {
+	 Warn3("setsockopt(%d, SOL_SOCKET, SO_INCOMING_CPU, {%d}, ...): %s",
+	       xfd->fd, shardcpu, strerror(errno));
+      }
+#endif /* SO_INCOMING_CPU */
+   }
+#endif /* SO_REUSEPORT */
+
    applyopts_cloexec(xfd->fd, opts);
 
    applyopts(xfd->fd, opts, PH_PREBIND);
@@ -166,7 +348,6 @@ int _xioopen_listen(struct single *xfd, int xioflags, struct sockaddr *us, sockl
 #endif
    /* under some circumstances (e.g., TCP listen on port 0) bind() fills empty
       fields that we want to know. */
-   salen = sizeof(sa);
    if (Getsockname(xfd->fd, us, &uslen) < 0) {
       Warn4("getsockname(%d, %p, {%d}): %s",
 	    xfd->fd, &us, uslen, strerror(errno));
@@ -217,6 +398,54 @@ int _xioopen_listen(struct single *xfd, int xioflags, struct sockaddr *us, sockl
    } else {
       Info("starting accept loop");
    }
+   if (domulti) {
+      /* the application accepts the connections with xioaccept_multi();
+	 keep the options that apply to the accepted sockets */
+      Fcntl_l(xfd->fd, F_SETFL, Fcntl(xfd->fd, F_GETFL)|O_NONBLOCK);
+      if ((xfd->opts = copyopts(opts, GROUP_ALL)) == NULL) {
+	 Close(xfd->fd);
+	 return STAT_NORETRY;
+      }
+      dropopts(opts, PH_ALL);
+      Notice1("listening on %s", sockaddr_info(us, uslen, lisname, sizeof(lisname)));
+      return STAT_OK;
+   }
+   if (dofork) {
+      /* the children count their connections for option lb */
+      xiobalance_share();
+   }
+   if (prefork > 0) {
+      /* the parent process stays in xioopen_prefork() */
+      if ((result = xioopen_prefork(xfd, prefork, maxchildren, level,
+				    preforkfd)) != 0) {
+	 return result;
+      }
+      /* worker: accept one connection and continue like a child process */
+      dofork = false;
+#if WITH_RETRY
+      level = E_ERROR;
+#endif /* WITH_RETRY */
+   }
+#if HAVE_ACCEPT4
+   if (dofork) {
+      /* after each wakeup, accept all pending connections until accept4()
+	 fails with EAGAIN */
+      Fcntl_l(xfd->fd, F_SETFL, Fcntl(xfd->fd, F_GETFL)|O_NONBLOCK);
+      /* reap the children when waiting for connections instead of in the
+	 SIGCHLD handler */
+      childfd = xiochildwatch();
+      pool.pfds = pfds0;
+      if (pool.size > 0) {
+	 if ((pool.conn = Malloc(pool.size*sizeof(*pool.conn))) == NULL ||
+	     (pool.pfds = Malloc((2+pool.size)*sizeof(struct pollfd)))
+	     == NULL) {
+	    Close(xfd->fd);
+	    return STAT_RETRYLATER;
+	 }
+      }
+   }
+#endif
+   sockaddr_info(us, uslen, lisname, sizeof(lisname));
    while (true) {	/* but we only loop if fork option is set */
       char peername[256];
       char sockname[256];
@@ -224,46 +453,122 @@ int _xioopen_listen(struct single *xfd, int xioflags, struct sockaddr *us, sockl
 
       pa = &_peername;
       la = &_sockname;
-      salen = sizeof(struct sockaddr);
+      lasknown = false;
       do {
 	 /*? int level = E_ERROR;*/
-	 Notice1("listening on %s", sockaddr_info(us, uslen, lisname, sizeof(lisname)));
-	 ps = Accept(xfd->fd, (struct sockaddr *)&sa, &salen);
+	 if (draining) {
+	    /* accept the next pending connection without waiting */
+	 } else if (preforkfd[1] >= 0) {
+	    Notice1("listening on %s", lisname);
+	    /* worker: wait for a connection, or for the parent to terminate */
+	    struct pollfd pfds[2];
+	    pfds[0].fd = xfd->fd;       pfds[0].events = POLLIN;
+	    pfds[1].fd = preforkfd[1];  pfds[1].events = POLLIN;
+	    if (Poll(pfds, 2, -1) < 0) {
+	       if (errno == EINTR)  continue;
+	       Msg3(level, "poll({%d,%d}, 2, -1): %s",
+		    xfd->fd, preforkfd[1], strerror(errno));
+	       Close(xfd->fd);
+	       return STAT_RETRYLATER;
+	    }
+	    if (pfds[1].revents) {
+	       Info("parent process terminated, idle worker exits");
+	       Exit(0);
+	    }
+#if HAVE_ACCEPT4
+	 } else if (dofork) {
+	    struct pollfd *pfds = pool.pfds;
+	    int npfds, rc;
+	    if (pool.size > 0) {
+	       /* the children take the pooled connections, open new ones
+		  while no client waits */
+	       xiopool_fill(&pool);
+	    }
+	    Notice1("listening on %s", lisname);
+	    pfds[0].fd = xfd->fd;  pfds[0].events = POLLIN;
+	    pfds[1].fd = childfd;  pfds[1].events = POLLIN;
+	    do {
+	       npfds = 2 + xiopool_pollfds(&pool, pfds+2);
+	       if ((rc = Poll(pfds, npfds, -1)) < 0) {
+		  if (errno == EINTR)  continue;
+		  Msg4(level, "poll({%d,%d,...}, %d, -1): %s",
+		       xfd->fd, childfd, npfds, strerror(errno));
+		  xiopool_close(&pool);
+		  Close(xfd->fd);
+		  return STAT_RETRYLATER;
+	       }
+	       if (pfds[1].revents)  xioreapchildren();
+	       if (npfds > 2)  xiopool_check(&pool, pfds+2, npfds-2);
+	    } while (rc <= 0 || !pfds[0].revents);
+#endif /* HAVE_ACCEPT4 */
+	 } else {
+	    Notice1("listening on %s", lisname);
+	 }
+	 /* the peer address comes with the connection, no getpeername() */
+	 pas = sizeof(_peername);
+#if HAVE_ACCEPT4
+	 if (dofork || preforkfd[1] >= 0) {
+	    /* the listening socket is nonblocking; accept4() does not pass
+	       O_NONBLOCK on, and SOCK_CLOEXEC saves the fcntl() */
+	    ps = Accept4(xfd->fd, &pa->soa, &pas, SOCK_CLOEXEC);
+	 } else
+#endif
+	 ps = Accept(xfd->fd, &pa->soa, &pas);
 	 if (ps >= 0) {
-	    /*0 Info4("accept(%d, %p, {"F_Zu"}) -> %d", xfd->fd, &sa, salen, ps);*/
+#if HAVE_ACCEPT4
+	    draining = dofork;
+#endif
 	    break;	/* success, break out of loop */
 	 }
 	 if (errno == EINTR) {
 	    continue;
 	 }
+	 if ((errno == EAGAIN || errno == EWOULDBLOCK) &&
+	     (draining || preforkfd[1] >= 0)) {
+	    /* backlog drained, or another worker accepted the connection */
+	    draining = false;
+	    continue;
+	 }
 	 if (errno == ECONNABORTED) {
 	    Notice4("accept(%d, %p, {"F_socklen"}): %s",
-		    xfd->fd, &sa, salen, strerror(errno));
+		    xfd->fd, pa, pas, strerror(errno));
 	    continue;
 	 }
 	 Msg4(level, "accept(%d, %p, {"F_socklen"}): %s",
-	      xfd->fd, &sa, salen, strerror(errno));
+	      xfd->fd, pa, pas, strerror(errno));
+#if HAVE_ACCEPT4
+	 xiopool_close(&pool);
+#endif
 	 Close(xfd->fd);
 	 return STAT_RETRYLATER;
       } while (true);
-      applyopts_cloexec(ps, opts);
-      if (Getpeername(ps, &pa->soa, &pas) < 0) {
-	 Warn4("getpeername(%d, %p, {"F_socklen"}): %s",
-	       ps, pa, pas, strerror(errno));
-	 pa = NULL;
+#if HAVE_ACCEPT4
+      if (!dofork && preforkfd[1] < 0)
+#endif
+	 applyopts_cloexec(ps, opts);
+      /* the local address is needed here only for the log and for tcpwrap;
+	 otherwise it is looked up after fork, in the child process */
+      las = sizeof(_sockname);
+      if (diag_get_int('D') <= E_NOTICE
+#if (WITH_TCP || WITH_UDP) && WITH_LIBWRAP
+	  || xfd->para.socket.ip.dolibwrap
+#endif
+	  ) {
+	 if (Getsockname(ps, &la->soa, &las) < 0) {
+	    Warn4("getsockname(%d, %p, {"F_socklen"}): %s",
+		  ps, la, las, strerror(errno));
+	    la = NULL;
+	 }
+	 lasknown = true;
       }
-      if (Getsockname(ps, &la->soa, &las) < 0) {
-	 Warn4("getsockname(%d, %p, {"F_socklen"}): %s",
-	       ps, la, las, strerror(errno));
-	 la = NULL;
+      if (diag_get_int('D') <= E_NOTICE) {
+	 Notice2("accepting connection from %s on %s",
+		 sockaddr_info(&pa->soa, pas, peername, sizeof(peername)),
+		 la?
+		 sockaddr_info(&la->soa, las, sockname, sizeof(sockname)):"NULL");
       }
-      Notice2("accepting connection from %s on %s",
-	      pa?
-	      sockaddr_info(&pa->soa, pas, peername, sizeof(peername)):"NULL",
-	      la?
-	      sockaddr_info(&la->soa, las, sockname, sizeof(sockname)):"NULL");
 
-      if (pa != NULL && la != NULL && xiocheckpeer(xfd, pa, la) < 0) {
+      if (la != NULL && xiocheckpeer(xfd, pa, la) < 0) {
 	 if (Shutdown(ps, 2) < 0) {
 	    Info2("shutdown(%d, 2): %s", ps, strerror(errno));
 	 }
@@ -271,27 +576,38 @@ int _xioopen_listen(struct single *xfd, int xioflags, struct sockaddr *us, sockl
 	 continue;
       }
 
-      if (pa != NULL)
+      if (diag_get_int('D') <= E_INFO) {
 	 Info1("permitting connection from %s",
 	       sockaddr_info((struct sockaddr *)pa, pas,
 			     infobuff, sizeof(infobuff)));
+      }
 
       if (dofork) {
 	 pid_t pid;	/* mostly int; only used with fork */
          sigset_t mask_sigchld;
+#if HAVE_ACCEPT4
+	 xiofile_t *pooled = xiopool_take(&pool);
+#endif
 
          /* we must prevent that the current packet triggers another fork;
             therefore we wait for a signal from the recent child: USR1
             indicates that is has consumed the last packet; CHLD means it has
             terminated */
          /* block SIGCHLD and SIGUSR1 until parent is ready to react */
+         /* with childfd, SIGCHLD stays blocked in the parent */
          sigemptyset(&mask_sigchld);
          sigaddset(&mask_sigchld, SIGCHLD);
-         Sigprocmask(SIG_BLOCK, &mask_sigchld, NULL);
+         if (childfd < 0)  Sigprocmask(SIG_BLOCK, &mask_sigchld, NULL);
 
 	 if ((pid = xio_fork(false, level==E_ERROR?level:E_WARN)) < 0) {
+#if HAVE_ACCEPT4
+	    if (pooled != NULL) {
+	       Close(pooled->stream.fd);  free(pooled);
+	    }
+	    xiopool_close(&pool);
+#endif
 	    Close(xfd->fd);
-	    Sigprocmask(SIG_UNBLOCK, &mask_sigchld, NULL);
+	    if (childfd < 0)  Sigprocmask(SIG_UNBLOCK, &mask_sigchld, NULL);
 	    return STAT_RETRYLATER;
 	 }
 	 if (pid == 0) {	/* child */
@@ -305,6 +621,12 @@ int _xioopen_listen(struct single *xfd, int xioflags, struct sockaddr *us, sockl
 	       Info2("close(%d): %s", xfd->fd, strerror(errno));
 	    }
 	    xfd->fd = ps;
+#if HAVE_ACCEPT4
+	    /* the application uses this connection instead of opening the
+	       other address; the rest of the pool belongs to the parent */
+	    xiopool_close(&pool);
+	    xiopooled = pooled;
+#endif
 
 #if WITH_RETRY
 	    /* !? */
@@ -321,19 +643,49 @@ int _xioopen_listen(struct single *xfd, int xioflags, struct sockaddr *us, sockl
 	 if (Close(ps) < 0) {
 	    Info2("close(%d): %s", ps, strerror(errno));
 	 }
+#if HAVE_ACCEPT4
+	 if (pooled != NULL) {
+	    Close(pooled->stream.fd);  free(pooled);
+	 }
+	 pool.paused = false;
+#endif
 
          /* now we are ready to handle signals */
-         Sigprocmask(SIG_UNBLOCK, &mask_sigchld, NULL);
+         if (childfd < 0)  Sigprocmask(SIG_UNBLOCK, &mask_sigchld, NULL);
 
 	 while (maxchildren) {
 	    if (num_child < maxchildren) break;
 	    Notice("maxchildren are active, waiting");
+	    if (childfd >= 0) {
+	       /* do not accept until a child has been reaped */
+	       if (xiowaitchildren() < 0) {
+#if HAVE_ACCEPT4
+		  xiopool_close(&pool);
+#endif
+		  Close(xfd->fd);
+		  return STAT_RETRYLATER;
+	       }
+	       continue;
+	    }
 	    /* UINT_MAX would even be nicer, but Openindiana works only
 	       with 31 bits */
 	    while (!Sleep(INT_MAX)) ;	/* any signal lets us continue */
 	 }
-	 Info("still listening");
+	 if (!draining)  Info("still listening");
       } else {
+	 if (preforkfd[0] >= 0) {
+	    /* worker: let the parent fork a replacement */
+	    pid_t cpid = Getpid();
+#if !HAVE_ACCEPT4
+	    Fcntl_l(ps, F_SETFL, Fcntl(ps, F_GETFL)&~O_NONBLOCK);
+#endif
+	    if (Write(preforkfd[0], &cpid, sizeof(cpid)) < 0) {
+	       Warn3("write(%d, {"F_pid"}, ...): %s",
+		     preforkfd[0], cpid, strerror(errno));
+	    }
+	    Close(preforkfd[0]);
+	    Close(preforkfd[1]);
+	 }
 	 if (Close(xfd->fd) < 0) {
 	    Info2("close(%d): %s", xfd->fd, strerror(errno));
 	 }
@@ -348,11 +700,478 @@ int _xioopen_listen(struct single *xfd, int xioflags, struct sockaddr *us, sockl
    if ((result = _xio_openlate(xfd, opts)) < 0)
       return result;
 
+   if (la != NULL && !lasknown) {
+      if (Getsockname(xfd->fd, &la->soa, &las) < 0) {
+	 Warn4("getsockname(%d, %p, {"F_socklen"}): %s",
+	       xfd->fd, la, las, strerror(errno));
+	 la = NULL;
+      }
+   }
    /* set the env vars describing the local and remote sockets */
    if (la != NULL)  xiosetsockaddrenv("SOCK", la, las, proto);
-   if (pa != NULL)  xiosetsockaddrenv("PEER", pa, pas, proto);
+   xiosetsockaddrenv("PEER", pa, pas, proto);
 
    return 0;
 }
 
+
+/* option multi: accepts a connection on the listening socket of lxfd that
+   _xioopen_listen() left nonblocking, checks its peer, and applies the
+   remaining address options to it. The new connection inherits the
+   attributes of the listening address but no options, no lock, and no
+   unlink-close.
+   returns 1 with *cfd set when a connection was accepted; 0 when no
+   connection is pending; -1 if an error occurred */
+int xioaccept_multi(struct single *lxfd, xiofile_t **cfd) {
+   union sockaddr_union _peername, _sockname;
+   union sockaddr_union *pa = &_peername, *la = &_sockname;
+   socklen_t pas, las;
+   char peername[256], sockname[256];
+   struct single *xfd;
+   struct opt *opts;
+   int ps;
+
+   while (true) {
+      pas = sizeof(_peername);
+#if HAVE_ACCEPT4
+      /* Accept() would wait for a connection */
+      ps = Accept4(lxfd->fd, &pa->soa, &pas, 0);
+#else
+      ps = Accept(lxfd->fd, &pa->soa, &pas);
+#endif
+      if (ps < 0) {
+	 if (errno == EINTR || errno == ECONNABORTED)  continue;
+	 if (errno == EAGAIN || errno == EWOULDBLOCK)  return 0;
+	 Error4("accept(%d, %p, {"F_socklen"}): %s",
+		lxfd->fd, pa, pas, strerror(errno));
+	 return -1;
+      }
+      applyopts_cloexec(ps, lxfd->opts);
+      /* the local address is only needed for the log and for tcpwrap */
+      las = sizeof(_sockname);
+      if ((diag_get_int('D') <= E_NOTICE
+#if (WITH_TCP || WITH_UDP) && WITH_LIBWRAP
+	   || lxfd->para.socket.ip.dolibwrap
+#endif
+	   ) &&
+	  Getsockname(ps, &la->soa, &las) < 0) {
+	 Warn4("getsockname(%d, %p, {"F_socklen"}): %s",
+	       ps, la, las, strerror(errno));
+	 la = NULL;
+      }
+      if (diag_get_int('D') <= E_NOTICE) {
+	 Notice2("accepting connection from %s on %s",
+		 sockaddr_info(&pa->soa, pas, peername, sizeof(peername)),
+		 la?
+		 sockaddr_info(&la->soa, las, sockname, sizeof(sockname)):"NULL");
+      }
+      if (la == NULL || xiocheckpeer(lxfd, pa, la) >= 0) {
+	 break;
+      }
+      if (Shutdown(ps, 2) < 0) {
+	 Info2("shutdown(%d, 2): %s", ps, strerror(errno));
+      }
+      Close(ps);
+      la = &_sockname;
+   }
+#if !HAVE_ACCEPT4
+   /* some systems pass O_NONBLOCK of the listening socket on */
+   Fcntl_l(ps, F_SETFL, Fcntl(ps, F_GETFL)&~O_NONBLOCK);
+#endif
+
+   if ((*cfd = Malloc(sizeof(xiofile_t))) == NULL) {
+      Close(ps);
+      return -1;
+   }
+   xfd = &(*cfd)->stream;
+   memcpy(xfd, lxfd, sizeof(struct single));
+   xfd->argc = 0;	/* argv[] belongs to the listener */
+   xfd->flags &= ~XIO_DOESMULTI;
+   xfd->fd = ps;
+   xfd->opts = NULL;
+   xfd->havelock = false;
+   xfd->opt_unlink_close = false;
+   xfd->unlink_close = NULL;
+   memcpy(&xfd->peersa, pa, pas);
+   xfd->salen = pas;
+
+   if ((opts = copyopts(lxfd->opts, GROUP_ALL)) == NULL) {
+      Close(ps);
+      free(*cfd);
+      return -1;
+   }
+   applyopts(xfd->fd, opts, PH_FD);
+   applyopts(xfd->fd, opts, PH_PASTSOCKET);
+   applyopts(xfd->fd, opts, PH_CONNECTED);
+   if (_xio_openlate(xfd, opts) < 0) {
+      free(opts);
+      Close(ps);
+      free(*cfd);
+      return -1;
+   }
+   free(opts);
+   return 1;
+}
+
+
+/* option prefork: forks worker processes that wait on the listening socket
+   xfd->fd and accept one connection each, so the fork() is no longer in the
+   path of a new connection. The parent process keeps <workers> idle workers:
+   a worker reports an accepted connection through a pipe and the parent
+   forks a replacement, within the limit of maxchildren; idle workers that
+   died are replaced too.
+   Returns 0 in a worker process, with fds[0] the pipe to report to and
+   fds[1] a pipe that gets EOF when the parent terminates. The parent process
+   only returns on error. */
+static int xioopen_prefork(struct single *xfd, int workers, int maxchildren,
+			   int level, int fds[2]) {
+   int report[2], alive[2];
+   pid_t *idle, pid;
+   int nidle = 0, i, rc;
+   bool waiting = false;	/* max-children reached */
+   int childfd;		/* signalfd for reaping the children, or -1 */
+   sigset_t mask_sigchld;
+   struct pollfd pfds[2];
+
+   if (Pipe(report) < 0) {
+      Error1("pipe(): %s", strerror(errno));
+      Close(xfd->fd);
+      return STAT_RETRYLATER;
+   }
+   if (Pipe(alive) < 0) {
+      Error1("pipe(): %s", strerror(errno));
+      Close(report[0]);  Close(report[1]);
+      Close(xfd->fd);
+      return STAT_RETRYLATER;
+   }
+   if ((idle = Malloc(workers*sizeof(pid_t))) == NULL) {
+      Close(report[0]);  Close(report[1]);
+      Close(alive[0]);   Close(alive[1]);
+      Close(xfd->fd);
+      return STAT_NORETRY;
+   }
+   /* all idle workers wake up on a new connection; one of them gets it, the
+      others must not block in accept() */
+   Fcntl_l(xfd->fd, F_SETFL, Fcntl(xfd->fd, F_GETFL)|O_NONBLOCK);
+
+   Info1("pre-forking %d worker processes", workers);
+   childfd = xiochildwatch();
+   sigemptyset(&mask_sigchld);
+   sigaddset(&mask_sigchld, SIGCHLD);
+   while (true) {
+      /* replace idle workers that died */
+      for (i = 0; i < nidle; ) {
+	 if (Kill(idle[i], 0) < 0 && errno == ESRCH) {
+	    Warn1("idle worker process "F_pid" terminated", idle[i]);
+	    idle[i] = idle[--nidle];
+	 } else {
+	    ++i;
+	 }
+      }
+      while (nidle < workers && (maxchildren == 0 || num_child < maxchildren)) {
+	 /* num_child must be counted before the child can die */
+	 if (childfd < 0)  Sigprocmask(SIG_BLOCK, &mask_sigchld, NULL);
+	 if ((pid = xio_fork(false, level==E_ERROR?level:E_WARN)) < 0) {
+	    if (childfd < 0)  Sigprocmask(SIG_UNBLOCK, &mask_sigchld, NULL);
+	    Close(report[0]);  Close(report[1]);
+	    Close(alive[0]);   Close(alive[1]);
+	    Close(xfd->fd);
+	    free(idle);
+	    return STAT_RETRYLATER;
+	 }
+	 if (childfd < 0)  Sigprocmask(SIG_UNBLOCK, &mask_sigchld, NULL);
+	 if (pid == 0) {	/* worker */
+	    xiosetenvulong("PID", Getpid(), 1);
+	    Close(report[0]);
+	    Close(alive[1]);
+	    fds[0] = report[1];
+	    fds[1] = alive[0];
+	    free(idle);
+#if WITH_RETRY
+	    xfd->forever = false;  xfd->retry = 0;
+#endif /* WITH_RETRY */
+	    return 0;
+	 }
+	 idle[nidle++] = pid;
+      }
+      if (nidle < workers && !waiting) {
+	 Notice("maxchildren are active, waiting");
+      }
+      waiting = (nidle < workers);
+
+      /* with childfd, the children are reaped here; otherwise SIGCHLD
+	 interrupts poll(), and the timeout covers a worker that died just
+	 before */
+      pfds[0].fd = report[0];  pfds[0].events = POLLIN;
+      pfds[1].fd = childfd;    pfds[1].events = POLLIN;
+      if ((rc = Poll(pfds, 2, childfd<0?1000:-1)) < 0 && errno != EINTR) {
+	 Warn3("poll({%d,%d}, 2, ...): %s", report[0], childfd,
+	       strerror(errno));
+      }
+      if (rc <= 0) {
+	 continue;
+      }
+      if (pfds[1].revents) {
+	 xioreapchildren();
+      }
+      if (pfds[0].revents &&
+	  Read(report[0], &pid, sizeof(pid)) == sizeof(pid)) {
+	 Info1("worker process "F_pid" accepted a connection", pid);
+	 for (i = 0; i < nidle; ++i) {
+	    if (idle[i] == pid) {
+	       idle[i] = idle[--nidle];
+	       break;
+	    }
+	 }
+      }
+   }
+}
+
+#ifdef SO_REUSEPORT
+/* option shards: forks <shards> processes that each listen on their own
+   socket with SO_REUSEPORT, so the kernel distributes the connections among
+   them. Shard <i> is pinned to the i-th CPU of the affinity mask (modulo
+   the number of CPUs) and terminates with the parent process.
+   Returns 0 in a shard process, with *cpu set to its CPU or -1. The parent
+   process waits for the shards and exits when all of them have terminated;
+   it only returns on error. */
+static int xioopen_shards(int shards, int level, int *cpu) {
+   pid_t ppid = Getpid(), pid;
+   sigset_t mask_sigchld;
+   int i, status;
+   bool failed = false;
+#if HAVE_SCHED_SETAFFINITY
+   cpu_set_t cpus;
+   int ncpus = 0;
+
+   if (sched_getaffinity(0, sizeof(cpus), &cpus) < 0) {
+      Warn1("sched_getaffinity(0, ...): %s", strerror(errno));
+   } else {
+      ncpus = CPU_COUNT(&cpus);
+   }
+#endif /* HAVE_SCHED_SETAFFINITY */
+
+   /* the shards are reaped with waitpid() below */
+   sigemptyset(&mask_sigchld);
+   sigaddset(&mask_sigchld, SIGCHLD);
+   Sigprocmask(SIG_BLOCK, &mask_sigchld, NULL);
+   for (i = 0; i < shards; ++i) {
+      if ((pid = xio_fork(false, level==E_ERROR?level:E_WARN)) < 0) {
+	 Sigprocmask(SIG_UNBLOCK, &mask_sigchld, NULL);
+	 return STAT_RETRYLATER;
+      }
+      if (pid > 0) {
+	 continue;
+      }
+      /* shard */
+      Sigprocmask(SIG_UNBLOCK, &mask_sigchld, NULL);
+#if HAVE_PRCTL && defined(PR_SET_PDEATHSIG)
+      if (prctl(PR_SET_PDEATHSIG, SIGTERM) < 0) {
+	 Warn1("prctl(PR_SET_PDEATHSIG, SIGTERM): %s", strerror(errno));
+      } else if (getppid() != ppid) {
+	 Exit(0);	/* parent already gone */
+      }
+#endif
+      *cpu = -1;
+#if HAVE_SCHED_SETAFFINITY
+      if (ncpus > 0) {
+	 cpu_set_t one;
+	 int c, n = i % ncpus;
+
+	 for (c = 0; !CPU_ISSET(c, &cpus) || n-- > 0; ++c) ;
+	 CPU_ZERO(&one);
+	 CPU_SET(c, &one);
+	 if (sched_setaffinity(0, sizeof(one), &one) < 0) {
+	    Warn2("sched_setaffinity(0, {%d}): %s", c, strerror(errno));
+	 } else {
+	    *cpu = c;
+	 }
+      }
+#endif /* HAVE_SCHED_SETAFFINITY */
+      xiosetenvulong("SHARD", i, 1);
+      Info2("shard %d on CPU %d", i, *cpu);
+      return 0;
+   }
+
+   Info1("started %d shard processes", shards);
+   while (shards > 0) {
+      if ((pid = Waitpid(-1, &status, 0)) < 0) {
+	 if (errno == EINTR)  continue;
+	 Warn1("waitpid(-1, {}, 0): %s", strerror(errno));
+	 break;
+      }
+      if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+	 Info1("shard process "F_pid" terminated", pid);
+      } else {
+	 Warn2("shard process "F_pid" terminated with status %d",
+	       pid, status);
+	 failed = true;
+      }
+      --shards;
+   }
+   Exit(failed?1:0);
+   return STAT_NORETRY;	/* not reached */
+}
+#endif /* SO_REUSEPORT */
+
+
+#if HAVE_ACCEPT4
+/* option pool: checks a pooled connection without blocking.
+   returns 1 if the peer sent data, 0 if it is idle, or -1 if the connection
+   has been closed */
+static int xiopool_alive(xiofile_t *xfd) {
+   char c;
+   ssize_t n;
+
+   n = Recv(xfd->stream.fd, &c, 1, MSG_PEEK|MSG_DONTWAIT);
+   if (n > 0)  return 1;
+   if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+      return 0;
+   return -1;
+}
+
+/* option pool: closes the i-th pooled connection and removes it */
+static void xiopool_drop(struct xiopool *pool, int i) {
+   xiofile_t *xfd = pool->conn[i].xfd;
+
+   Close(xfd->stream.fd);
+   free(xfd);
+   --pool->num;
+   memmove(&pool->conn[i], &pool->conn[i+1],
+	   (pool->num-i)*sizeof(pool->conn[0]));
+}
+
+/* option pool: opens connections of the other address until the pool is
+   full. TCP connects do not wait for the peer: poll() reports when they are
+   established. After a failure, no connection is opened before the next
+   accept */
+static void xiopool_fill(struct xiopool *pool) {
+   xiofile_t *xfd;
+   int type;
+   socklen_t typelen;
+
+   while (pool->num < pool->size && !pool->paused) {
+      if ((xfd = (*xiohook_poolopen)()) == NULL) {
+	 Warn("pool: failed to open connection, retrying after next accept");
+	 pool->paused = true;
+	 return;
+      }
+      typelen = sizeof(type);
+      if (xfd->tag == XIO_TAG_DUAL ||
+	  (xfd->stream.dtype & XIODATA_MASK) != XIODATA_STREAM ||
+	  Getsockopt(xfd->stream.fd, SOL_SOCKET, SO_TYPE, &type, &typelen) < 0 ||
+	  type != SOCK_STREAM) {
+	 Error("option pool requires a stream socket as other address");
+	 xioclose(xfd);
+	 pool->size = 0;
+	 return;
+      }
+      pool->conn[pool->num].xfd = xfd;
+      pool->conn[pool->num].watch = true;
+      ++pool->num;
+      if (xfd->stream.para.socket.connecting) {
+	 Info2("pool: connecting on fd %d, %d pooled",
+	       xfd->stream.fd, pool->num);
+      } else {
+	 Info2("pool: connection on fd %d established, %d pooled",
+	       xfd->stream.fd, pool->num);
+      }
+   }
+}
+
+/* option pool: fills in the pollfds of the connections that are connecting,
+   or that are watched for EOF; returns their number */
+static int xiopool_pollfds(struct xiopool *pool, struct pollfd *pfds) {
+   int i, n = 0;
+
+   for (i = 0; i < pool->num; ++i) {
+      if (!pool->conn[i].watch)  continue;
+      pfds[n].fd = pool->conn[i].xfd->stream.fd;
+      pfds[n].events =
+	 pool->conn[i].xfd->stream.para.socket.connecting ? POLLOUT : POLLIN;
+      pfds[n].revents = 0;
+      ++n;
+   }
+   return n;
+}
+
+/* option pool: finishes the connects that poll() reported done, and drops
+   the pooled connections that failed or that poll() reported closed.
+   A connection with data (e.g. a server greeting) is kept but no longer
+   watched */
+static void xiopool_check(struct xiopool *pool, struct pollfd *pfds, int n) {
+   int i, j;
+
+   for (j = 0; j < n; ++j) {
+      if (!pfds[j].revents)  continue;
+      for (i = 0; i < pool->num; ++i) {
+	 if (pool->conn[i].xfd->stream.fd == pfds[j].fd)  break;
+      }
+      if (i == pool->num)  continue;
+      if (pool->conn[i].xfd->stream.para.socket.connecting) {
+	 if (xioconnected(&pool->conn[i].xfd->stream) < 0) {
+	    Warn2("pool: connecting on fd %d: %s, retrying after next accept",
+		  pfds[j].fd, strerror(errno));
+	    xiopool_drop(pool, i);
+	    pool->paused = true;
+	 } else {
+	    Info1("pool: connection on fd %d established", pfds[j].fd);
+	 }
+	 continue;
+      }
+      switch (xiopool_alive(pool->conn[i].xfd)) {
+      case 1: pool->conn[i].watch = false; break;
+      case 0: break;
+      default:
+	 Info1("pool: connection on fd %d closed by peer", pfds[j].fd);
+	 xiopool_drop(pool, i);
+	 /* do not reconnect at once to a peer that closes connections */
+	 pool->paused = true;
+	 break;
+      }
+   }
+}
+
+/* option pool: removes the oldest pooled connection that is established
+   from the pool and returns it, or NULL when there is none */
+static xiofile_t *xiopool_take(struct xiopool *pool) {
+   xiofile_t *xfd;
+   int i = 0;
+
+   while (i < pool->num) {
+      xfd = pool->conn[i].xfd;
+      if (xfd->stream.para.socket.connecting) {
+	 ++i;
+	 continue;
+      }
+      if (xiopool_alive(xfd) < 0) {
+	 Info1("pool: connection on fd %d closed by peer", xfd->stream.fd);
+	 xiopool_drop(pool, i);
+	 continue;
+      }
+      --pool->num;
+      memmove(&pool->conn[i], &pool->conn[i+1],
+	      (pool->num-i)*sizeof(pool->conn[0]));
+      Info1("pool: handing connection on fd %d to child process",
+	    xfd->stream.fd);
+      return xfd;
+   }
+   return NULL;
+}
+
+/* option pool: closes all pooled connections and releases the pool */
+static void xiopool_close(struct xiopool *pool) {
+   int i;
+
+   if (pool->size == 0)  return;
+   for (i = 0; i < pool->num; ++i) {
+      Close(pool->conn[i].xfd->stream.fd);
+      free(pool->conn[i].xfd);
+   }
+   free(pool->conn);  pool->conn = NULL;
+   free(pool->pfds);  pool->pfds = NULL;
+   pool->num = pool->size = 0;
+}
+#endif /* HAVE_ACCEPT4 */
+
 #endif /* WITH_LISTEN */
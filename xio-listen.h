@@ -8,6 +8,12 @@
 extern const struct optdesc opt_backlog;
 extern const struct optdesc opt_fork;
 extern const struct optdesc opt_max_children;
+extern const struct optdesc opt_prefork;
+extern const struct optdesc opt_pool;
+extern const struct optdesc opt_multi;
+extern const struct optdesc opt_threads;
+extern const struct optdesc opt_shards;
+extern const struct optdesc opt_incoming_cpu;
 extern const struct optdesc opt_range;
 
 int
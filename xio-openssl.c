@@ -239,7 +239,7 @@ static int
       _xioopen_ipapp_prepare(opts, &opts0, hostname, portname, &pf, ipproto,
 			     xfd->para.socket.ip.res_opts[1],
 			     xfd->para.socket.ip.res_opts[0],
-			     them, &themlen, us, &uslen,
+			     them, &themlen, NULL, us, &uslen,
 			     &needbind, &lowport, socktype);
    if (result != STAT_OK)  return STAT_NORETRY;
 
@@ -524,6 +524,10 @@ static int
       default:
 	 return result;
       }
+      if (xfd->flags & XIO_DOESMULTI) {
+	 Error("option multi is not supported with OPENSSL-LISTEN");
+	 return STAT_NORETRY;
+      }
 
       result = _xioopen_openssl_listen(xfd, opt_ver, opt_commonname, ctx, level);
       switch (result) {
@@ -74,6 +74,8 @@ int _xioopen_foxec(int xioflags,	/* XIO_RDONLY etc. */
    bool nofork = false;
    bool withfork;
 
+   /* *copts is freed and replaced below */
+   if (fd->opts == *copts)  fd->opts = NULL;
    popts = moveopts(*copts, GROUP_ALL);
    if (applyopts_single(fd, popts, PH_INIT) < 0)  return -1;
    applyopts2(-1, popts, PH_INIT, PH_EARLY);
@@ -130,7 +130,7 @@ static int xioopen_proxy_connect(int argc, const char *argv[], struct opt *opts,
 			     &pf, ipproto,
 			     xfd->para.socket.ip.res_opts[1],
 			     xfd->para.socket.ip.res_opts[0],
-			     them, &themlen, us, &uslen,
+			     them, &themlen, NULL, us, &uslen,
 			     &needbind, &lowport, socktype);
    if (result != STAT_OK)  return result;
 
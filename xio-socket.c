@@ -698,25 +698,15 @@ int xioopen_socket_datagram(int argc, const char *argv[], struct opt *opts,
 #endif /* WITH_GENERICSOCKET */
 
 
-/* a subroutine that is common to all socket addresses that want to connect
-   to a peer address.
-   might fork.
-   applies and consumes the following options: 
-   PH_PASTSOCKET, PH_FD, PH_PREBIND, PH_BIND, PH_PASTBIND, PH_CONNECT,
-   PH_CONNECTED, PH_LATE,
-   OFUNC_OFFSET, 
-   OPT_SO_TYPE, OPT_SO_PROTOTYPE, OPT_USER, OPT_GROUP, OPT_CLOEXEC
-   returns 0 on success.
-*/
-int _xioopen_connect(struct single *xfd, struct sockaddr *us, size_t uslen,
-		     struct sockaddr *them, size_t themlen,
-		     struct opt *opts, int pf, int socktype, int protocol,
-		     bool alt, int level) {
-   int fcntl_flags = 0;
+/* creates the socket of a connect address, applies the options of the
+   phases up to PH_CONNECT, and binds it to us, or to a low port with alt.
+   returns STAT_OK, or STAT_RETRYLATER on failure */
+static int _xioopen_connect_socket(struct single *xfd,
+				   struct sockaddr *us, size_t uslen,
+				   struct sockaddr *them, struct opt *opts,
+				   int pf, int socktype, int protocol,
+				   bool alt, int level) {
    char infobuff[256];
-   union sockaddr_union la;
-   socklen_t lalen = themlen;
-   int _errno;
    int result;
 
    if ((xfd->fd = xiosocket(opts, pf, socktype, protocol, level)) < 0) {
@@ -822,8 +812,40 @@ int _xioopen_connect(struct single *xfd, struct sockaddr *us, size_t uslen,
 
    applyopts(xfd->fd, opts, PH_CONNECT);
 
+   return STAT_OK;
+}
+
+
+/* a subroutine that is common to all socket addresses that want to connect
+   to a peer address.
+   might fork.
+   applies and consumes the following options: 
+   PH_PASTSOCKET, PH_FD, PH_PREBIND, PH_BIND, PH_PASTBIND, PH_CONNECT,
+   PH_CONNECTED, PH_LATE,
+   OFUNC_OFFSET, 
+   OPT_SO_TYPE, OPT_SO_PROTOTYPE, OPT_USER, OPT_GROUP, OPT_CLOEXEC
+   returns 0 on success.
+*/
+int _xioopen_connect(struct single *xfd, struct sockaddr *us, size_t uslen,
+		     struct sockaddr *them, size_t themlen,
+		     struct opt *opts, int pf, int socktype, int protocol,
+		     bool alt, int level) {
+   int fcntl_flags = 0;
+   char infobuff[256];
+   union sockaddr_union la;
+   socklen_t lalen = themlen;
+   int _errno;
+   int result;
+
+   if ((result = _xioopen_connect_socket(xfd, us, uslen, them, opts,
+					 pf, socktype, protocol, alt, level))
+       != STAT_OK) {
+      return result;
+   }
+
    if (xfd->para.socket.connect_timeout.tv_sec  != 0 ||
-       xfd->para.socket.connect_timeout.tv_usec != 0) {
+       xfd->para.socket.connect_timeout.tv_usec != 0 ||
+       (xfd->flags & XIO_MAYNBCONNECT)) {
       fcntl_flags = Fcntl(xfd->fd, F_GETFL);
       Fcntl_l(xfd->fd, F_SETFL, fcntl_flags|O_NONBLOCK);
    }
@@ -838,7 +860,14 @@ int _xioopen_connect(struct single *xfd, struct sockaddr *us, size_t uslen,
    errno = _errno;
    if (result < 0) {
       if (errno == EINPROGRESS) {
-	 if (xfd->para.socket.connect_timeout.tv_sec  != 0 ||
+	 if (xfd->flags & XIO_MAYNBCONNECT) {
+	    /* the caller polls for POLLOUT and calls xioconnected() */
+	    Info4("connect(%d, %s, "F_Zd"): %s",
+		  xfd->fd, sockaddr_info(them, themlen, infobuff, sizeof(infobuff)),
+		  themlen, strerror(errno));
+	    xfd->para.socket.connecting = true;
+	    xfd->para.socket.fcntl_flags = fcntl_flags;
+	 } else if (xfd->para.socket.connect_timeout.tv_sec  != 0 ||
 	     xfd->para.socket.connect_timeout.tv_usec != 0) {
 	    struct timeval timeout;
 	    struct pollfd writefd;
@@ -911,6 +940,9 @@ int _xioopen_connect(struct single *xfd, struct sockaddr *us, size_t uslen,
    } else {	/* result >= 0 */
       Notice1("successfully connected from local address %s",
 	      sockaddr_info(&la.soa, themlen, infobuff, sizeof(infobuff)));
+      if (xfd->flags & XIO_MAYNBCONNECT) {
+	 Fcntl_l(xfd->fd, F_SETFL, fcntl_flags);
+      }
    }
 
    applyopts_fchown(xfd->fd, opts);	/* OPT_USER, OPT_GROUP */
@@ -920,6 +952,231 @@ int _xioopen_connect(struct single *xfd, struct sockaddr *us, size_t uslen,
    return STAT_OK;
 }
 
+/* finishes a connect that xioopen() with flag XIO_MAYNBCONNECT left in
+   progress (para.socket.connecting), after poll() reported the socket
+   writable.
+   returns 0 when the connection is established, or -1 with errno set when
+   it failed */
+int xioconnected(struct single *xfd) {
+   char infobuff[256];
+   union sockaddr_union la;
+   socklen_t lalen = sizeof(la);
+   int err;
+   socklen_t errlen = sizeof(err);
+
+   if (Getsockopt(xfd->fd, SOL_SOCKET, SO_ERROR, &err, &errlen) < 0) {
+      Warn4("getsockopt(%d, SOL_SOCKET, SO_ERROR, %p, {"F_socklen"}): %s",
+	    xfd->fd, &err, errlen, strerror(errno));
+      return -1;
+   }
+   if (err != 0) {
+      errno = err;
+      return -1;
+   }
+   xfd->para.socket.connecting = false;
+   Fcntl_l(xfd->fd, F_SETFL, xfd->para.socket.fcntl_flags);
+   if (Getsockname(xfd->fd, &la.soa, &lalen) == 0) {
+      Notice1("successfully connected from local address %s",
+	      sockaddr_info(&la.soa, lalen, infobuff, sizeof(infobuff)));
+   }
+   return 0;
+}
+
+/* like _xioopen_connect(), but for num addresses that may differ in family.
+   A connection attempt to the next address starts each delay while earlier
+   attempts are pending, or when an attempt fails; the first connection that
+   succeeds is kept (Happy Eyeballs, RFC 8305). Each attempt applies a copy
+   of the options; *opts is replaced with the copy of the successful one.
+   returns 0 on success. */
+int _xioopen_connect_race(struct single *xfd,
+			  union sockaddr_union *them, socklen_t *themlen,
+			  int num, struct opt **opts, int socktype,
+			  int protocol, bool alt,
+			  const struct timeval *delay, int level) {
+   struct xioattempt {
+      int fd;
+      int fcntl_flags;
+      struct opt *opts;
+      struct timeval start;
+   } *att;
+   struct pollfd *pfd;
+   int *pidx;
+   struct timeval now, next, end, timeout, *ptimeout;
+   bool timed = false;	/* with connect-timeout */
+   char infobuff[256];
+   union sockaddr_union la;
+   socklen_t lalen;
+   int started = 0, pending = 0, winner = -1, lasterr = ETIMEDOUT;
+   int i, n, err;
+   socklen_t errlen;
+
+   if ((att = Malloc(num*sizeof(*att))) == NULL) {
+      return STAT_RETRYLATER;
+   }
+   if ((pfd = Malloc(num*(sizeof(*pfd)+sizeof(*pidx)))) == NULL) {
+      free(att);
+      return STAT_RETRYLATER;
+   }
+   pidx = (int *)(pfd+num);
+   Gettimeofday(&now, NULL);
+   next = end = now;
+   while (winner < 0) {
+      if (started < num && (pending == 0 || !timercmp(&now, &next, <))) {
+	 /* start the next attempt */
+	 i = started++;
+	 att[i].fd = -1;
+	 att[i].start = now;
+	 timeradd(&now, delay, &next);
+	 if ((att[i].opts = copyopts(*opts, GROUP_ALL)) == NULL) {
+	    break;
+	 }
+	 if (_xioopen_connect_socket(xfd, NULL, 0, &them[i].soa, att[i].opts,
+				     them[i].soa.sa_family, socktype,
+				     protocol, alt, E_INFO)
+	     != STAT_OK) {
+	    lasterr = errno;
+	    next = now;
+	    continue;
+	 }
+	 if (i == 0 &&
+	     (xfd->para.socket.connect_timeout.tv_sec  != 0 ||
+	      xfd->para.socket.connect_timeout.tv_usec != 0)) {
+	    timed = true;
+	    timeradd(&now, &xfd->para.socket.connect_timeout, &end);
+	 }
+	 att[i].fd = xfd->fd;
+	 att[i].fcntl_flags = Fcntl(att[i].fd, F_GETFL);
+	 Fcntl_l(att[i].fd, F_SETFL, att[i].fcntl_flags|O_NONBLOCK);
+	 if (Connect(att[i].fd, &them[i].soa, themlen[i]) >= 0) {
+	    winner = i;
+	    break;
+	 }
+	 if (errno != EINPROGRESS) {
+	    lasterr = errno;
+	    Info4("connect(%d, %s, "F_Zd"): %s",
+		  att[i].fd, sockaddr_info(&them[i].soa, themlen[i],
+					   infobuff, sizeof(infobuff)),
+		  themlen[i], strerror(errno));
+	    Close(att[i].fd);  att[i].fd = -1;
+	    next = now;
+	    continue;
+	 }
+	 ++pending;
+	 continue;
+      }
+      if (pending == 0)  break;	/* all attempts failed */
+
+      /* wait until an attempt completes, or the next one is due */
+      n = 0;
+      for (i = 0; i < started; ++i) {
+	 if (att[i].fd < 0)  continue;
+	 pfd[n].fd = att[i].fd;
+	 pfd[n].events = (POLLOUT|POLLERR);
+	 pidx[n++] = i;
+      }
+      ptimeout = NULL;
+      if (started < num) {
+	 timersub(&next, &now, &timeout);
+	 ptimeout = &timeout;
+      }
+      if (timed) {
+	 if (!timercmp(&now, &end, <)) {
+	    lasterr = ETIMEDOUT;
+	    break;
+	 }
+	 if (ptimeout == NULL || timercmp(&end, &next, <)) {
+	    timersub(&end, &now, &timeout);
+	    ptimeout = &timeout;
+	 }
+      }
+      if (xiopoll(pfd, n, ptimeout) < 0) {
+	 if (errno == EINTR) {
+	    Gettimeofday(&now, NULL);
+	    continue;
+	 }
+	 Msg2(level, "xiopoll({%d,POLLOUT|POLLERR},...): %s",
+	      pfd[0].fd, strerror(errno));
+	 break;
+      }
+      Gettimeofday(&now, NULL);
+      for (n = n-1; n >= 0; --n) {
+	 if (pfd[n].revents == 0)  continue;
+	 i = pidx[n];
+	 timersub(&now, &att[i].start, &timeout);
+	 errlen = sizeof(err);
+	 if (Getsockopt(att[i].fd, SOL_SOCKET, SO_ERROR, &err, &errlen) < 0) {
+	    err = errno;
+	 }
+	 if (err == 0) {
+	    Debug3("connect attempt to %s succeeded after "F_tv_sec".%06ld s",
+		   sockaddr_info(&them[i].soa, themlen[i],
+				 infobuff, sizeof(infobuff)),
+		   timeout.tv_sec, (long)timeout.tv_usec);
+	    winner = i;
+	    break;
+	 }
+	 Debug4("connect attempt to %s failed after "F_tv_sec".%06ld s: %s",
+		sockaddr_info(&them[i].soa, themlen[i],
+			      infobuff, sizeof(infobuff)),
+		timeout.tv_sec, (long)timeout.tv_usec, strerror(err));
+	 Info4("connect(%d, %s, "F_Zd"): %s",
+	       att[i].fd, sockaddr_info(&them[i].soa, themlen[i],
+					infobuff, sizeof(infobuff)),
+	       themlen[i], strerror(err));
+	 Close(att[i].fd);  att[i].fd = -1;
+	 --pending;
+	 lasterr = err;
+	 next = now;	/* start the next attempt now */
+      }
+   }
+
+   /* close the attempts that lost */
+   for (i = 0; i < started; ++i) {
+      if (i == winner)  continue;
+      if (att[i].fd >= 0) {
+	 if (timed && !timercmp(&now, &end, <)) {
+	    Debug1("connect attempt to %s timed out",
+		   sockaddr_info(&them[i].soa, themlen[i],
+				 infobuff, sizeof(infobuff)));
+	 } else {
+	    Debug1("connect attempt to %s cancelled",
+		   sockaddr_info(&them[i].soa, themlen[i],
+				 infobuff, sizeof(infobuff)));
+	 }
+	 Close(att[i].fd);
+      }
+      if (att[i].opts != NULL)  free(att[i].opts);
+   }
+   if (winner < 0) {
+      Msg3(level, "connecting to %s (%d addresses): %s",
+	   sockaddr_info(&them[0].soa, themlen[0], infobuff, sizeof(infobuff)),
+	   num, strerror(lasterr));
+      free(pfd);  free(att);
+      xfd->fd = -1;
+      return STAT_RETRYLATER;
+   }
+
+   xfd->fd = att[winner].fd;
+   Fcntl_l(xfd->fd, F_SETFL, att[winner].fcntl_flags);
+   free(*opts);
+   *opts = att[winner].opts;
+   free(pfd);  free(att);
+
+   la.soa.sa_family = them[winner].soa.sa_family;  lalen = sizeof(la);
+   if (Getsockname(xfd->fd, &la.soa, &lalen) < 0) {
+      Msg4(level-1, "getsockname(%d, %p, {%d}): %s",
+	    xfd->fd, &la.soa, lalen, strerror(errno));
+   }
+   Notice1("successfully connected from local address %s",
+	   sockaddr_info(&la.soa, lalen, infobuff, sizeof(infobuff)));
+
+   applyopts_fchown(xfd->fd, *opts);	/* OPT_USER, OPT_GROUP */
+   applyopts(xfd->fd, *opts, PH_CONNECTED);
+   applyopts(xfd->fd, *opts, PH_LATE);
+
+   return STAT_OK;
+}
+
 
 /* a subroutine that is common to all socket addresses that want to connect
    to a peer address.
@@ -971,9 +1228,11 @@ int xioopen_connect(struct single *xfd, struct sockaddr *us, size_t uslen,
 	    dropopts(opts, PH_ALL); opts = copyopts(opts0, GROUP_ALL);
 	    continue;
 	 }
+	 free(opts0);
 	 return STAT_NORETRY;
 #endif /* WITH_RETRY */
       default:
+	 free(opts0);
 	 return result;
       }
 
@@ -996,6 +1255,7 @@ int xioopen_connect(struct single *xfd, struct sockaddr *us, size_t uslen,
 	       dropopts(opts, PH_ALL); opts = copyopts(opts0, GROUP_ALL);
 	       Nanosleep(&xfd->intervall, NULL); continue;
 	    }
+	    free(opts0);
 	    return STAT_RETRYLATER;
 	 }
 
@@ -1020,6 +1280,7 @@ int xioopen_connect(struct single *xfd, struct sockaddr *us, size_t uslen,
 #endif
    } while (true);
 
+   free(opts0);
    return 0;
 }
 
@@ -1190,7 +1451,10 @@ void xiosigaction_hasread(int signum
    applies and consumes the following options: 
    PH_INIT, PH_PREBIND, PH_BIND, PH_PASTBIND, PH_EARLY, PH_PREOPEN, PH_FD,
    PH_CONNECTED, PH_LATE, PH_LATE2
-   OPT_FORK, OPT_SO_TYPE, OPT_SO_PROTOTYPE, cloexec, OPT_RANGE, tcpwrap
+   OPT_FORK, OPT_MULTI, OPT_SO_TYPE, OPT_SO_PROTOTYPE, cloexec, OPT_RANGE,
+   tcpwrap
+   With option multi it returns without waiting for a packet; the application
+   receives the packets and keeps a session per peer.
  */
 int _xioopen_dgram_recvfrom(struct single *xfd, int xioflags,
 			  struct sockaddr *us, socklen_t uslen,
@@ -1198,10 +1462,13 @@ int _xioopen_dgram_recvfrom(struct single *xfd, int xioflags,
 			  int pf, int socktype, int proto, int level) {
    char *rangename;
    bool dofork = false;
+   bool domulti = false;
    pid_t pid;	/* mostly int; only used with fork */
    char infobuff[256];
    char lisname[256];
    bool drop = false;	/* true if current packet must be dropped */
+   unsigned char *dgram = NULL;	/* the first packet */
+   ssize_t bytes = 0;
    int result;
 
    retropt_bool(opts, OPT_FORK, &dofork);
@@ -1214,6 +1481,22 @@ int _xioopen_dgram_recvfrom(struct single *xfd, int xioflags,
       xfd->flags |= XIO_DOESFORK;
    }
 
+   retropt_bool(opts, OPT_MULTI, &domulti);
+
+   if (domulti) {
+      if (!(xioflags & XIO_MAYFORK)) {
+	 Error("option multi not allowed here");
+	 return STAT_NORETRY;
+      }
+      if (dofork) {
+	 Error("options fork and multi are mutually exclusive");
+	 return STAT_NORETRY;
+      }
+      xfd->flags |= XIO_DOESMULTI;
+      /* limits the sessions */
+      retropt_int(opts, OPT_MAX_CHILDREN, &xfd->para.socket.maxsessions);
+   }
+
    if (applyopts_single(xfd, opts, PH_INIT) < 0)  return STAT_NORETRY;
 
    if ((xfd->fd = xiosocket(opts, pf, socktype, proto, level)) < 0) {
@@ -1265,6 +1548,20 @@ int _xioopen_dgram_recvfrom(struct single *xfd, int xioflags,
    xio_retropt_tcpwrap(xfd, opts);
 #endif /* && (WITH_TCP || WITH_UDP) && WITH_LIBWRAP */
 
+   if (domulti) {
+      /* a packet must never block the sessions */
+      Fcntl_l(xfd->fd, F_SETFL, Fcntl(xfd->fd, F_GETFL)|O_NONBLOCK);
+      if (us != NULL) {
+	 Notice1("receiving on %s", sockaddr_info(us, uslen, lisname, sizeof(lisname)));
+      } else {
+	 Notice1("receiving IP protocol %u", proto);
+      }
+      applyopts(xfd->fd, opts, PH_FD);
+      if ((result = _xio_openlate(xfd, opts)) != 0)
+	 return STAT_NORETRY;
+      return STAT_OK;
+   }
+
    if (xioopts.logopt == 'm') {
       Info("starting recvfrom loop, switching to syslog");
       diag_set('y', xioopts.syslogfac);  xioopts.logopt = 'y';
@@ -1351,6 +1648,7 @@ int _xioopen_dgram_recvfrom(struct single *xfd, int xioflags,
 
 	 Msg2(level, "poll({%d,,},,-1): %s", xfd->fd, strerror(errno));
 	 Close(xfd->fd);
+	 free(dgram);
 	 return STAT_RETRYLATER;
       } while (true);
 
@@ -1362,7 +1660,15 @@ int _xioopen_dgram_recvfrom(struct single *xfd, int xioflags,
 #if HAVE_STRUCT_MSGHDR_MSGCONTROLLEN
       msgh.msg_controllen = sizeof(ctrlbuff);
 #endif
-      if (xiogetpacketsrc(xfd->fd, &msgh) < 0) {
+      /* the packet is read here with its source address and ancillary
+	 messages; xioread() passes it on */
+      if (dgram == NULL && (dgram = Malloc(XIO_MAXDGRAM)) == NULL) {
+	 Close(xfd->fd);
+	 return STAT_RETRYLATER;
+      }
+      if ((bytes = xiorecvpacket(xfd->fd, dgram, XIO_MAXDGRAM, &msgh)) < 0) {
+	 Warn1("recvmsg(): %s", strerror(errno));
+	 free(dgram);
 	 return STAT_RETRYLATER;
       }
       palen = msgh.msg_namelen;
@@ -1374,10 +1680,7 @@ int _xioopen_dgram_recvfrom(struct single *xfd, int xioflags,
       xiodopacketinfo(&msgh, true, true);
 
       if (xiocheckpeer(xfd, pa, la) < 0) {
-	 /* drop packet */
-	 char buff[512];
-	 Recv(xfd->fd, buff, sizeof(buff), 0);
-	 continue;
+	 continue;	/* drop packet */
       }
       Info1("permitting packet from %s",
 	    sockaddr_info((struct sockaddr *)pa, palen,
@@ -1397,10 +1700,9 @@ int _xioopen_dgram_recvfrom(struct single *xfd, int xioflags,
       if (dofork) {
 	 sigset_t mask_sigchldusr1;
 
-	 /* we must prevent that the current packet triggers another fork;
-	    therefore we wait for a signal from the recent child: USR1
-	    indicates that is has consumed the last packet; CHLD means it has
-	    terminated */
+	 /* the child passes on the packet that we read; we wait for a signal
+	    from it before receiving the next one: USR1 indicates that is has
+	    consumed the packet; CHLD means it has terminated */
 	 /* block SIGCHLD and SIGUSR1 until parent is ready to react */
 	 sigemptyset(&mask_sigchldusr1);
 	 sigaddset(&mask_sigchldusr1, SIGCHLD);
@@ -1410,6 +1712,7 @@ int _xioopen_dgram_recvfrom(struct single *xfd, int xioflags,
 	 if ((pid = xio_fork(false, level)) < 0) {
 	    Close(xfd->fd);
 	    Sigprocmask(SIG_UNBLOCK, &mask_sigchldusr1, NULL);
+	    free(dgram);
 	    return STAT_RETRYLATER;
 	 }
 
@@ -1451,6 +1754,8 @@ int _xioopen_dgram_recvfrom(struct single *xfd, int xioflags,
 	break;
       }
    }
+   xfd->para.socket.dgram    = dgram;
+   xfd->para.socket.dgramlen = bytes;
    if ((result = _xio_openlate(xfd, opts)) != 0)
       return STAT_NORETRY;
 
@@ -1561,33 +1866,93 @@ int retropt_socket_pf(struct opt *opts, int *pf) {
 }
 
 
-/* this function calls recvmsg(..., MSG_PEEK, ...) to obtain information about
-   the arriving packet. in msgh the msg_name pointer must refer to an (empty)
-   sockaddr storage. */
-int xiogetpacketsrc(int fd, struct msghdr *msgh) {
-   char peekbuff[1];
+/* this function receives the next packet with one recvmsg() call: its data
+   into buff, its source address into the msg_name storage of msgh, and its
+   ancillary messages into the msg_control buffer of msgh (sizes in
+   msg_namelen and msg_controllen; both are set to the received lengths).
+   returns the number of bytes received, or -1 with errno set */
+ssize_t xiorecvpacket(int fd, void *buff, size_t bufsiz, struct msghdr *msgh) {
+   ssize_t bytes;
 #if HAVE_STRUCT_IOVEC
    struct iovec iovec;
-#endif
 
-#if HAVE_STRUCT_IOVEC
-   iovec.iov_base = peekbuff;
-   iovec.iov_len  = sizeof(peekbuff);
+   iovec.iov_base = buff;
+   iovec.iov_len  = bufsiz;
    msgh->msg_iov = &iovec;
    msgh->msg_iovlen = 1;
 #endif
 #if HAVE_STRUCT_MSGHDR_MSGFLAGS
    msgh->msg_flags = 0;
 #endif
-   if (Recvmsg(fd, msgh, MSG_PEEK
-#ifdef MSG_TRUNC
-		 |MSG_TRUNC
-#endif
-	       ) < 0) {
-      Warn1("recvmsg(): %s", strerror(errno));
-      return STAT_RETRYLATER;
+   do {
+      bytes = Recvmsg(fd, msgh, 0);
+   } while (bytes < 0 && errno == EINTR);
+   return bytes;
+}
+
+/* looks for the UDP_GRO ancillary message of a packet received with option
+   udp-gro.
+   returns the size of the segments that the kernel coalesced into the
+   packet, or 0 when it is a single packet */
+size_t xiogrosegsize(struct msghdr *msgh) {
+#if defined(UDP_GRO) && defined(HAVE_STRUCT_CMSGHDR) && defined(CMSG_DATA)
+   struct cmsghdr *cmsg;
+   int segsize;
+
+   for (cmsg = CMSG_FIRSTHDR(msgh); cmsg != NULL;
+	cmsg = CMSG_NXTHDR(msgh, cmsg)) {
+      if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+	 memcpy(&segsize, CMSG_DATA(cmsg), sizeof(segsize));
+	 return segsize > 0 ? segsize : 0;
+      }
    }
-   return STAT_OK;
+#endif /* defined(UDP_GRO) && ... */
+   return 0;
+}
+
+
+/* counts packets that have been sent to a sendto address. with log level
+   notice it reports the local address once, and the packets and bytes with
+   xiosendtostats() every XIO_SENDTOSTATS seconds; other levels save the
+   getsockname() and the formatting */
+void xiosendtocount(struct single *xfd, unsigned int packets, size_t bytes) {
+   xfd->para.socket.sentpackets += packets;
+   xfd->para.socket.sentbytes   += bytes;
+   if (diag_get_int('D') > E_NOTICE) {
+      return;
+   }
+   if (!xfd->para.socket.la_reported) {
+      char infobuff[256];
+      union sockaddr_union us;
+      socklen_t uslen = sizeof(us);
+
+      /* the local address does not change after the first packet */
+      if (Getsockname(xfd->fd, &us.soa, &uslen) == 0) {
+	 Notice1("local address: %s",
+		 sockaddr_info(&us.soa, uslen, infobuff, sizeof(infobuff)));
+      }
+      xfd->para.socket.la_reported = true;
+      xfd->para.socket.sentsince = time(NULL);
+      return;
+   }
+   if (time(NULL) - xfd->para.socket.sentsince >= XIO_SENDTOSTATS) {
+      xiosendtostats(xfd);
+   }
+}
+
+/* reports the packets and bytes sent since the last summary (E_NOTICE) and
+   starts a new interval */
+void xiosendtostats(struct single *xfd) {
+   time_t now = time(NULL);
+
+   if (xfd->para.socket.sentpackets > 0) {
+      Notice4("sent %lu packets with %llu bytes on fd %d in "F_time" seconds",
+	      xfd->para.socket.sentpackets, xfd->para.socket.sentbytes,
+	      xfd->fd, now - xfd->para.socket.sentsince);
+   }
+   xfd->para.socket.sentpackets = 0;
+   xfd->para.socket.sentbytes   = 0;
+   xfd->para.socket.sentsince   = now;
 }
 
 
@@ -11,6 +11,10 @@
 #define SO_PROTOTYPE 0x9999
 #endif
 
+/* the largest first packet that recvfrom addresses keep while opening */
+#define XIO_MAXDGRAM 65536
+#define XIO_SENDTOSTATS 10	/* seconds between the sendto summaries */
+
 extern const struct addrdesc xioaddr_socket_connect;
 extern const struct addrdesc xioaddr_socket_listen;
 extern const struct addrdesc xioaddr_socket_sendto;
@@ -87,6 +91,12 @@ extern int _xioopen_connect(struct single *fd,
 			    struct opt *opts,
 			    int pf, int socktype, int protocol,
 			    bool alt, int level);
+extern int _xioopen_connect_race(struct single *xfd,
+				 union sockaddr_union *them, socklen_t *themlen,
+				 int num, struct opt **opts, int socktype,
+				 int protocol, bool alt,
+				 const struct timeval *delay, int level);
+extern int xioconnected(struct single *xfd);
 
 /* common to xioopen_udp_sendto, ..unix_sendto, ..rawip */
 extern 
@@ -108,7 +118,13 @@ int _xioopen_dgram_recv(struct single *xfd, int xioflags,
 extern
 int xiodopacketinfo(struct msghdr *msgh, bool withlog, bool withenv);
 extern 
-int xiogetpacketsrc(int fd, struct msghdr *msgh);
+ssize_t xiorecvpacket(int fd, void *buff, size_t bufsiz, struct msghdr *msgh);
+extern
+size_t xiogrosegsize(struct msghdr *msgh);
+extern
+void xiosendtocount(struct single *xfd, unsigned int packets, size_t bytes);
+extern
+void xiosendtostats(struct single *xfd);
 extern
 int xiocheckpeer(xiosingle_t *xfd,
 		 union sockaddr_union *pa, union sockaddr_union *la);
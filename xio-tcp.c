@@ -71,7 +71,16 @@ const struct optdesc opt_tcp_syncnt = { "tcp-syncnt",   "syncnt",   OPT_TCP_SYNC
 const struct optdesc opt_tcp_linger2= { "tcp-linger2",  "linger2",  OPT_TCP_LINGER2, GROUP_IP_TCP, PH_PASTSOCKET, TYPE_INT, OFUNC_SOCKOPT, SOL_TCP, TCP_LINGER2 };
 #endif
 #ifdef TCP_DEFER_ACCEPT
-const struct optdesc opt_tcp_defer_accept={"tcp-defer-accept","defer-accept",OPT_TCP_DEFER_ACCEPT,GROUP_IP_TCP,PH_PASTSOCKET,TYPE_INT,OFUNC_SOCKOPT,SOL_TCP,TCP_DEFER_ACCEPT };
+const struct optdesc opt_tcp_defer_accept={"tcp-defer-accept","defer-accept",OPT_TCP_DEFER_ACCEPT,GROUP_IP_TCP,PH_PRELISTEN,TYPE_INT,OFUNC_SOCKOPT,SOL_TCP,TCP_DEFER_ACCEPT };
+#endif
+#ifdef TCP_FASTOPEN
+const struct optdesc opt_tcp_fastopen = { "tcp-fastopen", "fastopen", OPT_TCP_FASTOPEN, GROUP_IP_TCP, PH_PRELISTEN, TYPE_INT, OFUNC_SOCKOPT, SOL_TCP, TCP_FASTOPEN };
+#endif
+#ifdef TCP_FASTOPEN_CONNECT
+const struct optdesc opt_tcp_fastopen_connect = { "tcp-fastopen-connect", "fastopen-connect", OPT_TCP_FASTOPEN_CONNECT, GROUP_IP_TCP, PH_PASTSOCKET, TYPE_INT, OFUNC_SOCKOPT, SOL_TCP, TCP_FASTOPEN_CONNECT };
+#endif
+#ifdef TCP_NOTSENT_LOWAT
+const struct optdesc opt_tcp_notsent_lowat = { "tcp-notsent-lowat", "notsent-lowat", OPT_TCP_NOTSENT_LOWAT, GROUP_IP_TCP, PH_PASTSOCKET, TYPE_INT, OFUNC_SOCKOPT, SOL_TCP, TCP_NOTSENT_LOWAT };
 #endif
 #ifdef TCP_WINDOW_CLAMP
 const struct optdesc opt_tcp_window_clamp={"tcp-window-clamp","window-clamp",OPT_TCP_WINDOW_CLAMP,GROUP_IP_TCP,PH_PASTSOCKET,TYPE_INT,OFUNC_SOCKOPT,SOL_TCP,TCP_WINDOW_CLAMP };
@@ -24,6 +24,9 @@ extern const struct optdesc opt_tcp_keepcnt;
 extern const struct optdesc opt_tcp_syncnt;
 extern const struct optdesc opt_tcp_linger2;
 extern const struct optdesc opt_tcp_defer_accept;
+extern const struct optdesc opt_tcp_fastopen;
+extern const struct optdesc opt_tcp_fastopen_connect;
+extern const struct optdesc opt_tcp_notsent_lowat;
 extern const struct optdesc opt_tcp_window_clamp;
 extern const struct optdesc opt_tcp_info;
 extern const struct optdesc opt_tcp_quickack;
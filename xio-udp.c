@@ -73,6 +73,15 @@ const struct addrdesc addr_udp6_recvfrom= { "udp6-recvfrom",   3, xioopen_udp_re
 const struct addrdesc addr_udp6_recv    = { "udp6-recv",       1, xioopen_udp_recv,     GROUP_FD|GROUP_SOCKET|GROUP_SOCK_IP6|GROUP_IP_UDP|GROUP_RANGE,             PF_INET6, SOCK_DGRAM, IPPROTO_UDP  HELP(":<port>") };
 #endif /* WITH_IP6 */
 
+/****** UDP address options ******/
+
+#ifdef UDP_GRO
+const struct optdesc opt_udp_gro     = { "udp-gro",     "gro", OPT_UDP_GRO,     GROUP_IP_UDP, PH_LATE, TYPE_BOOL, OFUNC_EXT, SOL_UDP, UDP_GRO };
+#endif
+#ifdef UDP_SEGMENT
+const struct optdesc opt_udp_segment = { "udp-segment", "gso", OPT_UDP_SEGMENT, GROUP_IP_UDP, PH_LATE, TYPE_INT,  OFUNC_EXT, SOL_UDP, UDP_SEGMENT };
+#endif
+
 
 /* we expect the form: port */
 int xioopen_ipdgram_listen(int argc, const char *argv[], struct opt *opts,
@@ -86,6 +95,7 @@ int xioopen_ipdgram_listen(int argc, const char *argv[], struct opt *opts,
    int socktype = SOCK_DGRAM;
    struct pollfd readfd;
    bool dofork = false;
+   bool domulti = false;
    pid_t pid;
    char *rangename;
    char infobuff[256];
@@ -142,6 +152,23 @@ int xioopen_ipdgram_listen(int argc, const char *argv[], struct opt *opts,
       }
    }
 
+   retropt_bool(opts, OPT_MULTI, &domulti);
+
+   if (domulti) {
+      if (!(xioflags & XIO_MAYFORK)) {
+	 Error("option multi not allowed here");
+	 return STAT_NORETRY;
+      }
+      if (dofork) {
+	 Error("options fork and multi are mutually exclusive");
+	 return STAT_NORETRY;
+      }
+      fd->stream.flags |= XIO_DOESMULTI;
+      /* max-children limits the sessions */
+      retropt_int(opts, OPT_MAX_CHILDREN,
+		  &fd->stream.para.socket.maxsessions);
+   }
+
 #if WITH_IP4 /*|| WITH_IP6*/
    if (retropt_string(opts, OPT_RANGE, &rangename) >= 0) {
       if (xioparserange(rangename, pf, &fd->stream.para.socket.range) < 0) {
@@ -209,6 +236,9 @@ int xioopen_ipdgram_listen(int argc, const char *argv[], struct opt *opts,
 
       Notice1("listening on UDP %s",
 	      sockaddr_info(&us.soa, uslen, infobuff, sizeof(infobuff)));
+      if (domulti) {
+	 break;
+      }
       readfd.fd = fd->stream.fd;
       readfd.events = POLLIN|POLLERR;
       while (xiopoll(&readfd, 1, NULL) < 0) {
@@ -263,6 +293,15 @@ int xioopen_ipdgram_listen(int argc, const char *argv[], struct opt *opts,
       break;
    }
 
+   if (domulti) {
+      /* the application receives the packets and keeps a session per peer;
+	 it replies with sendto() */
+      fd->stream.dtype = XIODATA_RECVFROM;
+      Fcntl_l(fd->stream.fd, F_SETFL, Fcntl(fd->stream.fd, F_GETFL)|O_NONBLOCK);
+      applyopts(fd->stream.fd, opts, PH_LATE);
+      return _xio_openlate(&fd->stream, opts);
+   }
+
    applyopts(fd->stream.fd, opts, PH_CONNECT);
    if ((result = Connect(fd->stream.fd, &them->soa, themlen)) < 0) {
       Error4("connect(%d, {%s}, "F_socklen"): %s",
@@ -24,6 +24,9 @@ extern const struct addrdesc addr_udp6_datagram;
 extern const struct addrdesc addr_udp6_recvfrom;
 extern const struct addrdesc addr_udp6_recv;
 
+extern const struct optdesc opt_udp_gro;
+extern const struct optdesc opt_udp_segment;
+
 extern int xioopen_ipdgram_listen(int argc, const char *argv[], struct opt *opts,
 				  int rw, xiofile_t *fd,
 			  unsigned groups, int af, int ipproto,
@@ -32,12 +32,15 @@ struct opt;
 #define XIO_MAYEXEC    16 /* address is allowed to exec a prog (exec+nofork) */
 #define XIO_MAYCONVERT 32 /* address is allowed to perform modifications on the
 			     stream data, e.g. SSL, REALDINE; CRLF */
+#define XIO_MAYNBCONNECT 128 /* a TCP connect may still be in progress on
+				return, see xioconnected() */
 
 /* the status flags of xiofile_t */
 #define XIO_DOESFORK    XIO_MAYFORK
 #define XIO_DOESCHILD   XIO_MAYCHILD
 #define XIO_DOESEXEC    XIO_MAYEXEC
 #define XIO_DOESCONVERT XIO_MAYCONVERT
+#define XIO_DOESMULTI   64 /* listener: connections via xioaccept_multi() */
 
 
 /* methods for reading and writing, and for related checks */
@@ -165,6 +168,11 @@ typedef struct single {
 #if _WITH_SOCKET
    union sockaddr_union peersa;
    socklen_t salen;
+   bool gro;		/* option udp-gro: reads get coalesced packets */
+   bool gso;		/* option udp-segment: writes may be segmented */
+   size_t segsize;	/* udp-gro: segment size of the last read, or 0 when
+			   it was one packet */
+   int lbtarget;	/* option lb: the selected target, or -1 */
 #endif /* _WITH_SOCKET */
 #if WITH_TERMIOS
    bool ttyvalid;		/* the following struct is valid */
@@ -181,10 +189,21 @@ typedef struct single {
 #if _WITH_SOCKET
       struct {
 	 struct timeval connect_timeout; /* how long to hang in connect() */
+	 bool connecting;	/* XIO_MAYNBCONNECT: connect() in progress */
+	 int fcntl_flags;	/* ... the file status flags to restore then */
 	 union sockaddr_union la;	/* local socket address */
 	 bool null_eof;		/* with dgram: empty packet means EOF */
+	 unsigned char *dgram;	/* recvfrom: the first packet, read while
+				   opening; NULL when passed on */
+	 size_t dgramlen;
+	 bool la_reported;	/* sendto: local address has been logged */
+	 unsigned long sentpackets;	/* sendto: counts of the interval */
+	 unsigned long long sentbytes;
+	 time_t sentsince;	/* sendto: begin of the interval */
 	 bool dorange;
 	 struct xiorange range;	/* restrictions for peer address */
+	 int threads;		/* listener: transfer threads of option multi */
+	 int maxsessions;	/* recvfrom: max-children with option multi */
 #if _WITH_IP4 || _WITH_IP6
 	 struct {
 	    unsigned int res_opts[2];	/* bits to be set in _res.options are
@@ -383,6 +402,18 @@ struct opt {
 extern const char *PIPESEP;
 extern xiofile_t *sock[XIO_MAXSOCK];
 
+#if WITH_THREADS
+#define XIO_THREADLOCAL __thread
+#else
+#define XIO_THREADLOCAL
+#endif
+#if _WITH_SOCKET
+/* option multi: the peer of the client that the second address is being
+   opened for, in the thread that opens it; xioclientpeerlen is 0 otherwise */
+extern XIO_THREADLOCAL union sockaddr_union xioclientpeer;
+extern XIO_THREADLOCAL socklen_t xioclientpeerlen;
+#endif /* _WITH_SOCKET */
+
 extern int num_child;
 
 /* return values of xioopensingle */
@@ -405,6 +436,7 @@ extern int xiosetopt(char what, const char *arg);
 extern int xioinqopt(char what, char *arg, size_t n);
 extern xiofile_t *xioopen(const char *args, int flags);
 extern int xioopensingle(char *addr, struct single *xfd, int xioflags);
+extern int xioaccept_multi(struct single *lxfd, xiofile_t **cfd);
 extern int xioopenhelp(FILE *of, int level);
 
 /* must be outside function for use by childdied handler */
@@ -418,17 +450,26 @@ extern pid_t diedunknown[NUMUNKNOWN];	/* child died before it is registered */
 
 extern int xiosetsigchild(xiofile_t *xfd, int (*callback)(struct single *));
 extern int xiosetchilddied(void);
+extern int xiochildwatch(void);
+extern void xiochildunwatch(void);
+extern void xiochildadd(pid_t pid);
+extern int xioreapchildren(void);
+extern int xiowaitchildren(void);
 extern int xio_opt_signal(pid_t pid, int signum);
 extern void childdied(int signum);
 
 extern ssize_t xioread(xiofile_t *sock1, void *buff, size_t bufsiz);
 extern ssize_t xiopending(xiofile_t *sock1);
 extern ssize_t xiowrite(xiofile_t *sock1, const void *buff, size_t bufsiz);
+extern ssize_t xiowritesegs(xiofile_t *file, const void *buff, size_t bytes,
+			    size_t segsize);
 extern int xioshutdown(xiofile_t *sock, int how);
 
 extern int xioclose(xiofile_t *sock);
 extern void xioexit(void);
 
 extern int (*xiohook_newchild)(void);	/* xio calls this function from a new child process */
+extern xiofile_t *(*xiohook_poolopen)(void);	/* option pool: xio calls this function to open the other address */
+extern xiofile_t *xiopooled;	/* option pool: connection handed to the child process */
 
 #endif /* !defined(__xio_h_included) */
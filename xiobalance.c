@@ -0,0 +1,231 @@
+/* source: xiobalance.c */
+/* Copyright Gerhard Rieger */
+/* Published under the GNU General Public License V.2, see file COPYING */
+
+/* this file contains the target selection of option lb. A listening process
+   with option fork shares the state with its children: it assigns each child
+   a slot where the child records its target, and clears the slot when it
+   reaps the child; so the active connections per target are counted even
+   when a child is killed. Without shared state, e.g. with option multi, the
+   process counts the connections of its own targets until they are closed.
+   */
+
+#include "xiosysincludes.h"
+
+#include "compat.h"
+#include "mytypes.h"
+#include "error.h"
+#include "utils.h"
+#include "sysutils.h"
+
+#include "sycls.h"
+
+#include "xiobalance.h"
+
+
+struct xiobalance_state {
+   time_t ejected[XIOBALANCE_MAXTARGETS];	/* failed, skip until then */
+   struct {
+      pid_t pid;		/* 0: free; -1: reserved for a fork */
+      int target;		/* -1: none selected */
+   } slot[XIOBALANCE_SLOTS];
+} ;
+
+static struct xiobalance_state xiobalance_local;	/* when not shared */
+static struct xiobalance_state *xiobalance = &xiobalance_local;
+static bool xiobalance_owner;	/* this process assigns the slots */
+static int xiobalance_slot = -1;	/* slot of this process, or -1 */
+static int xiobalance_nextslot;	/* where to look for a free slot */
+static unsigned int xiobalance_seq;	/* number of forks, for round robin */
+static unsigned int xiobalance_calls;	/* selections in this process */
+static sigset_t xiobalance_sigmask;	/* restored after a fork */
+static int xiobalance_active[XIOBALANCE_MAXTARGETS];	/* when not shared:
+				   open connections per target */
+#if WITH_THREADS
+/* the opener threads of option multi select targets concurrently */
+static pthread_mutex_t xiobalance_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define xiobalance_lock()   pthread_mutex_lock(&xiobalance_mutex)
+#define xiobalance_unlock() pthread_mutex_unlock(&xiobalance_mutex)
+#else
+#define xiobalance_lock()
+#define xiobalance_unlock()
+#endif
+
+/* called by the listening process before it forks children: maps the state
+   shared with them.
+   returns 0 on success, or -1 if the state stays local */
+int xiobalance_share(void) {
+#if HAVE_SYS_MMAN_H && defined(MAP_ANONYMOUS)
+   struct xiobalance_state *shared;
+   int i;
+
+   if (xiobalance_owner)  return 0;
+   shared = Mmap(NULL, sizeof(*shared), PROT_READ|PROT_WRITE,
+		 MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+   if (shared == MAP_FAILED) {
+      Warn2("mmap(NULL, "F_Zu", ..., MAP_SHARED|MAP_ANONYMOUS, -1, 0): %s",
+	    sizeof(*shared), strerror(errno));
+      return -1;
+   }
+   for (i = 0; i < XIOBALANCE_SLOTS; ++i) {
+      shared->slot[i].target = -1;
+   }
+   xiobalance = shared;
+   xiobalance_owner = true;
+   return 0;
+#else
+   return -1;
+#endif
+}
+
+/* called by xio_fork() before fork(): reserves a slot for the child. SIGCHLD
+   stays blocked until xiobalance_forked() has recorded its pid, so the
+   child cannot be reaped before and leave its slot in use */
+void xiobalance_fork(void) {
+   sigset_t mask;
+   int i, s;
+
+   if (!xiobalance_owner)  return;
+   sigemptyset(&mask);
+   sigaddset(&mask, SIGCHLD);
+   Sigprocmask(SIG_BLOCK, &mask, &xiobalance_sigmask);
+   xiobalance_slot = -1;
+   ++xiobalance_seq;
+   for (i = 0; i < XIOBALANCE_SLOTS; ++i) {
+      s = (xiobalance_nextslot + i) % XIOBALANCE_SLOTS;
+      if (xiobalance->slot[s].pid == 0) {
+	 xiobalance->slot[s].pid = -1;
+	 xiobalance->slot[s].target = -1;
+	 xiobalance_slot = s;
+	 xiobalance_nextslot = s + 1;
+	 return;
+      }
+   }
+}
+
+/* called by xio_fork() in the parent after fork(); pid < 0 releases the
+   slot */
+void xiobalance_forked(pid_t pid) {
+   if (!xiobalance_owner)  return;
+   if (xiobalance_slot >= 0) {
+      xiobalance->slot[xiobalance_slot].pid = (pid > 0 ? pid : 0);
+      xiobalance_slot = -1;
+   }
+   Sigprocmask(SIG_SETMASK, &xiobalance_sigmask, NULL);
+}
+
+/* called in a new child process: it keeps its slot but assigns none */
+void xiobalance_inchild(void) {
+   if (!xiobalance_owner)  return;
+   xiobalance_owner = false;
+   Sigprocmask(SIG_SETMASK, &xiobalance_sigmask, NULL);
+}
+
+/* called when the child pid has been reaped: releases its slot */
+/* is async-signal-safe */
+void xiobalance_reaped(pid_t pid) {
+   int i;
+
+   if (!xiobalance_owner)  return;
+   for (i = 0; i < XIOBALANCE_SLOTS; ++i) {
+      if (xiobalance->slot[i].pid == pid) {
+	 xiobalance->slot[i].target = -1;
+	 xiobalance->slot[i].pid = 0;
+	 return;
+      }
+   }
+}
+
+/* selects one of ntargets targets that is not in the bit mask tried,
+   preferring targets that are not ejected, and records it in the slot of
+   this process, or counts it when the state is not shared; the caller
+   calls xiobalance_release() when the connection fails or is closed.
+   hash is used with policy XIOBALANCE_HASH.
+   returns the target number, or -1 when all targets have been tried */
+int xiobalance_choose(int policy, int ntargets, unsigned int tried,
+		      unsigned int hash) {
+   static pid_t seeded;
+   int active[XIOBALANCE_MAXTARGETS];
+   time_t now = time(NULL);
+   unsigned int base;
+   int i, t, best = -1, fallback = -1;
+
+   xiobalance_lock();
+   switch (policy) {
+   case XIOBALANCE_RANDOM:
+      if (seeded != Getpid()) {
+	 /* forked children must not repeat the sequence of the parent */
+	 seeded = Getpid();
+	 srandom(now ^ (seeded << 16));
+      }
+      base = random();
+      break;
+   case XIOBALANCE_HASH:
+      base = hash;
+      break;
+   default:
+      base = xiobalance_seq + xiobalance_calls;
+      break;
+   }
+   ++xiobalance_calls;
+
+   if (policy == XIOBALANCE_LEASTCONN && xiobalance == &xiobalance_local) {
+      memcpy(active, xiobalance_active, sizeof(active));
+   } else if (policy == XIOBALANCE_LEASTCONN) {
+      memset(active, 0, sizeof(active));
+      for (i = 0; i < XIOBALANCE_SLOTS; ++i) {
+	 t = xiobalance->slot[i].target;
+	 if (t >= 0 && t < ntargets && i != xiobalance_slot)  ++active[t];
+      }
+   }
+
+   for (i = 0; i < ntargets; ++i) {
+      t = (base + i) % ntargets;
+      if (tried & (1U<<t))  continue;
+      if (xiobalance->ejected[t] > now) {
+	 if (fallback < 0 ||
+	     xiobalance->ejected[t] < xiobalance->ejected[fallback]) {
+	    fallback = t;
+	 }
+	 continue;
+      }
+      if (policy != XIOBALANCE_LEASTCONN) {
+	 best = t;
+	 break;
+      }
+      if (best < 0 || active[t] < active[best])  best = t;
+   }
+   if (best < 0) {
+      /* all remaining targets are ejected, try the one that failed first */
+      best = fallback;
+   }
+   if (best >= 0 && xiobalance == &xiobalance_local) {
+      ++xiobalance_active[best];
+   } else if (best >= 0 && xiobalance_slot >= 0) {
+      xiobalance->slot[xiobalance_slot].target = best;
+   }
+   xiobalance_unlock();
+   return best;
+}
+
+/* called when the connection to a target returned by xiobalance_choose()
+   failed or has been closed */
+void xiobalance_release(int target) {
+   if (target < 0 || target >= XIOBALANCE_MAXTARGETS)  return;
+   xiobalance_lock();
+   if (xiobalance == &xiobalance_local) {
+      if (xiobalance_active[target] > 0)  --xiobalance_active[target];
+   } else if (xiobalance_slot >= 0 &&
+	      xiobalance->slot[xiobalance_slot].target == target) {
+      xiobalance->slot[xiobalance_slot].target = -1;
+   }
+   xiobalance_unlock();
+}
+
+/* marks the target as failed: other selections skip it for seconds */
+void xiobalance_eject(int target, int seconds) {
+   if (target < 0 || target >= XIOBALANCE_MAXTARGETS)  return;
+   xiobalance_lock();
+   xiobalance->ejected[target] = time(NULL) + seconds;
+   xiobalance_unlock();
+}
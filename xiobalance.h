@@ -0,0 +1,27 @@
+/* source: xiobalance.h */
+/* Copyright Gerhard Rieger */
+/* Published under the GNU General Public License V.2, see file COPYING */
+
+#ifndef __xiobalance_h_included
+#define __xiobalance_h_included 1
+
+#define XIOBALANCE_MAXTARGETS	32
+#define XIOBALANCE_SLOTS	1024	/* children tracked by the listener */
+
+/* policies of option lb */
+#define XIOBALANCE_ROUNDROBIN	0
+#define XIOBALANCE_RANDOM	1
+#define XIOBALANCE_LEASTCONN	2
+#define XIOBALANCE_HASH		3
+
+extern int xiobalance_share(void);
+extern void xiobalance_fork(void);
+extern void xiobalance_forked(pid_t pid);
+extern void xiobalance_inchild(void);
+extern void xiobalance_reaped(pid_t pid);
+extern int xiobalance_choose(int policy, int ntargets, unsigned int tried,
+			     unsigned int hash);
+extern void xiobalance_release(int target);
+extern void xiobalance_eject(int target, int seconds);
+
+#endif /* !defined(__xiobalance_h_included) */
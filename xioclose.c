@@ -10,6 +10,8 @@
 #include "xiolockfile.h"
 
 #include "xio-termios.h"
+#include "xio-socket.h"
+#include "xiobalance.h"
 
 
 /* close the xio fd; must be valid and "simple" (not dual) */
@@ -87,6 +89,24 @@ int xioclose1(struct single *pipe) {
       }
       free(pipe->unlink_close);
    }
+#if _WITH_SOCKET
+   if ((pipe->dtype & XIODATA_READMASK) == XIOREAD_RECV &&
+       pipe->para.socket.dgram != NULL) {
+      /* first packet of a recvfrom address that was not passed on */
+      free(pipe->para.socket.dgram);
+      pipe->para.socket.dgram = NULL;
+   }
+   if ((pipe->dtype & XIODATA_WRITEMASK) == XIOWRITE_SENDTO &&
+       pipe->para.socket.la_reported) {
+      /* the rest of the last interval */
+      xiosendtostats(pipe);
+   }
+   if (pipe->lbtarget >= 0) {
+      /* option lb: one connection less to this target */
+      xiobalance_release(pipe->lbtarget);
+      pipe->lbtarget = -1;
+   }
+#endif /* _WITH_SOCKET */
 
    pipe->tag = XIO_TAG_INVALID;
    return 0;	/*! */
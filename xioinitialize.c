@@ -10,11 +10,20 @@
 #include "xiolockfile.h"
 
 #include "xio-openssl.h"	/* xio_reset_fips_mode() */
+#include "xiobalance.h"
 
 static int xioinitialized;
 xiofile_t *sock[XIO_MAXSOCK];
 int (*xiohook_newchild)(void);	/* xio calls this function from a new child
 				   process */
+xiofile_t *(*xiohook_poolopen)(void);	/* option pool: xio calls this
+				   function to open the other address */
+xiofile_t *xiopooled;		/* option pool: the connection that the
+				   child process got from the parent */
+#if _WITH_SOCKET
+XIO_THREADLOCAL union sockaddr_union xioclientpeer;
+XIO_THREADLOCAL socklen_t xioclientpeerlen;
+#endif /* _WITH_SOCKET */
 int num_child = 0;
 
 /* returns 0 on success or != if an error occurred */
@@ -182,6 +191,8 @@ int xio_forked_inchild(void) {
       diedunknown[i] = 0;
    }
    num_child = 0;
+   xiochildunwatch();
+   xiobalance_inchild();
    xiodroplocks();
 #if WITH_FIPS
    if (xio_reset_fips_mode() != 0) {
@@ -214,7 +225,9 @@ pid_t xio_fork(bool subchild, int level) {
    const char *forkwaitstring;
    int forkwaitsecs = 0;
 
+   xiobalance_fork();
    if ((pid = Fork()) < 0) {
+      xiobalance_forked(pid);
       Msg1(level, "fork(): %s", strerror(errno));
       return pid;
    }
@@ -239,6 +252,8 @@ pid_t xio_fork(bool subchild, int level) {
    }
 
    num_child++;
+   xiochildadd(pid);
+   xiobalance_forked(pid);
    /* parent process */
    Notice1("forked off child process "F_pid, pid);
    /* gdb recommends to have env controlled sleep after fork */
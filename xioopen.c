@@ -345,6 +345,7 @@ static xiofile_t *xioallocfd(void) {
    fd->stream.dtype     = XIODATA_STREAM;
 #if _WITH_SOCKET
 /* fd->stream.salen     = 0; */
+   fd->stream.lbtarget  = -1;
 #endif /* _WITH_SOCKET */
    fd->stream.howtoend  = END_UNSPEC;
 /* fd->stream.name      = NULL; */
@@ -353,11 +354,13 @@ static xiofile_t *xioallocfd(void) {
    fd->stream.lineterm  = LINETERM_RAW;
 
    /*!! support n socks */
+   xiolockstate();
    if (!sock[0]) {
       sock[0] = fd;
    } else {
       sock[1] = fd;
    }
+   xiounlockstate();
    return fd;
 }
 
@@ -82,6 +82,12 @@ bool xioopts_ignoregroups;
 #  define IF_TCP(a,b) 
 #endif
 
+#if WITH_UDP
+#  define IF_UDP(a,b) {a,b},
+#else
+#  define IF_UDP(a,b) 
+#endif
+
 #if WITH_SCTP
 #  define IF_SCTP(a,b) {a,b},
 #else
@@ -168,6 +174,7 @@ const struct optname optionnames[] = {
 	IF_SOCKET ("attach-filter",	&opt_so_attach_filter)
 	IF_SOCKET ("attachfilter",	&opt_so_attach_filter)
 #endif
+	IF_IPAPP  ("attempt-delay",	&opt_attempt_delay)
 #ifdef SO_AUDIT	/* AIX 4.3.3 */
 	IF_SOCKET ("audit",	&opt_so_audit)
 #endif /* SO_AUDIT */
@@ -499,6 +506,12 @@ const struct optname optionnames[] = {
 	IF_ANY 	  ("f-setlkw",	&opt_f_setlkw_wr)
 	IF_ANY 	  ("f-setlkw-rd",	&opt_f_setlkw_rd)
 	IF_ANY 	  ("f-setlkw-wr",	&opt_f_setlkw_wr)
+#ifdef TCP_FASTOPEN	/* Linux 3.7 */
+	IF_TCP    ("fastopen",	&opt_tcp_fastopen)
+#endif
+#ifdef TCP_FASTOPEN_CONNECT	/* Linux 4.11 */
+	IF_TCP    ("fastopen-connect",	&opt_tcp_fastopen_connect)
+#endif
 	IF_EXEC   ("fdin",	&opt_fdin)
 	IF_EXEC   ("fdout",	&opt_fdout)
 #ifdef FFDLY
@@ -545,9 +558,15 @@ const struct optname optionnames[] = {
 	IF_ANY    ("gid",	&opt_group)
 	IF_NAMED  ("gid-e",	&opt_group_early)
 	IF_ANY    ("gid-l",	&opt_group_late)
+#ifdef UDP_GRO
+	IF_UDP    ("gro",	&opt_udp_gro)
+#endif
 	IF_ANY    ("group",	&opt_group)
 	IF_NAMED  ("group-early",	&opt_group_early)
 	IF_ANY    ("group-late",	&opt_group_late)
+#ifdef UDP_SEGMENT
+	IF_UDP    ("gso",	&opt_udp_segment)
+#endif
 #ifdef IP_HDRINCL
 	IF_IP     ("hdrincl",	&opt_ip_hdrincl)
 #endif
@@ -610,6 +629,9 @@ const struct optname optionnames[] = {
 #if WITH_EXT2 && defined(EXT2_IMMUTABLE_FL)
 	IF_ANY    ("immutable",	&opt_ext2_immutable)
 #endif
+#ifdef SO_REUSEPORT
+	IF_LISTEN ("incoming-cpu",	&opt_incoming_cpu)
+#endif
 #ifdef TCP_INFO	/* Linux 2.4.0 */
 	IF_TCP    ("info",	&opt_tcp_info)
 #endif
@@ -827,6 +849,8 @@ const struct optname optionnames[] = {
 #ifdef O_LARGEFILE
 	IF_OPEN   ("largefile",	&opt_o_largefile)
 #endif
+	IF_IPAPP  ("lb",	&opt_lb)
+	IF_IPAPP  ("lb-eject",	&opt_lb_eject)
 #if WITH_LIBWRAP
 	IF_IPAPP  ("libwrap",		&opt_tcpwrappers)
 #endif
@@ -891,6 +915,7 @@ const struct optname optionnames[] = {
 #ifdef IP_MTU_DISCOVER
 	IF_IP     ("mtudiscover",	&opt_ip_mtu_discover)
 #endif
+	IF_LISTEN ("multi",	&opt_multi)
 	IF_TUN    ("multicast",	&opt_iff_multicast)
 	IF_IP     ("multicast-if",	&opt_ip_multicast_if)
 	IF_IP     ("multicast-loop",	&opt_ip_multicast_loop)
@@ -953,6 +978,9 @@ const struct optname optionnames[] = {
 	IF_SOCKET ("noreuseaddr",	&opt_so_noreuseaddr)
 #endif /* SO_NOREUSEADDR */
 	IF_TUN    ("notrailers",	&opt_iff_notrailers)
+#ifdef TCP_NOTSENT_LOWAT	/* Linux 3.12 */
+	IF_TCP    ("notsent-lowat",	&opt_tcp_notsent_lowat)
+#endif
 #ifdef O_NSHARE
 	IF_OPEN   ("nshare",	&opt_o_nshare)
 #endif
@@ -1145,11 +1173,13 @@ const struct optname optionnames[] = {
 	IF_IP     ("pktopts",	&opt_ip_pktoptions)
 #endif
 	IF_TUN    ("pointopoint",	&opt_iff_pointopoint)
+	IF_LISTEN ("pool",	&opt_pool)
 #ifdef I_POP
 	IF_ANY    ("pop-all",	&opt_streams_i_pop_all)
 #endif
 	/*IF_IPAPP("port",	&opt_port)*/
 	IF_TUN    ("portsel",	&opt_iff_portsel)
+	IF_LISTEN ("prefork",	&opt_prefork)
 #if HAVE_RESOLV_H
 	IF_IP     ("primary",	&opt_res_primary)
 #endif /* HAVE_RESOLV_H */
@@ -1352,6 +1382,9 @@ const struct optname optionnames[] = {
 	IF_SOCKET ("setsockopt-string",	&opt_setsockopt_string)
 	IF_ANY    ("setuid",	&opt_setuid)
 	IF_ANY    ("setuid-early",	&opt_setuid_early)
+#ifdef SO_REUSEPORT
+	IF_LISTEN ("shards",	&opt_shards)
+#endif
 	IF_ANY    ("shut-close",	&opt_shut_close)
 	IF_ANY    ("shut-down",	&opt_shut_down)
 	IF_ANY    ("shut-none",	&opt_shut_none)
@@ -1536,6 +1569,7 @@ const struct optname optionnames[] = {
 #  endif
 #endif
 	IF_TERMIOS("tandem",	&opt_ixoff)
+	IF_IPAPP  ("target",	&opt_target)
 #ifdef TCP_ABORT_THRESHOLD  /* HP_UX */
 	IF_TCP    ("tcp-abort-threshold",	&opt_tcp_abort_threshold)
 #endif
@@ -1548,6 +1582,12 @@ const struct optname optionnames[] = {
 #ifdef TCP_DEFER_ACCEPT	/* Linux 2.4.0 */
 	IF_TCP    ("tcp-defer-accept",	&opt_tcp_defer_accept)
 #endif
+#ifdef TCP_FASTOPEN	/* Linux 3.7 */
+	IF_TCP    ("tcp-fastopen",	&opt_tcp_fastopen)
+#endif
+#ifdef TCP_FASTOPEN_CONNECT	/* Linux 4.11 */
+	IF_TCP    ("tcp-fastopen-connect",	&opt_tcp_fastopen_connect)
+#endif
 #ifdef TCP_INFO	/* Linux 2.4.0 */
 	IF_TCP    ("tcp-info",	&opt_tcp_info)
 #endif
@@ -1582,6 +1622,9 @@ const struct optname optionnames[] = {
 #ifdef TCP_NOPUSH
 	IF_TCP    ("tcp-nopush",	&opt_tcp_nopush)
 #endif
+#ifdef TCP_NOTSENT_LOWAT	/* Linux 3.12 */
+	IF_TCP    ("tcp-notsent-lowat",	&opt_tcp_notsent_lowat)
+#endif
 #ifdef TCP_PAWS	/* OSF1 */
 	IF_TCP    ("tcp-paws",		&opt_tcp_paws)
 #endif
@@ -1630,6 +1673,7 @@ const struct optname optionnames[] = {
 #ifdef O_TEXT
 	IF_ANY    ("text",	&opt_o_text)
 #endif
+	IF_LISTEN ("threads",	&opt_threads)
 	IF_UNIX   ("tightsocklen",	&xioopt_unix_tightsocklen)
 	IF_TERMIOS("time",	&opt_vtime)
 #ifdef SO_TIMESTAMP
@@ -1656,6 +1700,12 @@ const struct optname optionnames[] = {
 	IF_TUN    ("tun-no-pi",	&opt_iff_no_pi)
 	IF_TUN    ("tun-type",	&opt_tun_type)
 	IF_SOCKET ("type",	&opt_so_type)
+#ifdef UDP_GRO
+	IF_UDP    ("udp-gro",	&opt_udp_gro)
+#endif
+#ifdef UDP_SEGMENT
+	IF_UDP    ("udp-segment",	&opt_udp_segment)
+#endif
 	IF_ANY    ("uid",	&opt_user)
 	IF_NAMED  ("uid-e",	&opt_user_early)
 	IF_ANY    ("uid-l",	&opt_user_late)
@@ -3995,6 +4045,33 @@ int applyopts_single(struct single *xfd, struct opt *opts, enum e_phase phase) {
 	 }
 	 xfd->havelock = true;
 	 break;
+#if WITH_UDP && defined(UDP_GRO)
+      case OPT_UDP_GRO:
+	 if (opt->value.u_bool) {
+	    int one = 1;
+	    if (Setsockopt(xfd->fd, SOL_UDP, UDP_GRO, &one, sizeof(one)) < 0) {
+	       Error3("setsockopt(%d, SOL_UDP, UDP_GRO, {1}, "F_Zu"): %s",
+		      xfd->fd, sizeof(one), strerror(errno));
+	       opt->desc = ODESC_ERROR; ++opt; continue;
+	    }
+	 }
+	 xfd->gro = opt->value.u_bool;
+	 break;
+#endif /* WITH_UDP && defined(UDP_GRO) */
+#if WITH_UDP && defined(UDP_SEGMENT)
+      case OPT_UDP_SEGMENT:
+	 /* the size applies to writes from streams; relayed coalesced
+	    packets are sent with their own segment size */
+	 if (Setsockopt(xfd->fd, SOL_UDP, UDP_SEGMENT, &opt->value.u_int,
+			sizeof(opt->value.u_int)) < 0) {
+	    Error4("setsockopt(%d, SOL_UDP, UDP_SEGMENT, {%d}, "F_Zu"): %s",
+		   xfd->fd, opt->value.u_int, sizeof(opt->value.u_int),
+		   strerror(errno));
+	    opt->desc = ODESC_ERROR; ++opt; continue;
+	 }
+	 xfd->gso = 1;
+	 break;
+#endif /* WITH_UDP && defined(UDP_SEGMENT) */
 	 
       default:
 	 /* just store the value in the correct component of struct single */
@@ -182,6 +182,7 @@ enum e_func {
 /* optcode's */
 enum e_optcode {
    OPT_ADDRESS_FAMILY = 1,
+   OPT_ATTEMPT_DELAY,	/* Happy Eyeballs of connect addresses */
    /* these are not alphabetically, I know... */
    OPT_B0,		/* termios.c_cflag */
    OPT_B50,		/* termios.c_cflag */
@@ -346,6 +347,7 @@ enum e_optcode {
    OPT_IGNOREEOF,	/* customized */
    OPT_IGNPAR,		/* termios.c_iflag */
    OPT_IMAXBEL,		/* termios.c_iflag */
+   OPT_INCOMING_CPU,	/* with option shards */
    OPT_INLCR,		/* termios.c_iflag */
    OPT_INPCK,		/* termios.c_iflag */
    OPT_INTERVALL,
@@ -430,9 +432,12 @@ enum e_optcode {
    OPT_IXANY,		/* termios.c_iflag */
    OPT_IXOFF,		/* termios.c_iflag */
    OPT_IXON,		/* termios.c_iflag */
+   OPT_LB,		/* load balancing over the targets */
+   OPT_LB_EJECT,
    OPT_LOCKFILE,
    OPT_LOWPORT,
    OPT_MAX_CHILDREN,
+   OPT_MULTI,
 #ifdef NLDLY
 #  ifdef NL0
    OPT_NL0,		/* termios.c_oflag */
@@ -552,7 +557,9 @@ enum e_optcode {
    OPT_PERM_EARLY,
    OPT_PERM_LATE,
    OPT_PIPES,
+   OPT_POOL,
    /*OPT_PORT,*/
+   OPT_PREFORK,
    OPT_PROMPT,		/* readline */
    OPT_PROTOCOL,	/* 6=TCP, 17=UDP */
    OPT_PROTOCOL_FAMILY,	/* 1=PF_UNIX, 2=PF_INET, 10=PF_INET6 */
@@ -597,6 +604,7 @@ enum e_optcode {
    OPT_SETSOCKOPT_STRING,
    OPT_SETUID,
    OPT_SETUID_EARLY,
+   OPT_SHARDS,
    OPT_SHUT_CLOSE,
    OPT_SHUT_DOWN,
    OPT_SHUT_NONE,
@@ -727,6 +735,7 @@ enum e_optcode {
 #  endif
    OPT_TABDLY,		/* termios.c_oflag */
 #endif
+   OPT_TARGET,		/* further host:port of connect addresses */
    OPT_TCPWRAPPERS,	/* libwrap */
    OPT_TCPWRAP_ETC,	/* libwrap */
    OPT_TCPWRAP_HOSTS_ALLOW_TABLE,	/* libwrap */
@@ -739,6 +748,12 @@ enum e_optcode {
 #ifdef TCP_DEFER_ACCEPT
    OPT_TCP_DEFER_ACCEPT,	/* Linux 2.4.0 */
 #endif
+#ifdef TCP_FASTOPEN
+   OPT_TCP_FASTOPEN,	/* Linux 3.7 */
+#endif
+#ifdef TCP_FASTOPEN_CONNECT
+   OPT_TCP_FASTOPEN_CONNECT,	/* Linux 4.11 */
+#endif
 #ifdef TCP_INFO
    OPT_TCP_INFO,	/* Linux 2.4.0 */
 #endif
@@ -765,6 +780,9 @@ enum e_optcode {
 #endif
    OPT_TCP_NOOPT,	/* FreeBSD */
    OPT_TCP_NOPUSH,	/* FreeBSD */
+#ifdef TCP_NOTSENT_LOWAT
+   OPT_TCP_NOTSENT_LOWAT,	/* Linux 3.12 */
+#endif
    OPT_TCP_PAWS,	/* OSF1 */
 #ifdef TCP_QUICKACK
    OPT_TCP_QUICKACK,	/* Linux 2.4 */
@@ -787,11 +805,18 @@ enum e_optcode {
 #endif
    OPT_TERMIOS_CFMAKERAW,	/* termios.cfmakeraw() */
    OPT_TERMIOS_RAWER,
+   OPT_THREADS,		/* with option multi */
    OPT_TIOCSCTTY,
    OPT_TOSTOP,		/* termios.c_lflag */
    OPT_TUN_DEVICE,	/* tun: /dev/net/tun ... */
    OPT_TUN_NAME,	/* tun: tun0 */
    OPT_TUN_TYPE,	/* tun: tun|tap */
+#ifdef UDP_GRO
+   OPT_UDP_GRO,		/* Linux 5.0 */
+#endif
+#ifdef UDP_SEGMENT
+   OPT_UDP_SEGMENT,	/* Linux 4.18 */
+#endif
    OPT_UMASK,
    OPT_UNIX_TIGHTSOCKLEN,	/* UNIX domain sockets */
    OPT_UNLINK,
@@ -0,0 +1,288 @@
+/* source: xiopcapng.c */
+/* Copyright Gerhard Rieger */
+/* Published under the GNU General Public License V.2, see file COPYING */
+
+/* this file contains the pcapng capture file writer of socat's option -cf */
+
+#include "xiosysincludes.h"
+
+#include "compat.h"
+#include "mytypes.h"
+#include "error.h"
+#include "utils.h"
+#include "sysutils.h"
+
+#include "sycls.h"
+
+#include "xio.h"
+#include "xiopcapng.h"
+
+
+/* pcapng block types, options, and link type of the captured data */
+#define PCAPNG_SHB		0x0a0d0d0a	/* section header block */
+#define PCAPNG_IDB		0x00000001	/* interface description block */
+#define PCAPNG_EPB		0x00000006	/* enhanced packet block */
+#define PCAPNG_BYTEORDER	0x1a2b3c4d
+#define PCAPNG_OPT_ENDOFOPT	0
+#define PCAPNG_OPT_USERAPPL	4	/* SHB: application */
+#define PCAPNG_OPT_IFNAME	2	/* IDB: name */
+#define PCAPNG_OPT_IFDESCR	3	/* IDB: description */
+#define PCAPNG_OPT_EPBFLAGS	2	/* EPB: direction */
+#define PCAPNG_LINKTYPE_USER0	147	/* data without protocol headers */
+
+/* bytes of an EPB besides the data: header, epb_flags, end of options,
+   trailing length */
+#define PCAPNG_EPBHEAD	28
+#define PCAPNG_EPBTAIL	16
+
+#define PCAPNG_PAD(len)	(((len)+3)&~(size_t)3)
+
+static void pcapng_put16(unsigned char **p, uint16_t v) {
+   memcpy(*p, &v, 2);  *p += 2;
+}
+
+static void pcapng_put32(unsigned char **p, uint32_t v) {
+   memcpy(*p, &v, 4);  *p += 4;
+}
+
+/* appends a string option to the block at *p */
+static void pcapng_putopt(unsigned char **p, uint16_t code, const char *s) {
+   size_t len = strlen(s);
+   pcapng_put16(p, code);
+   pcapng_put16(p, len);
+   memset(*p, 0, PCAPNG_PAD(len));
+   memcpy(*p, s, len);
+   *p += PCAPNG_PAD(len);
+}
+
+/* opens (creates, appends to) the capture file
+   returns 0 on success or -1 if an error occurred */
+static int pcapng_openfile(struct xiopcapng *pc) {
+   if ((pc->fd = Open(pc->path, O_WRONLY|O_CREAT|O_APPEND, 0600)) < 0) {
+      Error2("open(\"%s\", O_WRONLY|O_CREAT|O_APPEND, 0600): %s",
+	     pc->path, strerror(errno));
+      return -1;
+   }
+   Fcntl_l(pc->fd, F_SETFD, FD_CLOEXEC);
+   return 0;
+}
+
+/* opens the capture file path and prepares the section header. With rotate,
+   the file is renamed to path.<n> when it would grow beyond rotate bytes.
+   returns 0 on success or -1 if an error occurred */
+int xiopcapng_open(struct xiopcapng *pc, const char *path, size_t rotate) {
+   unsigned char *p;
+
+   memset(pc, 0, sizeof(*pc));
+   pc->fd = -1;
+   pc->path = path;
+   pc->rotate = rotate;
+   pc->suffix = 1;
+   if ((pc->buff = Malloc(XIOPCAPNG_BUFSIZ)) == NULL) {
+      return -1;
+   }
+   if (pcapng_openfile(pc) < 0) {
+      free(pc->buff);  pc->buff = NULL;
+      return -1;
+   }
+   pc->flushed = time(NULL);
+
+   /* section header block; the total length is filled in below */
+   p = pc->head;
+   pcapng_put32(&p, PCAPNG_SHB);
+   pcapng_put32(&p, 0);
+   pcapng_put32(&p, PCAPNG_BYTEORDER);
+   pcapng_put16(&p, 1);			/* major version */
+   pcapng_put16(&p, 0);			/* minor version */
+   pcapng_put32(&p, 0xffffffff);	/* section length unknown */
+   pcapng_put32(&p, 0xffffffff);
+   pcapng_putopt(&p, PCAPNG_OPT_USERAPPL, "socat");
+   pcapng_put32(&p, PCAPNG_OPT_ENDOFOPT);
+   pcapng_put32(&p, p - pc->head + 4);
+   memcpy(pc->head+4, p-4, 4);
+   pc->headlen = p - pc->head;
+   Info2("capturing to pcapng file \"%s\" (fd %d)", path, pc->fd);
+   return 0;
+}
+
+/* adds an interface description to the section header; the blocks of the
+   interface refer to it with the returned id. name and descr are truncated
+   to 128 bytes.
+   returns the interface id, or -1 if an error occurred */
+int xiopcapng_interface(struct xiopcapng *pc, const char *name,
+			const char *descr) {
+   char nbuff[129], dbuff[129];
+   unsigned char *p = pc->head + pc->headlen, *start = p;
+
+   if (pc->nifs >= XIOPCAPNG_MAXIFS) {
+      Error1("pcapng: more than %d interfaces", XIOPCAPNG_MAXIFS);
+      return -1;
+   }
+   strncpy(nbuff, name, sizeof(nbuff)-1);   nbuff[sizeof(nbuff)-1] = '\0';
+   strncpy(dbuff, descr, sizeof(dbuff)-1);  dbuff[sizeof(dbuff)-1] = '\0';
+   pcapng_put32(&p, PCAPNG_IDB);
+   pcapng_put32(&p, 0);
+   pcapng_put16(&p, PCAPNG_LINKTYPE_USER0);
+   pcapng_put16(&p, 0);			/* reserved */
+   pcapng_put32(&p, 0);			/* no snap length */
+   pcapng_putopt(&p, PCAPNG_OPT_IFNAME, nbuff);
+   pcapng_putopt(&p, PCAPNG_OPT_IFDESCR, dbuff);
+   pcapng_put32(&p, PCAPNG_OPT_ENDOFOPT);
+   pcapng_put32(&p, p - start + 4);
+   memcpy(start+4, p-4, 4);
+   pc->headlen = p - pc->head;
+   return pc->nifs++;
+}
+
+/* renames the capture file to path.<n> and opens a new one; when another
+   process has already renamed it, only opens the new one.
+   returns 0 on success or -1 if an error occurred */
+static int pcapng_rotate(struct xiopcapng *pc, const struct stat *fst) {
+   struct stat pst;
+   char *rotname;
+   size_t rotlen = strlen(pc->path) + 3*sizeof(unsigned int) + 2;
+
+   if (Stat(pc->path, &pst) == 0 &&
+       pst.st_dev == fst->st_dev && pst.st_ino == fst->st_ino) {
+      if ((rotname = Malloc(rotlen)) == NULL) {
+	 return -1;
+      }
+      do {
+	 snprintf(rotname, rotlen, "%s.%u", pc->path, pc->suffix++);
+      } while (Stat(rotname, &pst) == 0);
+      if (Rename(pc->path, rotname) < 0) {
+	 Error3("rename(\"%s\", \"%s\"): %s",
+		pc->path, rotname, strerror(errno));
+	 free(rotname);
+	 return -1;
+      }
+      Info2("capture file \"%s\" rotated to \"%s\"", pc->path, rotname);
+      free(rotname);
+   }
+   Close(pc->fd);
+   return pcapng_openfile(pc);
+}
+
+/* writes the section header, the collected blocks, and optionally a block
+   that did not fit into the buffer (iov[2..]) with one writev() call.
+   returns 0 on success or -1 if an error occurred */
+static int pcapng_write(struct xiopcapng *pc, struct iovec *iov, int iovcnt) {
+   size_t len = 0;
+   ssize_t writt;
+   int i;
+
+   iov[0].iov_base = pc->head;  iov[0].iov_len = pc->headlen;
+   iov[1].iov_base = pc->buff;  iov[1].iov_len = pc->buflen;
+   for (i = 0; i < iovcnt; ++i) {
+      len += iov[i].iov_len;
+   }
+   if (pc->rotate) {
+      struct stat fst, pst;
+      if (Fstat(pc->fd, &fst) < 0) {
+	 Error2("fstat(%d, ...): %s", pc->fd, strerror(errno));
+      } else if ((fst.st_size > 0 && fst.st_size + len > pc->rotate) ||
+		 Stat(pc->path, &pst) < 0 ||
+		 pst.st_dev != fst.st_dev || pst.st_ino != fst.st_ino) {
+	 /* file is full, or was rotated by another process */
+	 if (pcapng_rotate(pc, &fst) < 0) {
+	    pc->buflen = 0;
+	    return -1;
+	 }
+      }
+   }
+   do {
+      writt = Writev(pc->fd, iov, iovcnt);
+   } while (writt < 0 && errno == EINTR);
+   pc->buflen = 0;
+   pc->flushed = time(NULL);
+   if (writt < 0) {
+      Error4("writev(%d, %p, %d): %s", pc->fd, iov, iovcnt, strerror(errno));
+      return -1;
+   }
+   if ((size_t)writt < len) {
+      Warn3("writev(%d, ...): only wrote "F_Zd" of "F_Zu" bytes",
+	    pc->fd, writt, len);
+   }
+   return 0;
+}
+
+/* adds a block of data, transferred now, to the capture.
+   returns 0 on success or -1 if an error occurred */
+int xiopcapng_block(struct xiopcapng *pc, unsigned int ifid, uint32_t flags,
+		    const void *data, size_t len) {
+   unsigned char epbhead[PCAPNG_EPBHEAD], epbtail[PCAPNG_EPBTAIL], *p;
+   size_t total = PCAPNG_EPBHEAD + PCAPNG_PAD(len) + PCAPNG_EPBTAIL;
+   struct timeval now;
+   unsigned long long ts;
+
+   if (pc->fd < 0) {
+      return -1;
+   }
+   gettimeofday(&now, NULL);
+   ts = (unsigned long long)now.tv_sec*1000000 + now.tv_usec;
+
+   p = epbhead;
+   pcapng_put32(&p, PCAPNG_EPB);
+   pcapng_put32(&p, total);
+   pcapng_put32(&p, ifid);
+   pcapng_put32(&p, ts >> 32);
+   pcapng_put32(&p, ts & 0xffffffff);
+   pcapng_put32(&p, len);		/* captured */
+   pcapng_put32(&p, len);		/* original */
+   p = epbtail;
+   pcapng_put16(&p, PCAPNG_OPT_EPBFLAGS);
+   pcapng_put16(&p, 4);
+   pcapng_put32(&p, flags);
+   pcapng_put32(&p, PCAPNG_OPT_ENDOFOPT);
+   pcapng_put32(&p, total);
+
+   if (pc->buflen + total > XIOPCAPNG_BUFSIZ) {
+      if (pc->buflen > 0 && xiopcapng_flush(pc) < 0) {
+	 return -1;
+      }
+      if (total > XIOPCAPNG_BUFSIZ) {
+	 /* larger than the buffer: write it directly */
+	 static const unsigned char zeros[3];
+	 struct iovec iov[6];
+	 iov[2].iov_base = epbhead;        iov[2].iov_len = PCAPNG_EPBHEAD;
+	 iov[3].iov_base = (void *)data;   iov[3].iov_len = len;
+	 iov[4].iov_base = (void *)zeros;  iov[4].iov_len = PCAPNG_PAD(len)-len;
+	 iov[5].iov_base = epbtail;        iov[5].iov_len = PCAPNG_EPBTAIL;
+	 return pcapng_write(pc, iov, 6);
+      }
+   }
+   p = pc->buff + pc->buflen;
+   memcpy(p, epbhead, PCAPNG_EPBHEAD);  p += PCAPNG_EPBHEAD;
+   memcpy(p, data, len);
+   memset(p+len, 0, PCAPNG_PAD(len)-len);  p += PCAPNG_PAD(len);
+   memcpy(p, epbtail, PCAPNG_EPBTAIL);
+   pc->buflen += total;
+   /* do not keep the data longer than a second */
+   if (now.tv_sec != pc->flushed) {
+      return xiopcapng_flush(pc);
+   }
+   return 0;
+}
+
+/* writes the collected blocks to the capture file.
+   returns 0 on success or -1 if an error occurred */
+int xiopcapng_flush(struct xiopcapng *pc) {
+   struct iovec iov[2];
+
+   if (pc->fd < 0 || pc->buflen == 0) {
+      return 0;
+   }
+   return pcapng_write(pc, iov, 2);
+}
+
+/* writes the collected blocks and closes the capture file */
+void xiopcapng_close(struct xiopcapng *pc) {
+   if (pc->fd < 0) {
+      return;
+   }
+   xiopcapng_flush(pc);
+   Close(pc->fd);
+   pc->fd = -1;
+   free(pc->buff);
+   pc->buff = NULL;
+}
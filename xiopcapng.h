@@ -0,0 +1,42 @@
+/* source: xiopcapng.h */
+/* Copyright Gerhard Rieger */
+/* Published under the GNU General Public License V.2, see file COPYING */
+
+#ifndef __xiopcapng_h_included
+#define __xiopcapng_h_included 1
+
+#define XIOPCAPNG_BUFSIZ  262144	/* blocks are collected up to this size */
+#define XIOPCAPNG_HEADSIZ 1024		/* section and interface headers */
+#define XIOPCAPNG_MAXIFS  2
+
+/* epb_flags direction */
+#define XIOPCAPNG_INBOUND  1
+#define XIOPCAPNG_OUTBOUND 2
+
+/* a pcapng capture file. The blocks are collected in buff and written with
+   one writev() call, preceded by a section header and the interface
+   descriptions, so each write is a complete section. This way several
+   processes (e.g. with option fork) can append to the same file. */
+struct xiopcapng {
+   int fd;			/* -1: not open */
+   const char *path;
+   size_t rotate;		/* start a new file at this size; 0: never */
+   unsigned char head[XIOPCAPNG_HEADSIZ];	/* SHB and IDBs */
+   size_t headlen;
+   unsigned int nifs;		/* number of IDBs in head */
+   unsigned char *buff;		/* Malloc()'ed, XIOPCAPNG_BUFSIZ bytes */
+   size_t buflen;		/* EPBs in buff */
+   time_t flushed;		/* time of last write */
+   unsigned int suffix;		/* next number tried for a rotated file */
+} ;
+
+extern int xiopcapng_open(struct xiopcapng *pc, const char *path,
+			  size_t rotate);
+extern int xiopcapng_interface(struct xiopcapng *pc, const char *name,
+			       const char *descr);
+extern int xiopcapng_block(struct xiopcapng *pc, unsigned int ifid,
+			   uint32_t flags, const void *data, size_t len);
+extern int xiopcapng_flush(struct xiopcapng *pc);
+extern void xiopcapng_close(struct xiopcapng *pc);
+
+#endif /* !defined(__xiopcapng_h_included) */
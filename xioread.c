@@ -50,8 +50,29 @@ ssize_t xioread(xiofile_t *file, void *buff, size_t bufsiz) {
       }
    }
 
+#if _WITH_SOCKET
+   pipe->segsize = 0;
+#endif
    switch (pipe->dtype & XIODATA_READMASK) {
    case XIOREAD_STREAM:
+#if _WITH_SOCKET
+      if (pipe->gro) {
+	 /* connected UDP socket with option udp-gro: the packet may consist
+	    of several segments */
+	 struct msghdr msgh = {0};
+	 char ctrlbuff[64];
+
+#if HAVE_STRUCT_MSGHDR_MSGCONTROL
+	 msgh.msg_control = ctrlbuff;
+#endif
+#if HAVE_STRUCT_MSGHDR_MSGCONTROLLEN
+	 msgh.msg_controllen = sizeof(ctrlbuff);
+#endif
+	 if ((bytes = xiorecvpacket(pipe->fd, buff, bufsiz, &msgh)) >= 0) {
+	    pipe->segsize = xiogrosegsize(&msgh);
+	 }
+      } else
+#endif /* _WITH_SOCKET */
       do {
 	 bytes = Read(pipe->fd, buff, bufsiz);
       } while (bytes < 0 && errno == EINTR);
@@ -119,30 +140,32 @@ ssize_t xioread(xiofile_t *file, void *buff, size_t bufsiz) {
       char infobuff[256];
       char ctrlbuff[1024];	/* ancillary messages */
 
-      msgh.msg_name = &from;
-      msgh.msg_namelen = fromlen;
+      if (pipe->para.socket.dgram != NULL) {
+	 /* the first packet, read by _xioopen_dgram_recvfrom() */
+	 bytes = Min(pipe->para.socket.dgramlen, bufsiz);
+	 memcpy(buff, pipe->para.socket.dgram, bytes);
+	 from = pipe->peersa;  fromlen = pipe->salen;
+	 free(pipe->para.socket.dgram);
+	 pipe->para.socket.dgram = NULL;
+      } else {
+	 msgh.msg_name = &from;
+	 msgh.msg_namelen = fromlen;
 #if HAVE_STRUCT_MSGHDR_MSGCONTROL
-      msgh.msg_control = ctrlbuff;
+	 msgh.msg_control = ctrlbuff;
 #endif
 #if HAVE_STRUCT_MSGHDR_MSGCONTROLLEN
-      msgh.msg_controllen = sizeof(ctrlbuff);
+	 msgh.msg_controllen = sizeof(ctrlbuff);
 #endif
-      if (xiogetpacketsrc(pipe->fd, &msgh) < 0) {
-	 return -1;
-      }
-      do {
-	 bytes =
-	    Recvfrom(pipe->fd, buff, bufsiz, 0, &from.soa, &fromlen);
-      } while (bytes < 0 && errno == EINTR);
-      if (bytes < 0) {
-	 char infobuff[256];
-	 _errno = errno;
-	 Error6("recvfrom(%d, %p, "F_Zu", 0, %s, {"F_socklen"}): %s",
-		pipe->fd, buff, bufsiz,
-		sockaddr_info(&from.soa, fromlen, infobuff, sizeof(infobuff)),
-		fromlen, strerror(errno));
-	 errno = _errno;
-	 return -1;
+	 if ((bytes = xiorecvpacket(pipe->fd, buff, bufsiz, &msgh)) < 0) {
+	    _errno = errno;
+	    Error4("recvmsg(%d, %p{..., "F_Zu"}, 0): %s",
+		   pipe->fd, &msgh, bufsiz, strerror(_errno));
+	    errno = _errno;
+	    return -1;
+	 }
+	 fromlen = msgh.msg_namelen;
+	 xiodopacketinfo(&msgh, true, false);
+	 if (pipe->gro)  pipe->segsize = xiogrosegsize(&msgh);
       }
       /* on packet type we also receive outgoing packets, this is not desired
        */
@@ -310,42 +333,41 @@ ssize_t xioread(xiofile_t *file, void *buff, size_t bufsiz) {
       struct msghdr msgh = {0};
       char ctrlbuff[1024];	/* ancillary messages */
 
-      socket_init(pipe->para.socket.la.soa.sa_family, &from);
-      /* get source address */
-      msgh.msg_name = &from;
-      msgh.msg_namelen = fromlen;
+      if (pipe->para.socket.dgram != NULL) {
+	 /* the first packet, read and permitted by _xioopen_dgram_recvfrom() */
+	 bytes = Min(pipe->para.socket.dgramlen, bufsiz);
+	 memcpy(buff, pipe->para.socket.dgram, bytes);
+	 from = pipe->peersa;  fromlen = pipe->salen;
+	 free(pipe->para.socket.dgram);
+	 pipe->para.socket.dgram = NULL;
+      } else {
+	 socket_init(pipe->para.socket.la.soa.sa_family, &from);
+	 /* get data, source address, and ancillary messages */
+	 msgh.msg_name = &from;
+	 msgh.msg_namelen = fromlen;
 #if HAVE_STRUCT_MSGHDR_MSGCONTROL
-      msgh.msg_control = ctrlbuff;
+	 msgh.msg_control = ctrlbuff;
 #endif
 #if HAVE_STRUCT_MSGHDR_MSGCONTROLLEN
-      msgh.msg_controllen = sizeof(ctrlbuff);
+	 msgh.msg_controllen = sizeof(ctrlbuff);
 #endif
-      if (xiogetpacketsrc(pipe->fd, &msgh) < 0) {
-	 return -1;
-      }
-      xiodopacketinfo(&msgh, true, false);
-      if (xiocheckpeer(pipe, &from, &pipe->para.socket.la) < 0) {
-	 Recvfrom(pipe->fd, buff, bufsiz, 0, &from.soa, &fromlen);  /* drop */
-	 errno = EAGAIN;  return -1;
+	 if ((bytes = xiorecvpacket(pipe->fd, buff, bufsiz, &msgh)) < 0) {
+	    _errno = errno;
+	    Error4("recvmsg(%d, %p{..., "F_Zu"}, 0): %s",
+		   pipe->fd, &msgh, bufsiz, strerror(_errno));
+	    errno = _errno;
+	    return -1;
+	 }
+	 fromlen = msgh.msg_namelen;
+	 xiodopacketinfo(&msgh, true, false);
+	 if (pipe->gro)  pipe->segsize = xiogrosegsize(&msgh);
+	 if (xiocheckpeer(pipe, &from, &pipe->para.socket.la) < 0) {
+	    errno = EAGAIN;  return -1;	/* drop */
+	 }
       }
       Info1("permitting packet from %s",
 	    sockaddr_info((struct sockaddr *)&from, fromlen,
 			  infobuff, sizeof(infobuff)));
-
-      do {
-	 bytes =
-	    Recvfrom(pipe->fd, buff, bufsiz, 0, &from.soa, &fromlen);
-      } while (bytes < 0 && errno == EINTR);
-      if (bytes < 0) {
-	 char infobuff[256];
-	 _errno = errno;
-	 Error6("recvfrom(%d, %p, "F_Zu", 0, %s, "F_socklen"): %s",
-		pipe->fd, buff, bufsiz,
-		sockaddr_info(&from.soa, fromlen, infobuff, sizeof(infobuff)),
-		fromlen, strerror(errno));
-	 errno = _errno;
-	 return -1;
-      }
       Notice2("received packet with "F_Zu" bytes from %s",
 	      bytes,
 	      sockaddr_info(&from.soa, fromlen, infobuff, sizeof(infobuff)));
@@ -402,7 +424,9 @@ ssize_t xioread(xiofile_t *file, void *buff, size_t bufsiz) {
 
 /* this function is intended only for some special address types where the
    select()/poll() calls cannot strictly determine if (more) read data is
-   available. currently this is for the OpenSSL based addresses.
+   available. currently this is for the OpenSSL based addresses, and for
+   recvfrom addresses that read their first packet while opening (then 1 is
+   returned, the packet may be empty).
 */
 ssize_t xiopending(xiofile_t *file) {
    struct single *pipe;
@@ -429,6 +453,10 @@ ssize_t xiopending(xiofile_t *file) {
    case XIOREAD_OPENSSL:
       return xiopending_openssl(pipe);
 #endif /* WITH_OPENSSL */
+#if _WITH_SOCKET
+   case XIOREAD_RECV:
+      return pipe->para.socket.dgram != NULL;
+#endif /* _WITH_SOCKET */
    default:
       return 0;
    }
@@ -7,12 +7,23 @@
 
 #include "xiosysincludes.h"
 #include "xioopen.h"
+#include "xiobalance.h"
 
 
 /*!! with socat, at most 4 exec children exist */
 pid_t diedunknown[NUMUNKNOWN];	/* children that died before they were registered */
 size_t nextunknown;
 
+#if HAVE_SIGNALFD
+/* synchronous reaping (xiochildwatch()): SIGCHLD is blocked and read from
+   xiochildfd, and the forked children are kept in a hash table with linear
+   probing, so num_child only counts them */
+static int xiochildfd = -1;
+static pid_t *xiochildren;	/* 0: free slot */
+static size_t xiochildsize;	/* number of slots, a power of 2 */
+static size_t xiochildcount;	/* used slots */
+#endif /* HAVE_SIGNALFD */
+
 
 /* register for a xio filedescriptor a callback (handler).
    when a SIGCHLD occurs, the signal handler will ??? */
@@ -61,6 +72,29 @@ static int xio_checkchild(xiofile_t *socket, int socknum, pid_t deadchild) {
    return 0;
 }
 
+/* logs how child pid terminated */
+/* is async-signal-safe */
+static void xiochildstatus(pid_t pid, int status) {
+   xiobalance_reaped(pid);
+   if (WIFEXITED(status)) {
+      if (WEXITSTATUS(status) == 0) {
+	 Info2("waitpid(): child %d exited with status %d",
+	       pid, WEXITSTATUS(status));
+      } else {
+	 Warn2("waitpid(): child %d exited with status %d",
+	       pid, WEXITSTATUS(status));
+      }
+   } else if (WIFSIGNALED(status)) {
+      Info2("waitpid(): child %d exited on signal %d",
+	    pid, WTERMSIG(status));
+   } else if (WIFSTOPPED(status)) {
+      Info2("waitpid(): child %d stopped on signal %d",
+	    pid, WSTOPSIG(status));
+   } else {
+      Warn1("waitpid(): cannot determine status of child %d", pid);
+   }
+}
+
 /* this is the "physical" signal handler for SIGCHLD */
 /* the current socat/xio implementation knows two kinds of children:
    exec/system addresses perform a fork: these children are registered and
@@ -125,23 +159,7 @@ void childdied(int signum) {
 		nextunknown/*sic, for compatibility*/);
       }
 
-   if (WIFEXITED(status)) {
-      if (WEXITSTATUS(status) == 0) {
-	 Info2("waitpid(): child %d exited with status %d",
-	       pid, WEXITSTATUS(status));
-      } else {
-	 Warn2("waitpid(): child %d exited with status %d",
-	       pid, WEXITSTATUS(status));
-      }
-   } else if (WIFSIGNALED(status)) {
-      Info2("waitpid(): child %d exited on signal %d",
-	    pid, WTERMSIG(status));
-   } else if (WIFSTOPPED(status)) {
-      Info2("waitpid(): child %d stopped on signal %d",
-	    pid, WSTOPSIG(status));
-   } else {
-      Warn1("waitpid(): cannot determine status of child %d", pid);
-   }
+   xiochildstatus(pid, status);
 
 #if !HAVE_SIGACTION
    /* we might need to re-register our handler */
@@ -178,3 +196,183 @@ int xiosetchilddied(void) {
 #endif /* !HAVE_SIGACTION */
    return 0;
 }
+
+
+#if HAVE_SIGNALFD
+static size_t xiochildslot(pid_t pid) {
+   return ((unsigned long)pid * 2654435761UL) & (xiochildsize-1);
+}
+
+/* enters pid into the table of children; grows it to keep it at most half
+   full. returns 0 on success, or -1 when out of memory */
+static int xiochildinsert(pid_t pid) {
+   size_t i;
+
+   if (2*(xiochildcount+1) > xiochildsize) {
+      pid_t *old = xiochildren;
+      size_t oldsize = xiochildsize;
+      pid_t *new;
+
+      if ((new = Malloc((oldsize?2*oldsize:64)*sizeof(pid_t))) == NULL) {
+	 return -1;
+      }
+      xiochildsize = oldsize?2*oldsize:64;
+      memset(new, 0, xiochildsize*sizeof(pid_t));
+      xiochildren = new;
+      xiochildcount = 0;
+      for (i = 0; i < oldsize; ++i) {
+	 if (old[i] != 0)  xiochildinsert(old[i]);
+      }
+      free(old);
+   }
+   for (i = xiochildslot(pid); xiochildren[i] != 0;
+	i = (i+1) & (xiochildsize-1))
+      ;
+   xiochildren[i] = pid;
+   ++xiochildcount;
+   return 0;
+}
+
+/* removes pid from the table of children, moving the following entries of
+   its probe sequence back. returns 0 when pid was found, or -1 */
+static int xiochildremove(pid_t pid) {
+   size_t i, j, k;
+
+   if (xiochildsize == 0)  return -1;
+   for (i = xiochildslot(pid); xiochildren[i] != pid;
+	i = (i+1) & (xiochildsize-1)) {
+      if (xiochildren[i] == 0)  return -1;
+   }
+   for (j = (i+1) & (xiochildsize-1); xiochildren[j] != 0;
+	j = (j+1) & (xiochildsize-1)) {
+      k = xiochildslot(xiochildren[j]);
+      /* move the entry of j to the gap at i unless its home slot k lies
+	 cyclically in (i, j] */
+      if ((i < j) ? (k <= i || k > j) : (k <= i && k > j)) {
+	 xiochildren[i] = xiochildren[j];
+	 i = j;
+      }
+   }
+   xiochildren[i] = 0;
+   --xiochildcount;
+   return 0;
+}
+#endif /* HAVE_SIGNALFD */
+
+/* switches the process to synchronous reaping of its children: SIGCHLD is
+   blocked and the caller polls the returned FD and calls xioreapchildren()
+   when it is readable; children forked with xio_fork() are registered.
+   Without signalfd() (or when it fails), returns -1 and childdied() keeps
+   reaping the children asynchronously */
+int xiochildwatch(void) {
+#if HAVE_SIGNALFD
+   sigset_t mask_sigchld;
+
+   if (xiochildfd >= 0)  return xiochildfd;
+   sigemptyset(&mask_sigchld);
+   sigaddset(&mask_sigchld, SIGCHLD);
+   Sigprocmask(SIG_BLOCK, &mask_sigchld, NULL);
+   if ((xiochildfd = Signalfd(-1, &mask_sigchld, SFD_NONBLOCK|SFD_CLOEXEC))
+       < 0) {
+      Warn1("signalfd(-1, {SIGCHLD}, SFD_NONBLOCK|SFD_CLOEXEC): %s",
+	    strerror(errno));
+      Sigprocmask(SIG_UNBLOCK, &mask_sigchld, NULL);
+      return -1;
+   }
+   Info1("reaping child processes through signalfd %d", xiochildfd);
+   return xiochildfd;
+#else /* !HAVE_SIGNALFD */
+   return -1;
+#endif /* !HAVE_SIGNALFD */
+}
+
+/* in a child process after fork(): returns to asynchronous reaping */
+void xiochildunwatch(void) {
+#if HAVE_SIGNALFD
+   sigset_t mask_sigchld;
+
+   if (xiochildfd < 0)  return;
+   Close(xiochildfd);
+   xiochildfd = -1;
+   free(xiochildren);
+   xiochildren = NULL;
+   xiochildsize = xiochildcount = 0;
+   sigemptyset(&mask_sigchld);
+   sigaddset(&mask_sigchld, SIGCHLD);
+   Sigprocmask(SIG_UNBLOCK, &mask_sigchld, NULL);
+#endif /* HAVE_SIGNALFD */
+}
+
+/* registers the child pid that xio_fork() just created */
+void xiochildadd(pid_t pid) {
+#if HAVE_SIGNALFD
+   if (xiochildfd < 0)  return;
+   if (xiochildinsert(pid) < 0) {
+      Warn1("cannot register child process "F_pid, pid);
+   }
+#endif /* HAVE_SIGNALFD */
+}
+
+/* with xiochildwatch(): consumes the pending SIGCHLD and reaps all children
+   that have terminated. Children that were not registered are handled like
+   in childdied().
+   returns the number of reaped children */
+int xioreapchildren(void) {
+#if HAVE_SIGNALFD
+   struct signalfd_siginfo si[8];
+   pid_t pid;
+   int status = 0;
+   int n = 0;
+   int i;
+
+   if (xiochildfd < 0)  return 0;
+   while (Read(xiochildfd, si, sizeof(si)) == sizeof(si)) ;
+   while ((pid = Waitpid(-1, &status, WNOHANG)) > 0) {
+      ++n;
+      if (xiochildremove(pid) == 0) {
+	 if (num_child) num_child--;
+      } else {
+	 /* forked before xiochildwatch(), or not registered */
+	 if (num_child > xiochildcount) num_child--;
+	 for (i = 0; i < XIO_MAXSOCK; ++i) {
+	    if (xio_checkchild(sock[i], i, pid))  break;
+	 }
+	 if (i == XIO_MAXSOCK) {
+	    Info1("cannot identify child %d", pid);
+	    if (nextunknown == NUMUNKNOWN) {
+	       nextunknown = 0;
+	    }
+	    diedunknown[nextunknown++] = pid;
+	 }
+      }
+      xiochildstatus(pid, status);
+   }
+   if (pid < 0 && errno != ECHILD) {
+      Warn1("waitpid(-1, {}, WNOHANG): %s", strerror(errno));
+   }
+   return n;
+#else /* !HAVE_SIGNALFD */
+   return 0;
+#endif /* !HAVE_SIGNALFD */
+}
+
+/* with xiochildwatch(): waits until at least one child has terminated and
+   reaps it.
+   returns 0 on success, or -1 if an error occurred */
+int xiowaitchildren(void) {
+#if HAVE_SIGNALFD
+   struct pollfd pfd;
+
+   if (xiochildfd < 0)  return -1;
+   pfd.fd = xiochildfd;  pfd.events = POLLIN;
+   while (xioreapchildren() == 0) {
+      if (Poll(&pfd, 1, -1) < 0 && errno != EINTR) {
+	 Warn2("poll({%d}, 1, -1): %s", xiochildfd, strerror(errno));
+	 return -1;
+      }
+   }
+   return 0;
+#else /* !HAVE_SIGNALFD */
+   return -1;
+#endif /* !HAVE_SIGNALFD */
+}
@@ -8,6 +8,7 @@
 #include "xiosysincludes.h"
 #include "xioopen.h"
 
+#include "xio-socket.h"
 #include "xio-readline.h"
 #include "xio-openssl.h"
 
@@ -16,6 +17,10 @@
    note that the write() call can block even if the select()/poll() call
    reported the FD writeable: in case the FD is not nonblocking and a lock
    defers the operation.
+   with a nonblocking FD this function does not wait: it returns the number of
+   bytes that could be written (possibly less than bytes, even 0), and the
+   caller has to keep the rest. a datagram is either sent completely or not at
+   all.
    on return value < 0: errno reflects the value from write() */
 ssize_t xiowrite(xiofile_t *file, const void *buff, size_t bytes) {
    ssize_t writt;
@@ -49,7 +54,7 @@ ssize_t xiowrite(xiofile_t *file, const void *buff, size_t bytes) {
    switch (pipe->dtype & XIODATA_WRITEMASK) {
 
    case XIOWRITE_STREAM:
-      writt = writefull(pipe->fd, buff, bytes);
+      writt = writeavail(pipe->fd, buff, bytes);
       if (writt < 0) {
 	 _errno = errno;
 	 switch (_errno) {
@@ -82,6 +87,11 @@ ssize_t xiowrite(xiofile_t *file, const void *buff, size_t bytes) {
 	 writt = Sendto(pipe->fd, buff, bytes, 0,
 			&pipe->peersa.soa, pipe->salen);
       } while (writt < 0 && errno == EINTR);
+      if (writt < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+	 Info4("sendto(%d, %p, "F_Zu", ...): %s",
+	       pipe->fd, buff, bytes, strerror(errno));
+	 return 0;	/* caller keeps the packet */
+      }
       if (writt < 0) {
 	 char infobuff[256];
 	 _errno = errno;
@@ -100,21 +110,13 @@ ssize_t xiowrite(xiofile_t *file, const void *buff, size_t bytes) {
 	       sockaddr_info(&pipe->peersa.soa, pipe->salen,
 			     infobuff, sizeof(infobuff)),
 	       pipe->salen, writt, bytes);
-      } else {
-      }
-      {
-	 char infobuff[256];
-	 union sockaddr_union us;
-	 socklen_t uslen = sizeof(us);
-	 Getsockname(pipe->fd, &us.soa, &uslen);
-	 Notice1("local address: %s",
-		 sockaddr_info(&us.soa, uslen, infobuff, sizeof(infobuff)));
       }
+      xiosendtocount(pipe, 1, writt);
       break;
 #endif /* _WITH_SOCKET */
 
    case XIOWRITE_PIPE:
-      writt = Write(pipe->para.bipipe.fdout, buff, bytes);
+      writt = writeavail(pipe->para.bipipe.fdout, buff, bytes);
       _errno = errno;
       if (writt < 0) {
 	 Error4("write(%d, %p, "F_Zu"): %s",
@@ -125,7 +127,7 @@ ssize_t xiowrite(xiofile_t *file, const void *buff, size_t bytes) {
       break;
 
    case XIOWRITE_2PIPE:
-      writt = Write(pipe->para.exec.fdout, buff, bytes);
+      writt = writeavail(pipe->para.exec.fdout, buff, bytes);
       _errno = errno;
       if (writt < 0) {
 	 Error4("write(%d, %p, "F_Zu"): %s",
@@ -148,3 +150,104 @@ ssize_t xiowrite(xiofile_t *file, const void *buff, size_t bytes) {
    }
    return writt;
 }
+
+
+/* writes bytes that were read as one coalesced packet of segments of segsize
+   bytes (option udp-gro), segsize 0 means one packet. When the output is a
+   UDP socket with option udp-segment the data is passed on whole and the
+   kernel segments it again; other outputs get one xiowrite() per segment.
+   returns like xiowrite(); when the output does not accept all of the
+   segments it returns the bytes of those that were written */
+ssize_t xiowritesegs(xiofile_t *file, const void *buff, size_t bytes,
+		     size_t segsize) {
+   size_t done = 0;
+   ssize_t writt;
+#if _WITH_SOCKET && defined(UDP_SEGMENT) && defined(HAVE_STRUCT_CMSGHDR) && defined(CMSG_DATA)
+   struct single *pipe;
+
+   if (segsize == 0 || bytes <= segsize) {
+      return xiowrite(file, buff, bytes);
+   }
+   if (file->tag == XIO_TAG_DUAL) {
+      pipe = file->dual.stream[1];
+   } else {
+      pipe = &file->stream;
+   }
+   if (pipe->gso &&
+       ((pipe->dtype & XIODATA_WRITEMASK) == XIOWRITE_STREAM ||
+	(pipe->dtype & XIODATA_WRITEMASK) == XIOWRITE_SENDTO)) {
+      struct msghdr msgh = {0};
+      struct iovec iovec;
+      union {
+	 char space[CMSG_SPACE(sizeof(uint16_t))];
+	 struct cmsghdr align;
+      } ctrl;
+      struct cmsghdr *cmsg;
+      uint16_t gsosize = segsize;
+
+      iovec.iov_base = (void *)buff;
+      iovec.iov_len  = bytes;
+      msgh.msg_iov = &iovec;
+      msgh.msg_iovlen = 1;
+      if ((pipe->dtype & XIODATA_WRITEMASK) == XIOWRITE_SENDTO) {
+	 msgh.msg_name = &pipe->peersa;
+	 msgh.msg_namelen = pipe->salen;
+      }
+      memset(&ctrl, 0, sizeof(ctrl));
+      msgh.msg_control = ctrl.space;
+      msgh.msg_controllen = sizeof(ctrl.space);
+      cmsg = CMSG_FIRSTHDR(&msgh);
+      cmsg->cmsg_level = SOL_UDP;
+      cmsg->cmsg_type  = UDP_SEGMENT;
+      cmsg->cmsg_len   = CMSG_LEN(sizeof(gsosize));
+      memcpy(CMSG_DATA(cmsg), &gsosize, sizeof(gsosize));
+
+      do {
+	 writt = Sendmsg(pipe->fd, &msgh, 0);
+      } while (writt < 0 && errno == EINTR);
+      if (writt >= 0) {
+	 if ((pipe->dtype & XIODATA_WRITEMASK) == XIOWRITE_SENDTO) {
+	    xiosendtocount(pipe, (writt+segsize-1)/segsize, writt);
+	 }
+	 return writt;
+      }
+      switch (errno) {
+      case EAGAIN:
+#if defined(EWOULDBLOCK) && EWOULDBLOCK != EAGAIN
+      case EWOULDBLOCK:
+#endif
+	 Info4("sendmsg(%d, %p{..., "F_Zu"}, 0): %s",
+	       pipe->fd, &msgh, bytes, strerror(errno));
+	 return 0;	/* caller keeps the packet */
+      case EINVAL: case EIO: case ENOPROTOOPT: case EOPNOTSUPP:
+	 /* e.g. the device has no checksum offload, or too many segments */
+	 Info5("sendmsg(%d, %p{..., "F_Zu"}, 0) with segment size "F_Zu": %s, sending the segments singly",
+	       pipe->fd, &msgh, bytes, segsize, strerror(errno));
+	 pipe->gso = false;
+	 break;
+      default:
+	 Error4("sendmsg(%d, %p{..., "F_Zu"}, 0): %s",
+		pipe->fd, &msgh, bytes, strerror(errno));
+	 return -1;
+      }
+   }
+#else /* !(_WITH_SOCKET && defined(UDP_SEGMENT) && ...) */
+   if (segsize == 0 || bytes <= segsize) {
+      return xiowrite(file, buff, bytes);
+   }
+#endif /* !(_WITH_SOCKET && defined(UDP_SEGMENT) && ...) */
+
+   /* one packet per segment, the last one may be shorter */
+   while (done < bytes) {
+      size_t len = Min(segsize, bytes-done);
+
+      if ((writt = xiowrite(file, (const char *)buff+done, len)) < 0) {
+	 return -1;
+      }
+      done += writt;
+      if ((size_t)writt < len) {
+	 break;
+      }
+   }
+   return done;
+}